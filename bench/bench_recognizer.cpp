@@ -0,0 +1,453 @@
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+#include <benchmark/benchmark.h>
+#include "earley.hpp"
+#include "parse_batch.hpp"
+#include "lr0_automaton.hpp"
+#include "parse_tree.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Digit, A,
+    /* Nonterminals */
+    Sum, Number, S, T, N, B,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::A; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    switch(terminal) {
+        case Symbol::Plus:  return input == '+';
+        case Symbol::Digit: return std::isdigit(input);
+        case Symbol::A:     return input == 'a';
+        default:            return false;
+    }
+}
+
+using Rule = earley::Rule<Symbol>;
+
+/* A grammar shape and a generator of inputs of a given size that match it */
+struct Grammar {
+    std::span<const Rule> rules;
+    Symbol start_symbol;
+    std::string (*make_input)(size_t size);
+};
+
+static const Rule left_recursive_rules[] = {
+    { Symbol::Sum,    { Symbol::Sum, Symbol::Plus, Symbol::Number } },
+    { Symbol::Sum,    { Symbol::Number } },
+    { Symbol::Number, { Symbol::Digit } }
+};
+
+static const Rule right_recursive_rules[] = {
+    { Symbol::Number, { Symbol::Digit, Symbol::Number } },
+    { Symbol::Number, { Symbol::Digit } }
+};
+
+static const Rule ambiguous_rules[] = {
+    { Symbol::S, { Symbol::S, Symbol::S } },
+    { Symbol::S, { Symbol::A } }
+};
+
+// Every 'a' is surrounded by nullable symbols that can be derived in several ways (like in test_nullable.cpp,
+//  but without a cycle, so that parse trees are finite)
+static const Rule nullable_rules[] = {
+    { Symbol::S, { Symbol::S, Symbol::T } },
+    { Symbol::S, { Symbol::T } },
+    { Symbol::T, { Symbol::N, Symbol::N, Symbol::A, Symbol::N } },
+    { Symbol::N, {} },
+    { Symbol::N, { Symbol::B } },
+    { Symbol::B, {} },
+    { Symbol::B, { Symbol::Plus } }
+};
+
+static
+std::string make_sum(size_t size)
+{
+    std::string input = "1";
+    while(input.size() + 2 <= size) {
+        input += "+2";
+    }
+    return input;
+}
+
+static
+std::string make_a_string(size_t size) { return std::string(size, 'a'); }
+
+static
+std::string make_number(size_t size) { return std::string(size, '7'); }
+
+static const Grammar left_recursive{left_recursive_rules, Symbol::Sum, make_sum};
+static const Grammar right_recursive{right_recursive_rules, Symbol::Number, make_number};
+static const Grammar ambiguous{ambiguous_rules, Symbol::S, make_a_string};
+static const Grammar nullable{nullable_rules, Symbol::S, make_a_string};
+
+template<typename Item>
+static
+void set_counters(benchmark::State& state, const SpanList<Item>& state_sets, const std::string& input)
+{
+    state.SetItemsProcessed(state.iterations() * input.size());
+    state.counters["items_per_token"] = (double)state_sets.num_of_items() / std::max<size_t>(input.size(), 1);
+    state.counters["item_bytes"] = benchmark::Counter((double)(state_sets.num_of_items() * sizeof(Item)),
+                                                      benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+}
+
+/* Recognizer time with state sets allocated for each parse */
+static
+void BM_Recognizer(benchmark::State& state, const Grammar& grammar)
+{
+    earley::RuleSet rule_set{grammar.rules};
+    auto input = grammar.make_input(state.range(0));
+    size_t item_count = 0;
+    for(auto _ : state) {
+        auto state_sets = earley::parse<char>(rule_set, grammar.start_symbol, 4096, input);
+        item_count = state_sets.num_of_items();
+        benchmark::DoNotOptimize(item_count);
+    }
+    set_counters(state, earley::parse<char>(rule_set, grammar.start_symbol, item_count, input), input);
+}
+
+/* Recognizer time with the state sets of a Parser reused between parses */
+static
+void BM_ReusedParser(benchmark::State& state, const Grammar& grammar)
+{
+    earley::RuleSet rule_set{grammar.rules};
+    auto input = grammar.make_input(state.range(0));
+    earley::Parser<Symbol> parser;
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(parser.parse<char>(rule_set, grammar.start_symbol, input).num_of_items());
+    }
+    set_counters(state, parser.state_sets(), input);
+}
+
+/* Same as BM_ReusedParser, with the state sets on transparent huge pages */
+static
+void BM_HugePageParser(benchmark::State& state, const Grammar& grammar)
+{
+    earley::RuleSet rule_set{grammar.rules};
+    auto input = grammar.make_input(state.range(0));
+    earley::Parser<Symbol> parser{4096, {.huge_pages = BigArrayOptions::HugePages::Advise}};
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(parser.parse<char>(rule_set, grammar.start_symbol, input).num_of_items());
+    }
+    set_counters(state, parser.state_sets(), input);
+}
+
+/* Same as BM_ReusedParser, with 4-byte items */
+static
+void BM_CompactParser(benchmark::State& state, const Grammar& grammar)
+{
+    earley::RuleSet rule_set{grammar.rules};
+    auto input = grammar.make_input(state.range(0));
+    earley::Parser<Symbol, false, earley::CompactEarleyItem> parser;
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(parser.parse<char>(rule_set, grammar.start_symbol, input).num_of_items());
+    }
+    set_counters(state, parser.state_sets(), input);
+}
+
+/* Same as BM_ReusedParser, also counting the work done per rule (see ParseStats) */
+static
+void BM_StatsParser(benchmark::State& state, const Grammar& grammar)
+{
+    earley::RuleSet rule_set{grammar.rules};
+    auto input = grammar.make_input(state.range(0));
+    earley::Parser<Symbol> parser;
+    earley::ParseStats stats{true};
+    for(auto _ : state) {
+        stats.reset();
+        benchmark::DoNotOptimize(parser.parse<char>(rule_set, grammar.start_symbol, input, stats).num_of_items());
+    }
+    set_counters(state, parser.state_sets(), input);
+    state.counters["duplicates_per_token"] = (double)stats.duplicates / std::max<size_t>(input.size(), 1);
+}
+
+/* Recognizer time with Leo items, without keeping the state sets that can no longer be used (see Parser::recognize) */
+static
+void BM_RecognizeOnly(benchmark::State& state, const Grammar& grammar)
+{
+    earley::RuleSet rule_set{grammar.rules};
+    auto input = grammar.make_input(state.range(0));
+    earley::Parser<Symbol, true> parser;
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(parser.recognize<char>(rule_set, grammar.start_symbol, input).accepted);
+    }
+    set_counters(state, parser.state_sets(), input);
+}
+
+static
+void BM_LeoRecognizer(benchmark::State& state, const Grammar& grammar)
+{
+    earley::RuleSet rule_set{grammar.rules};
+    auto input = grammar.make_input(state.range(0));
+    earley::Parser<Symbol, true> parser;
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(parser.parse<char>(rule_set, grammar.start_symbol, input).num_of_items());
+    }
+    set_counters(state, parser.state_sets(), input);
+}
+
+static
+void BM_LookaheadRecognizer(benchmark::State& state, const Grammar& grammar)
+{
+    earley::RuleSet rule_set{grammar.rules};
+    auto input = grammar.make_input(state.range(0));
+    earley::Parser<Symbol> parser;
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(parser.parse<char>(rule_set, grammar.start_symbol, input, earley::lookahead).num_of_items());
+    }
+    set_counters(state, parser.state_sets(), input);
+}
+
+/* Recognizer time with each token classified once using a TerminalTable */
+static
+void BM_ClassifiedRecognizer(benchmark::State& state, const Grammar& grammar)
+{
+    earley::RuleSet rule_set{grammar.rules};
+    auto input = grammar.make_input(state.range(0));
+    earley::Parser<Symbol> parser;
+    earley::ClassifyTokens<earley::TerminalTable<Symbol>> classify_tokens{earley::TerminalTable{rule_set}};
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(parser.parse<char>(rule_set, grammar.start_symbol, input, classify_tokens).num_of_items());
+    }
+    set_counters(state, parser.state_sets(), input);
+}
+
+/* Visits each node of a parse tree of the completed item parent, which is in state_set. Returns
+   the number of nodes visited. */
+static
+size_t traverse(std::span<const Rule> rules, const SpanList<earley::EarleyItem>& state_sets,
+                earley::EarleyItem parent, earley::StateSetIterator state_set)
+{
+    size_t node_count = 1;
+    const auto& components = rules[parent.rule_idx].components;
+    for(auto progress = (uint16_t)components.size(); progress-- > 0;) {
+        if(is_terminal(components[progress])) {
+            earley::advance_from_terminal(state_set);
+            ++node_count;
+            continue;
+        }
+        // Choose a child whose start set contains the parent item advanced up to the child
+        earley::EarleyItem parent_prefix{parent.rule_idx, parent.start_pos, progress};
+        auto child = earley::find_completed_item(rules, state_set->begin(), state_set->end(), components[progress]);
+        while(child != state_set->end()
+              && (child->start_pos < parent.start_pos
+                  || !earley::item_exists(state_sets[child->start_pos], parent_prefix))) {
+            child = earley::find_completed_item(rules, child + 1, state_set->end(), components[progress]);
+        }
+        if(child == state_set->end()) {
+            throw std::runtime_error("traverse: no derivation found for a node's children");
+        }
+        node_count += traverse(rules, state_sets, *child, state_set);
+        earley::advance_from_nonterminal(state_sets, state_set, child);
+    }
+    return node_count;
+}
+
+static
+void BM_Traversal(benchmark::State& state, const Grammar& grammar)
+{
+    earley::RuleSet rule_set{grammar.rules};
+    auto input = grammar.make_input(state.range(0));
+    auto state_sets = earley::parse<char>(rule_set, grammar.start_symbol, 4096, input);
+    auto full_parse = earley::find_full_parse(grammar.rules, grammar.start_symbol, state_sets, input);
+    if(!full_parse) {
+        state.SkipWithError("Input was not recognized");
+        return;
+    }
+    size_t node_count = 0;
+    for(auto _ : state) {
+        node_count = traverse(grammar.rules, state_sets, *full_parse.item, full_parse.state_set);
+        benchmark::DoNotOptimize(node_count);
+    }
+    state.SetItemsProcessed(state.iterations() * input.size());
+    state.counters["nodes"] = (double)node_count;
+}
+
+/* Same traversal as BM_Traversal, left to right with a ParseTreeWalker */
+static
+void BM_TreeWalker(benchmark::State& state, const Grammar& grammar)
+{
+    earley::RuleSet rule_set{grammar.rules};
+    auto input = grammar.make_input(state.range(0));
+    auto state_sets = earley::parse<char>(rule_set, grammar.start_symbol, 4096, input);
+    auto full_parse = earley::find_full_parse(grammar.rules, grammar.start_symbol, state_sets, input);
+    if(!full_parse) {
+        state.SkipWithError("Input was not recognized");
+        return;
+    }
+    size_t node_count = 0;
+    for(auto _ : state) {
+        node_count = 0;
+        for(const auto& event : earley::ParseTreeWalker{grammar.rules, state_sets, full_parse}) {
+            node_count += event.kind != earley::TreeEventKind::Exit;
+        }
+        benchmark::DoNotOptimize(node_count);
+    }
+    state.SetItemsProcessed(state.iterations() * input.size());
+    state.counters["nodes"] = (double)node_count;
+}
+
+/* Recognizer time with the completions of large state sets found on the given number of threads */
+static
+void BM_ParallelCompletion(benchmark::State& state, const Grammar& grammar)
+{
+    earley::RuleSet rule_set{grammar.rules};
+    auto input = grammar.make_input(state.range(0));
+    earley::Parser<Symbol> parser;
+    parser.set_completion_threads(state.range(1));
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(parser.parse<char>(rule_set, grammar.start_symbol, input).num_of_items());
+    }
+    set_counters(state, parser.state_sets(), input);
+}
+
+/* Time to recognize a batch of 256 inputs of 1024 tokens with the given number of threads */
+static
+void BM_ParseBatch(benchmark::State& state, const Grammar& grammar)
+{
+    earley::RuleSet rule_set{grammar.rules};
+    std::vector<std::string> inputs(256, grammar.make_input(1024));
+    for(auto _ : state) {
+        auto accepted = earley::parse_batch<char>(rule_set, grammar.start_symbol, inputs, state.range(0));
+        benchmark::DoNotOptimize(accepted);
+    }
+    state.SetItemsProcessed(state.iterations() * inputs.size() * inputs[0].size());
+    state.counters["threads"] = (double)state.range(0);
+}
+
+/* Time to recognize with the LR(0) recognizer (see lr0_automaton.hpp). item_bytes is the memory of its
+   state sets, and items_per_token counts its (state, origin) items. */
+static
+void BM_Lr0Recognizer(benchmark::State& state, const Grammar& grammar)
+{
+    earley::RuleSet rule_set{grammar.rules};
+    earley::Lr0Automaton automaton{rule_set, grammar.start_symbol};
+    auto input = grammar.make_input(state.range(0));
+    size_t item_count = 0;
+    for(auto _ : state) {
+        auto state_sets = earley::parse<char>(automaton, 4096, input);
+        item_count = state_sets.num_of_items();
+        benchmark::DoNotOptimize(item_count);
+    }
+    set_counters(state, earley::parse<char>(automaton, item_count, input), input);
+}
+
+/* Time to scan a state set of the given size for an item that is not in it (see item_scan.hpp) */
+static
+void BM_ItemExists(benchmark::State& state)
+{
+    std::vector<earley::EarleyItem> state_set;
+    for(int64_t i = 0; i < state.range(0); ++i) {
+        state_set.emplace_back((uint16_t)(i % 7), (uint32_t)i, (uint16_t)(i % 3));
+    }
+    earley::EarleyItem missing_item{7, 0};
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(missing_item);
+        benchmark::DoNotOptimize(item_exists(state_set, missing_item));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetLabel(detail::item_scan_isa);
+}
+
+/* A machine-generated grammar of rule_count rules: each nonterminal has rule_count / 6 rules deriving the next
+   one, and only the last one has an empty rule, so nullability spreads back through the whole chain */
+static
+std::vector<Rule> make_generated_rules(size_t rule_count)
+{
+    const Symbol chain[] = {Symbol::Sum, Symbol::Number, Symbol::S, Symbol::T, Symbol::N, Symbol::B};
+    std::vector<Rule> rules;
+    for(size_t i = 0; i < std::size(chain); ++i) {
+        for(size_t j = 0; j < rule_count / std::size(chain); ++j) {
+            if(i + 1 == std::size(chain)) {
+                rules.push_back({chain[i], j == 0 ? std::vector<Symbol>{} : std::vector<Symbol>{Symbol::A}});
+            } else if(j % 3 == 0) {
+                rules.push_back({chain[i], {chain[i + 1], chain[i + 1]}});
+            } else {
+                rules.push_back({chain[i], {chain[i + 1], j % 3 == 1 ? Symbol::Plus : Symbol::Digit}});
+            }
+        }
+    }
+    return rules;
+}
+
+/* Time to build the tables of a large grammar */
+static
+void BM_RuleSetConstruction(benchmark::State& state)
+{
+    auto rules = make_generated_rules((size_t)state.range(0));
+    for(auto _ : state) {
+        earley::RuleSet<Symbol> rule_set{rules};
+        benchmark::DoNotOptimize(rule_set.nullable);
+    }
+    state.SetItemsProcessed(state.iterations() * rules.size());
+}
+
+#define LINEAR_SIZES RangeMultiplier(8)->Range(64, 1 << 18)
+// Right recursion takes quadratic time without Leo items, and ambiguous grammars take cubic time
+#define QUADRATIC_SIZES RangeMultiplier(4)->Range(64, 4096)
+#define CUBIC_SIZES RangeMultiplier(2)->Range(8, 128)
+// Traversal recurses once per level of the parse tree, so its inputs are kept small enough for the stack
+#define TRAVERSAL_SIZES RangeMultiplier(8)->Range(64, 1 << 12)
+
+BENCHMARK_CAPTURE(BM_Recognizer, left_recursive, left_recursive)->LINEAR_SIZES;
+BENCHMARK_CAPTURE(BM_Recognizer, right_recursive, right_recursive)->QUADRATIC_SIZES;
+BENCHMARK_CAPTURE(BM_Recognizer, ambiguous, ambiguous)->CUBIC_SIZES;
+BENCHMARK_CAPTURE(BM_Recognizer, nullable, nullable)->LINEAR_SIZES;
+
+BENCHMARK_CAPTURE(BM_ReusedParser, left_recursive, left_recursive)->LINEAR_SIZES;
+BENCHMARK_CAPTURE(BM_ReusedParser, right_recursive, right_recursive)->QUADRATIC_SIZES;
+BENCHMARK_CAPTURE(BM_ReusedParser, ambiguous, ambiguous)->CUBIC_SIZES;
+BENCHMARK_CAPTURE(BM_ReusedParser, nullable, nullable)->LINEAR_SIZES;
+BENCHMARK_CAPTURE(BM_HugePageParser, left_recursive, left_recursive)->LINEAR_SIZES;
+BENCHMARK_CAPTURE(BM_HugePageParser, ambiguous, ambiguous)->CUBIC_SIZES;
+
+// Compact items only fit inputs of less than 64K tokens
+BENCHMARK_CAPTURE(BM_CompactParser, left_recursive, left_recursive)->RangeMultiplier(8)->Range(64, 1 << 15);
+BENCHMARK_CAPTURE(BM_CompactParser, nullable, nullable)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+BENCHMARK_CAPTURE(BM_StatsParser, left_recursive, left_recursive)->LINEAR_SIZES;
+BENCHMARK_CAPTURE(BM_StatsParser, nullable, nullable)->LINEAR_SIZES;
+
+BENCHMARK_CAPTURE(BM_LeoRecognizer, right_recursive, right_recursive)->LINEAR_SIZES;
+BENCHMARK_CAPTURE(BM_RecognizeOnly, left_recursive, left_recursive)->LINEAR_SIZES;
+BENCHMARK_CAPTURE(BM_RecognizeOnly, right_recursive, right_recursive)->LINEAR_SIZES;
+BENCHMARK_CAPTURE(BM_RecognizeOnly, nullable, nullable)->LINEAR_SIZES;
+BENCHMARK_CAPTURE(BM_Lr0Recognizer, left_recursive, left_recursive)->LINEAR_SIZES;
+BENCHMARK_CAPTURE(BM_Lr0Recognizer, right_recursive, right_recursive)->QUADRATIC_SIZES;
+BENCHMARK_CAPTURE(BM_Lr0Recognizer, ambiguous, ambiguous)->CUBIC_SIZES;
+BENCHMARK_CAPTURE(BM_Lr0Recognizer, nullable, nullable)->LINEAR_SIZES;
+BENCHMARK_CAPTURE(BM_LookaheadRecognizer, left_recursive, left_recursive)->LINEAR_SIZES;
+BENCHMARK_CAPTURE(BM_LookaheadRecognizer, nullable, nullable)->LINEAR_SIZES;
+BENCHMARK_CAPTURE(BM_ClassifiedRecognizer, left_recursive, left_recursive)->LINEAR_SIZES;
+BENCHMARK_CAPTURE(BM_ClassifiedRecognizer, nullable, nullable)->LINEAR_SIZES;
+
+BENCHMARK_CAPTURE(BM_ParallelCompletion, ambiguous, ambiguous)->ArgsProduct({{128, 512}, {1, 2, 4}})->UseRealTime();
+
+BENCHMARK_CAPTURE(BM_ParseBatch, left_recursive, left_recursive)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ParseBatch, nullable, nullable)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+BENCHMARK(BM_ItemExists)->RangeMultiplier(4)->Range(8, 4096);
+
+BENCHMARK(BM_RuleSetConstruction)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+BENCHMARK_CAPTURE(BM_Traversal, left_recursive, left_recursive)->TRAVERSAL_SIZES;
+BENCHMARK_CAPTURE(BM_Traversal, right_recursive, right_recursive)->RangeMultiplier(4)->Range(64, 1024);
+BENCHMARK_CAPTURE(BM_Traversal, ambiguous, ambiguous)->CUBIC_SIZES;
+BENCHMARK_CAPTURE(BM_Traversal, nullable, nullable)->TRAVERSAL_SIZES;
+BENCHMARK_CAPTURE(BM_TreeWalker, left_recursive, left_recursive)->TRAVERSAL_SIZES;
+BENCHMARK_CAPTURE(BM_TreeWalker, right_recursive, right_recursive)->RangeMultiplier(4)->Range(64, 1024);
+BENCHMARK_CAPTURE(BM_TreeWalker, ambiguous, ambiguous)->CUBIC_SIZES;
+BENCHMARK_CAPTURE(BM_TreeWalker, nullable, nullable)->TRAVERSAL_SIZES;
+
+BENCHMARK_MAIN();
@@ -16,35 +16,352 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 #include "big_array.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+/* Reserved ranges are at least this big, so that small arrays rarely need to grow */
+constexpr size_t min_reserved_bytes = 1 << 20;
+
+size_t round_up(size_t size, size_t alignment) noexcept
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+/* Size of the reserved range to grow to so that at least min_size bytes fit */
+size_t next_reserved_size(size_t curr_size, size_t min_size, size_t page_size) noexcept
+{
+    return round_up(std::max({min_size, curr_size * 2, min_reserved_bytes}), page_size);
+}
+
+} // namespace
 
 #if defined(unix) || defined(__unix) || defined(__unix__) || defined(__APPLE__)
-#include <cassert>
 #include <cerrno>
-#include <cstring>
+#include <string>
+#include <vector>
 #include <sys/mman.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+using HugePages = BigArrayOptions::HugePages;
 
-detail::BigArrayBase::BigArrayBase(size_t capacity, size_t element_size)
+/* Size of the huge pages used by HugePages::Advise (on x86-64 and on AArch64 with 4K pages) and
+   HugePages::Explicit */
+constexpr size_t huge_page_size = 1 << 21;
+
+[[noreturn]] static
+void throw_error(const char* what)
 {
-    m_byte_capacity = capacity * element_size;
-    m_byte_capacity += m_byte_capacity % (size_t)getpagesize();
-    void* data = mmap(nullptr, m_byte_capacity, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, 0, 0);
-    if(data == MAP_FAILED) {
-        throw std::runtime_error(strerror(errno));
+    throw std::runtime_error(std::string{what} + ": " + strerror(errno));
+}
+
+/* Granularity of the sizes of reserved ranges */
+static
+size_t page_size(const BigArrayOptions& options) noexcept
+{
+    return options.huge_pages == HugePages::None ? (size_t)getpagesize() : huge_page_size;
+}
+
+static
+void bind_to_node([[maybe_unused]] char* data, [[maybe_unused]] size_t byte_count, int node)
+{
+    if(node == BigArrayOptions::any_node) {
+        return;
+    }
+#if defined(__linux__) && defined(SYS_mbind)
+    if(node == BigArrayOptions::current_node) {
+        unsigned current = 0;
+        if(syscall(SYS_getcpu, nullptr, &current, nullptr) != 0) {
+            throw_error("Failed to find the NUMA node of the current thread");
+        }
+        node = (int)current;
     }
-    m_data = (char*)data;
+    if(node < 0) {
+        throw std::runtime_error("Invalid NUMA node " + std::to_string(node));
+    }
+    // The kernel reads one less bit than maxnode
+    constexpr size_t bits_per_word = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> node_mask((size_t)node / bits_per_word + 1);
+    node_mask[(size_t)node / bits_per_word] = 1ul << ((size_t)node % bits_per_word);
+    constexpr int mpol_bind = 2;
+    if(syscall(SYS_mbind, data, byte_count, mpol_bind, node_mask.data(), node_mask.size() * bits_per_word + 1, 0) != 0) {
+        throw_error("Failed to bind BigArray to NUMA node");
+    }
+#else
+    throw std::runtime_error("NUMA node binding is not supported on this platform");
+#endif
+}
+
+/* Commits the pages of [data, data + byte_count) */
+static
+void populate(char* data, size_t byte_count) noexcept
+{
+#ifdef MADV_POPULATE_WRITE
+    if(madvise(data, byte_count, MADV_POPULATE_WRITE) == 0) {
+        return;
+    }
+#endif
+    // Older kernels only commit pages as they are first written to
+    for(size_t offset = 0; offset < byte_count; offset += (size_t)getpagesize()) {
+        ((volatile char*)data)[offset] = 0;
+    }
+}
+
+// Pages of a MAP_NORESERVE mapping are committed by the OS the first time they are written to,
+//  so all reserved bytes are usable. The whole range is set up (aligned, advised and bound to a node)
+//  before any of it is populated, so that no page is committed before it can be a huge page on the
+//  right node. MAP_POPULATE would commit pages as they are mapped.
+static
+char* reserve(size_t byte_count, const BigArrayOptions& options, bool should_populate = true)
+{
+    int flags = MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE;
+    if(options.huge_pages == HugePages::Explicit) {
+#ifdef MAP_HUGETLB
+        // Without MAP_NORESERVE, mapping fails up front instead of faulting later if the pool runs out
+        flags = MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+        // Ask for the pool of huge_page_size pages, since the default huge page size can differ (e.g. 1G),
+        //  and then the sizes rounded up to huge_page_size would not be multiples of the page size
+        flags |= 21 << MAP_HUGE_SHIFT;
+        static_assert(huge_page_size == 1 << 21);
+#endif
+#else
+        throw std::runtime_error("Huge pages are not supported on this platform");
+#endif
+    }
+    // Transparent huge pages are only used for the aligned parts of a range, so extra room is mapped to
+    //  align the range within
+    size_t alignment = options.huge_pages == HugePages::Advise ? huge_page_size : 0;
+    void* mapping = mmap(nullptr, byte_count + alignment, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if(mapping == MAP_FAILED) {
+        throw_error(options.huge_pages == HugePages::Explicit ? "Failed to map huge pages" : "Failed to reserve memory");
+    }
+    char* data = (char*)mapping;
+    if(alignment > 0) {
+        char* aligned = (char*)round_up((size_t)data, alignment);
+        if(aligned > data) {
+            munmap(data, aligned - data);
+        }
+        if(aligned + byte_count < data + byte_count + alignment) {
+            munmap(aligned + byte_count, data + alignment - aligned);
+        }
+        data = aligned;
+#ifdef MADV_HUGEPAGE
+        madvise(data, byte_count, MADV_HUGEPAGE);
+#endif
+    }
+    try {
+        bind_to_node(data, byte_count, options.numa_node);
+    } catch(...) {
+        munmap(data, byte_count);
+        throw;
+    }
+    if(options.populate && should_populate) {
+        populate(data, byte_count);
+    }
+    return data;
+}
+
+detail::BigArrayBase::BigArrayBase(size_t capacity, size_t element_size, const BigArrayOptions& options)
+    : m_options(options)
+{
+    m_byte_reserved = round_up(std::max<size_t>(capacity * element_size, 1), page_size(options));
+    m_byte_capacity = m_byte_reserved;
+    m_data = reserve(m_byte_reserved, options);
     m_end = m_data;
 }
 
+void detail::BigArrayBase::grow(size_t min_byte_capacity)
+{
+    auto size = m_end - m_data;
+    auto new_byte_reserved = next_reserved_size(m_byte_reserved, min_byte_capacity, page_size(m_options));
+    if(m_data == nullptr) {
+        // Array was moved from
+        m_data = reserve(new_byte_reserved, m_options);
+    } else if(m_options.huge_pages == HugePages::Explicit) {
+        // Not every kernel can remap huge pages, so they are copied
+        char* data = reserve(new_byte_reserved, m_options);
+        std::memcpy(data, m_data, size);
+        [[maybe_unused]] int err = munmap((void*)m_data, m_byte_reserved);
+        assert(err == 0);
+        m_data = data;
+    } else {
+#ifdef MREMAP_MAYMOVE
+        // Move the pages to a larger range instead of copying them. The pages keep their advice and NUMA
+        //  policy.
+        void* data;
+#ifdef MREMAP_FIXED
+        if(m_options.huge_pages == HugePages::Advise) {
+            // Moving to a range reserved the same way keeps the alignment needed for huge pages
+            char* target = reserve(new_byte_reserved, m_options, false);
+            data = mremap((void*)m_data, m_byte_reserved, new_byte_reserved, MREMAP_MAYMOVE | MREMAP_FIXED, target);
+            if(data == MAP_FAILED) {
+                auto error = errno;
+                munmap(target, new_byte_reserved);
+                errno = error;
+            }
+        } else
+#endif
+        data = mremap((void*)m_data, m_byte_reserved, new_byte_reserved, MREMAP_MAYMOVE);
+        if(data == MAP_FAILED) {
+            throw_error("Failed to grow BigArray");
+        }
+        m_data = (char*)data;
+        if(m_options.populate) {
+            populate(m_data + m_byte_reserved, new_byte_reserved - m_byte_reserved);
+        }
+#else
+        char* data = reserve(new_byte_reserved, m_options);
+        std::memcpy(data, m_data, size);
+        [[maybe_unused]] int err = munmap((void*)m_data, m_byte_reserved);
+        assert(err == 0);
+        m_data = data;
+#endif
+    }
+    m_byte_reserved = new_byte_reserved;
+    m_byte_capacity = new_byte_reserved;
+    m_end = m_data + size;
+}
+
+size_t detail::BigArrayBase::bytes_committed() const noexcept
+{
+    // Explicit huge pages are committed when they are mapped
+    if(m_options.populate || m_options.huge_pages == HugePages::Explicit) {
+        return m_byte_capacity;
+    }
+    return std::min(round_up(m_end - m_data, page_size(m_options)), m_byte_capacity);
+}
+
 detail::BigArrayBase::~BigArrayBase() noexcept
 {
     // Note: element destructors not called
     if(m_data != nullptr) {
-        int err = munmap((void*)m_data, m_byte_capacity);
+        [[maybe_unused]] int err = munmap((void*)m_data, m_byte_reserved);
         assert(err == 0);
     }
 }
 
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+/* Memory is committed in chunks of this size as the array fills up */
+constexpr size_t commit_granularity = 1 << 16;
+
+static
+size_t allocation_granularity() noexcept
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwAllocationGranularity;
+}
+
+static
+char* reserve(size_t byte_count)
+{
+    void* data = VirtualAlloc(nullptr, byte_count, MEM_RESERVE, PAGE_NOACCESS);
+    if(data == nullptr) {
+        throw std::runtime_error("Failed to reserve memory for BigArray");
+    }
+    return (char*)data;
+}
+
+static
+void commit(char* data, size_t byte_count, const BigArrayOptions& options)
+{
+    if(byte_count == 0) {
+        return;
+    }
+    void* result;
+    if(options.numa_node == BigArrayOptions::any_node) {
+        result = VirtualAlloc(data, byte_count, MEM_COMMIT, PAGE_READWRITE);
+    } else {
+        DWORD node = (DWORD)options.numa_node;
+        if(options.numa_node == BigArrayOptions::current_node) {
+            PROCESSOR_NUMBER processor;
+            GetCurrentProcessorNumberEx(&processor);
+            USHORT current;
+            GetNumaProcessorNodeEx(&processor, &current);
+            node = current;
+        }
+        result = VirtualAllocExNuma(GetCurrentProcess(), data, byte_count, MEM_COMMIT, PAGE_READWRITE, node);
+    }
+    if(result == nullptr) {
+        throw std::runtime_error("Failed to commit memory for BigArray");
+    }
+    if(options.populate) {
+        // Committed pages are still only backed by memory once they are first written to
+        for(size_t offset = 0; offset < byte_count; offset += 4096) {
+            ((volatile char*)data)[offset] = 0;
+        }
+    }
+}
+
+detail::BigArrayBase::BigArrayBase(size_t capacity, size_t element_size, const BigArrayOptions& options)
+    : m_options(options)
+{
+    // Large pages need a privilege and cannot be committed gradually, and there are no transparent huge
+    //  pages, so only explicit huge pages are an error
+    if(options.huge_pages == BigArrayOptions::HugePages::Explicit) {
+        throw std::runtime_error("Huge pages are not supported on this platform");
+    }
+    m_byte_reserved = round_up(std::max<size_t>(capacity * element_size, 1), allocation_granularity());
+    m_byte_capacity = 0;
+    m_data = reserve(m_byte_reserved);
+    m_end = m_data;
+    if(options.populate) {
+        commit(m_data, m_byte_reserved, options);
+        m_byte_capacity = m_byte_reserved;
+    }
+}
+
+void detail::BigArrayBase::grow(size_t min_byte_capacity)
+{
+    if(min_byte_capacity > m_byte_reserved) {
+        // Windows cannot grow a reserved range in place, so move to a larger one
+        auto size = m_end - m_data;
+        auto new_byte_reserved = next_reserved_size(m_byte_reserved, min_byte_capacity, allocation_granularity());
+        char* data = reserve(new_byte_reserved);
+        if(m_data != nullptr) {
+            commit(data, m_byte_capacity, m_options);
+            std::memcpy(data, m_data, size);
+            [[maybe_unused]] BOOL success = VirtualFree(m_data, 0, MEM_RELEASE);
+            assert(success);
+        }
+        m_data = data;
+        m_end = m_data + size;
+        m_byte_reserved = new_byte_reserved;
+    }
+    auto new_byte_capacity = m_options.populate ? m_byte_reserved
+                                                : std::min(round_up(min_byte_capacity, commit_granularity), m_byte_reserved);
+    commit(m_data + m_byte_capacity, new_byte_capacity - m_byte_capacity, m_options);
+    m_byte_capacity = new_byte_capacity;
+}
+
+size_t detail::BigArrayBase::bytes_committed() const noexcept
+{
+    return m_byte_capacity;
+}
+
+detail::BigArrayBase::~BigArrayBase() noexcept
+{
+    // Note: element destructors not called
+    if(m_data != nullptr) {
+        [[maybe_unused]] BOOL success = VirtualFree(m_data, 0, MEM_RELEASE);
+        assert(success);
+    }
+}
+
 #else
 
 #error "Platform not supported"
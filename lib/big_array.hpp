@@ -19,50 +19,100 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <type_traits>
 #include <stdexcept>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+
+/* How the memory of a BigArray is allocated. The defaults (normal pages, committed as they are first
+   written to, on whichever NUMA node the OS chooses) suit most uses. */
+struct BigArrayOptions {
+    enum class HugePages : uint8_t {
+        None,
+        /* The memory is aligned to huge pages and the OS is advised to back it with them (transparent
+           huge pages), falling back to normal pages where none are free */
+        Advise,
+        /* The memory is mapped from the pool of 2M huge pages reserved by the administrator (e.g. through
+           /proc/sys/vm/nr_hugepages, or /sys/kernel/mm/hugepages/hugepages-2048kB/nr_hugepages if the
+           default huge page size differs). Throws std::runtime_error if not enough are reserved. */
+        Explicit
+    };
+    /* Binds to the NUMA node of the CPU running the thread that allocates the memory */
+    static constexpr int current_node = -2;
+    static constexpr int any_node = -1;
+
+    /* Huge pages make fewer TLB misses when completion reads back from older state sets */
+    HugePages huge_pages = HugePages::None;
+    /* If true, memory is committed (and zeroed) when it is reserved instead of page by page as it is
+       first written to, so that no page faults happen while the array is filled. All of the capacity is
+       committed, so it should not be much more than what will be used. */
+    bool populate = false;
+    /* NUMA node that the memory is bound to: any_node, current_node or the index of a node */
+    int numa_node = any_node;
+};
 
 namespace detail {
 
+/* Untyped storage of a BigArray. A range of virtual memory is reserved up front and pages are only
+   backed by physical memory once they are used. When the reserved range runs out, it is grown (without
+   copying where the platform supports it), which may move the array to a new address. */
 class BigArrayBase {
 protected:
-    BigArrayBase(size_t capacity, size_t element_size);
+    /* capacity is the number of elements to initially reserve memory for */
+    BigArrayBase(size_t capacity, size_t element_size, const BigArrayOptions& options);
 public:
     BigArrayBase(const BigArrayBase&) = delete;
     BigArrayBase& operator=(const BigArrayBase&) = delete;
     BigArrayBase(BigArrayBase&& other) noexcept
-        : m_byte_capacity(other.m_byte_capacity), m_data(other.m_data), m_end(other.m_end)
+        : m_byte_capacity(other.m_byte_capacity), m_byte_reserved(other.m_byte_reserved),
+          m_data(other.m_data), m_end(other.m_end), m_options(other.m_options)
     {
         other.m_byte_capacity = 0;
+        other.m_byte_reserved = 0;
         other.m_data = nullptr;
         other.m_end = nullptr;
     }
     BigArrayBase& operator=(BigArrayBase&& other) noexcept
     {
-        m_byte_capacity = other.m_byte_capacity;
-        m_data = other.m_data;
-        m_end = other.m_end;
-        other.m_byte_capacity = 0;
-        other.m_data = nullptr;
-        other.m_end = nullptr;
+        std::swap(m_byte_capacity, other.m_byte_capacity);
+        std::swap(m_byte_reserved, other.m_byte_reserved);
+        std::swap(m_data, other.m_data);
+        std::swap(m_end, other.m_end);
+        std::swap(m_options, other.m_options);
         return *this;
     }
     ~BigArrayBase() noexcept;
 
+    /* Number of bytes that can be used before the array has to grow */
     size_t byte_capacity() const noexcept { return m_byte_capacity; }
+    /* Number of bytes of memory committed for the elements (the pages they have been written to, or all of the
+       usable bytes if they are committed up front) */
+    size_t bytes_committed() const noexcept;
+    const BigArrayOptions& options() const noexcept { return m_options; }
 protected:
-    void check_has_space(size_t element_size, size_t count = 1) const
+    void check_has_space(size_t element_size, size_t count = 1)
     {
-        if(m_end + element_size * count > m_data + m_byte_capacity) {
-            throw std::runtime_error("BigArray is out of memory");
+        if(element_size * count > (size_t)(m_data + m_byte_capacity - m_end)) {
+            grow(m_end - m_data + element_size * count);
         }
     }
+    /* Makes at least min_byte_capacity bytes usable */
+    void grow(size_t min_byte_capacity);
 
-    size_t m_byte_capacity;
+    size_t m_byte_capacity; /* Bytes that are usable (on some platforms, memory must be committed before use) */
+    size_t m_byte_reserved; /* Bytes of address space reserved */
     char* m_data;
     char* m_end;
+    BigArrayOptions m_options;
 };
 
 } // namespace detail
 
+/* Growable array of trivially destructible elements. Like std::vector, growing may move the elements
+   (invalidating pointers and iterators to them), but their memory is never copied on platforms that can
+   remap pages. Elements are never destroyed. */
 template<typename T>
     requires std::is_trivially_destructible_v<T>
 class BigArray : public detail::BigArrayBase {
@@ -70,9 +120,11 @@ public:
     using iterator = T*;
     using const_iterator = const T*;
 
+    /* capacity is only the number of elements to initially reserve memory for; the array grows as needed.
+       Memory is allocated as described by options, including when the array grows. */
     explicit
-    BigArray(size_t capacity)
-        : BigArrayBase(capacity, sizeof(T)) {}
+    BigArray(size_t capacity, const BigArrayOptions& options = {})
+        : BigArrayBase(capacity, sizeof(T), options) {}
 
     T& push_back(T&& element)
     {
@@ -94,13 +146,16 @@ public:
     template<typename Iterator>
     void append(Iterator first, Iterator limit)
     {
-        check_has_space(sizeof(T), limit - first);
+        check_has_space(sizeof(T), std::distance(first, limit));
         for(auto it = first; it != limit; ++it) {
             new (m_end) T{*it};
             m_end += sizeof(T);
         }
     }
 
+    /* Makes room for at least capacity elements, so that adding elements up to that size does not move them */
+    void reserve(size_t capacity) { check_has_space(sizeof(T), capacity - std::min(capacity, size())); }
+
     iterator       begin() noexcept       { return (T*)m_data; }
     const_iterator begin() const noexcept { return (const T*)m_data; }
     iterator       end() noexcept         { return (T*)m_end; }
@@ -110,4 +165,15 @@ public:
     T&       operator[](size_t index) noexcept       { return begin()[index]; }
     const T& operator[](size_t index) const noexcept { return begin()[index]; }
     size_t size() const noexcept { return end() - begin(); }
+    /* Removes all elements without freeing any memory */
+    void clear() noexcept { m_end = m_data; }
+    /* Removes the elements after the first new_size elements without freeing any memory */
+    void truncate(size_t new_size) noexcept { m_end = m_data + new_size * sizeof(T); }
+    /* Adds back the elements up to new_size that were removed by truncate, which are left as they were in
+       memory (unless they have been overwritten since) */
+    void restore(size_t new_size) noexcept
+    {
+        assert(new_size * sizeof(T) <= m_byte_capacity);
+        m_end = m_data + new_size * sizeof(T);
+    }
 };
\ No newline at end of file
@@ -18,232 +18,2142 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #pragma once
 
 #include <vector>
+#include <array>
 #include <span>
+#include <optional>
 #include <ranges>
 #include <algorithm>
 #include <concepts>
 #include <cstdint>
 #include <cstddef>
+#include <cassert>
+#include <type_traits>
+#include <limits>
+#include <stdexcept>
+#include <memory>
+#include <string_view>
+#include <bit>
 #include "span_list.hpp"
+#include "item_set.hpp"
+#include "item_scan.hpp"
+#include "worker_pool.hpp"
+
+/* Forces a function to be inlined. process_state_set is called once per token and moves the state sets into
+   a local, which is only free once it is inlined into its caller. */
+#if defined(__GNUC__) || defined(__clang__)
+    #define EARLEY_ALWAYS_INLINE [[gnu::always_inline]] inline
+#elif defined(_MSC_VER)
+    #define EARLEY_ALWAYS_INLINE __forceinline
+#else
+    #define EARLEY_ALWAYS_INLINE inline
+#endif
 
 namespace earley {
 
-/* Default implementation of symbol_traits for enum class types containing
-   a Symbol_Count enum member */
-template<std::regular Symbol>
-    requires requires {
-        { static_cast<uint8_t>(Symbol::Symbol_Count) };
+/* Default implementation of symbol_traits for enum class types containing
+   a Symbol_Count enum member */
+template<std::regular Symbol>
+    requires requires {
+        { static_cast<uint8_t>(Symbol::Symbol_Count) };
+    }
+struct symbol_traits {
+    static constexpr auto symbol_count = static_cast<uint8_t>(Symbol::Symbol_Count);
+
+    static constexpr
+    uint8_t to_index(Symbol s) noexcept { return static_cast<uint8_t>(s); }
+};
+
+/* A set of symbols, stored as a bitset indexed by symbol_traits<Symbol>::to_index() */
+template<typename Symbol>
+class SymbolSet {
+public:
+    using SymbolTraits = symbol_traits<Symbol>;
+
+    constexpr
+    void set(size_t sym_index) noexcept { words[sym_index / 64] |= uint64_t{1} << (sym_index % 64); }
+    constexpr
+    void set(Symbol symbol) noexcept { set(SymbolTraits::to_index(symbol)); }
+    constexpr
+    bool test(size_t sym_index) const noexcept { return words[sym_index / 64] & (uint64_t{1} << (sym_index % 64)); }
+    constexpr
+    bool test(Symbol symbol) const noexcept { return test(SymbolTraits::to_index(symbol)); }
+    constexpr
+    void clear() noexcept { std::ranges::fill(words, 0); }
+    /* Returns true if this set and other have at least one symbol in common */
+    constexpr
+    bool intersects(const SymbolSet& other) const noexcept
+    {
+        for(size_t i = 0; i < word_count; ++i) {
+            if(words[i] & other.words[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    constexpr
+    SymbolSet& operator|=(const SymbolSet& other) noexcept
+    {
+        for(size_t i = 0; i < word_count; ++i) {
+            words[i] |= other.words[i];
+        }
+        return *this;
+    }
+
+    constexpr
+    bool operator==(const SymbolSet&) const noexcept = default;
+private:
+    static constexpr size_t word_count = (SymbolTraits::symbol_count + 63) / 64;
+    uint64_t words[word_count]{};
+};
+
+/* How a rule groups with itself (or other rules of the same priority) when an input can be split between
+   them in more than one way, e.g. whether "1-2-3" is "(1-2)-3" (Left) or "1-(2-3)" (Right) */
+enum class Associativity : uint8_t {
+    None, Left, Right
+};
+
+/* Represents a grammar rule where symbol is the left-hand side
+   and components is the right-hand side of the rule. priority and associativity are only used to
+   choose one tree out of an ambiguous parse forest (see ForestTree): when a node has derivations by
+   rules of different priorities, the rule with the lowest priority is the one at the top, so rules with
+   higher priorities bind more tightly (like operator precedence). The recognizer ignores them. */
+template<typename Symbol>
+struct Rule {
+    Symbol symbol;
+    std::vector<Symbol> components;
+    int priority = 0;
+    Associativity associativity = Associativity::None;
+};
+
+/* Layouts of BasicEarleyItem. A layout gives the integer types of an item's fields, which limit the number
+   of rules in the grammar, the number of components in a rule, and the length of the input that items of
+   that layout can be used for, as well as the type of the item offsets of its state sets. The recognizer
+   throws a std::runtime_error instead of parsing a grammar or input that does not fit. */
+
+/* 8-byte items: up to 65536 rules of up to 65535 components, and inputs of up to 2^32 - 1 tokens */
+struct DefaultItemLayout {
+    using rule_index_type = uint16_t;
+    using progress_type = uint16_t;
+    using position_type = uint32_t;
+    using item_offset_type = uint32_t;
+};
+
+/* 4-byte items: up to 256 rules of up to 255 components, and inputs of up to 65535 tokens */
+struct CompactItemLayout {
+    using rule_index_type = uint8_t;
+    using progress_type = uint8_t;
+    using position_type = uint16_t;
+    using item_offset_type = uint32_t;
+};
+
+/* 16-byte items: up to 2^32 rules, and inputs (and state sets) of up to 2^64 - 1 tokens (and items) */
+struct WideItemLayout {
+    using rule_index_type = uint32_t;
+    using progress_type = uint32_t;
+    using position_type = uint64_t;
+    using item_offset_type = uint64_t;
+};
+
+/* Represents a match (partial or complete) of a particular rule starting at a particular
+   position in the input. */
+template<typename Layout = DefaultItemLayout>
+struct BasicEarleyItem {
+    using layout_type = Layout;
+    using rule_index_type = typename Layout::rule_index_type;
+    using progress_type = typename Layout::progress_type;
+    using position_type = typename Layout::position_type;
+    using span_offset_type = typename Layout::item_offset_type; /* Used by SpanList */
+
+    explicit constexpr
+    BasicEarleyItem(rule_index_type rule_idx, position_type start_pos, progress_type progress = 0)
+        : rule_idx(rule_idx), progress(progress), start_pos(start_pos) {}
+
+    /* Returns this item with its dividing point moved past its next unmatched component */
+    constexpr
+    BasicEarleyItem advanced() const noexcept { return BasicEarleyItem(rule_idx, start_pos, (progress_type)(progress + 1)); }
+
+    constexpr
+    bool operator==(const BasicEarleyItem&) const noexcept = default;
+
+    rule_index_type rule_idx; /* Index of the rule that is being matched */
+    progress_type progress;   /* Dividing point between this item's matched/unmatched components */
+    position_type start_pos;  /* Where in input this match starts */
+};
+
+using EarleyItem = BasicEarleyItem<DefaultItemLayout>;
+using CompactEarleyItem = BasicEarleyItem<CompactItemLayout>;
+using WideEarleyItem = BasicEarleyItem<WideItemLayout>;
+
+/* A rule with a dividing point (the 'dot') between its matched and unmatched components, also known
+   as an LR(0) item. RuleSet precomputes one of these for every possible dividing point of every rule
+   so the recognizer can look up everything it needs about an Earley item in one place. */
+template<typename Symbol>
+struct DottedRule {
+    Symbol symbol{};            /* Left-hand side of the rule */
+    Symbol next_symbol{};       /* Next unmatched component (only meaningful if !is_completed) */
+    bool is_completed = false;  /* True if all components are matched */
+    bool next_is_terminal = false;
+    bool next_is_nullable = false;
+};
+
+/* A dotted rule (by rule index and dividing point) that is added to the state set, with the current
+   position as its origin, when a symbol is predicted */
+struct PredictedItem {
+    uint32_t rule_idx = 0;
+    uint32_t progress = 0;
+};
+
+/* A range [first, limit) of indices into one of the tables of a RuleSet */
+struct TableSpan {
+    uint32_t first = 0;
+    uint32_t limit = 0;
+};
+
+/* Represents a grammar and associated data structures. All interactions
+   with the grammar should take place through this object. A RuleSet is not modified after it is
+   constructed: the recognizer only uses it through a const reference (see Grammar) and it has no mutable
+   members, so one RuleSet can be shared by any number of threads parsing at the same time
+   (see parse_batch).
+
+   Useless rules (ones that cannot derive a string of terminals, or whose symbol cannot be reached from
+   start_symbol) are never predicted, so their items are never added past the first state set. If start_symbol
+   is given, parsing any other start symbol with this RuleSet can miss matches. */
+template<typename Symbol>
+struct RuleSet {
+    using index_range = std::ranges::iota_view<uint32_t, uint32_t>;
+    using SymbolTraits = symbol_traits<Symbol>;
+    static constexpr auto symbol_count = SymbolTraits::symbol_count;
+
+    explicit constexpr
+    RuleSet(std::span<const Rule<Symbol>> rules, std::optional<std::type_identity_t<Symbol>> start_symbol = std::nullopt)
+        requires requires(Symbol s) { { is_terminal(s) } -> std::same_as<bool>; }
+        : rules(rules)
+    {
+        // Assumes rules are grouped by symbol
+        auto progress = rules.begin();
+        while(progress != rules.end()) {
+            auto symbol = progress->symbol;
+            auto start_idx = (uint32_t)(progress - rules.begin());
+            progress = std::ranges::find_if_not(progress + 1, rules.end(), [symbol](auto s) { return s == symbol; }, &Rule<Symbol>::symbol);
+            rule_spans[SymbolTraits::to_index(symbol)] = {start_idx, (uint32_t)(progress - rules.begin())};
+        }
+
+        // Index the rules that each symbol occurs in (once per occurrence), then find the nullable and
+        //  productive symbols
+        std::vector<uint32_t> occurrence_offsets(SymbolTraits::symbol_count + 1);
+        for(const auto& rule : rules) {
+            for(auto component : rule.components) {
+                ++occurrence_offsets[SymbolTraits::to_index(component) + 1];
+            }
+        }
+        for(size_t sym_index = 0; sym_index < SymbolTraits::symbol_count; ++sym_index) {
+            occurrence_offsets[sym_index + 1] += occurrence_offsets[sym_index];
+        }
+        std::vector<uint32_t> occurrences(occurrence_offsets.back());
+        {
+            auto next_occurrence = occurrence_offsets;
+            for(uint32_t rule_idx = 0; rule_idx < rules.size(); ++rule_idx) {
+                for(auto component : rules[rule_idx].components) {
+                    occurrences[next_occurrence[SymbolTraits::to_index(component)]++] = rule_idx;
+                }
+            }
+        }
+        mark_derivable(nullable, occurrence_offsets, occurrences);
+        for(const auto& rule : rules) {
+            for(auto component : rule.components) {
+                productive[SymbolTraits::to_index(component)] |= is_terminal(component);
+            }
+        }
+        auto unproductive_counts = mark_derivable(productive, occurrence_offsets, occurrences);
+
+        // Find the symbols that can be reached from the start symbol through productive rules. A rule is only
+        //  useful (and only predicted) if it is productive and its symbol is reachable.
+        if(start_symbol) {
+            std::vector<Symbol> worklist{*start_symbol};
+            reachable[SymbolTraits::to_index(*start_symbol)] = true;
+            while(!worklist.empty()) {
+                auto symbol = worklist.back();
+                worklist.pop_back();
+                for(auto rule_idx : (*this)[symbol]) {
+                    if(unproductive_counts[rule_idx] != 0) {
+                        continue;
+                    }
+                    for(auto component : rules[rule_idx].components) {
+                        if(!reachable[SymbolTraits::to_index(component)]) {
+                            reachable[SymbolTraits::to_index(component)] = true;
+                            worklist.push_back(component);
+                        }
+                    }
+                }
+            }
+        } else {
+            std::ranges::fill(reachable, true);
+        }
+        useful_rules.resize(rules.size());
+        for(size_t rule_idx = 0; rule_idx < rules.size(); ++rule_idx) {
+            useful_rules[rule_idx] = unproductive_counts[rule_idx] == 0 && reachable[SymbolTraits::to_index(rules[rule_idx].symbol)];
+        }
+
+        // Lay out the dotted rules of each rule contiguously, in rule order
+        rule_offsets.reserve(rules.size() + 1);
+        for(const auto& rule : rules) {
+            max_rule_size = std::max(max_rule_size, (uint32_t)rule.components.size());
+            rule_offsets.push_back((uint32_t)dotted_rules.size());
+            for(auto component : rule.components) {
+                dotted_rules.push_back({rule.symbol, component, false, is_terminal(component), is_nullable(component)});
+            }
+            dotted_rules.push_back({rule.symbol, rule.symbol, true, false, false});
+        }
+        rule_offsets.push_back((uint32_t)dotted_rules.size());
+
+        // Compute the prediction closure of each symbol: every dotted rule that ends up in the state set
+        //  (starting at the current position) after predicting the symbol, including the nullable advances
+        std::vector<uint8_t> in_closure(dotted_rules.size());
+        for(size_t sym_index = 0; sym_index < SymbolTraits::symbol_count; ++sym_index) {
+            auto first = (uint32_t)prediction_items.size();
+            std::ranges::fill(in_closure, 0);
+            auto add_to_closure = [&](uint32_t rule_idx, uint32_t progress) {
+                auto& added = in_closure[rule_offsets[rule_idx] + progress];
+                if(!added) {
+                    added = true;
+                    prediction_items.push_back({rule_idx, progress});
+                }
+            };
+            predicted_symbol_sets[sym_index].set(sym_index);
+            for(auto rule_idx : rule_spans[sym_index]) {
+                if(useful_rules[rule_idx]) {
+                    add_to_closure(rule_idx, 0);
+                }
+            }
+            for(size_t i = first; i < prediction_items.size(); ++i) {
+                auto predicted_item = prediction_items[i];
+                const auto& dotted = dotted_rules[rule_offsets[predicted_item.rule_idx] + predicted_item.progress];
+                if(dotted.is_completed || dotted.next_is_terminal) {
+                    continue;
+                }
+                // The rules of each symbol only need to be added to the closure once
+                if(!predicted_symbol_sets[sym_index].test(dotted.next_symbol)) {
+                    predicted_symbol_sets[sym_index].set(dotted.next_symbol);
+                    for(auto rule_idx : (*this)[dotted.next_symbol]) {
+                        if(useful_rules[rule_idx]) {
+                            add_to_closure(rule_idx, 0);
+                        }
+                    }
+                }
+                if(dotted.next_is_nullable) {
+                    add_to_closure(predicted_item.rule_idx, predicted_item.progress + 1);
+                }
+            }
+            prediction_spans[sym_index] = {first, (uint32_t)prediction_items.size()};
+        }
+
+        // Compute FIRST sets (the terminals that can begin each symbol) and find all terminals
+        for(const auto& dotted : dotted_rules) {
+            if(!dotted.is_completed && dotted.next_is_terminal && !first_sets[SymbolTraits::to_index(dotted.next_symbol)].test(dotted.next_symbol)) {
+                first_sets[SymbolTraits::to_index(dotted.next_symbol)].set(dotted.next_symbol);
+                terminals.push_back(dotted.next_symbol);
+            }
+        }
+        bool at_fixpoint;
+        do {
+            at_fixpoint = true;
+            for(size_t rule_idx = 0; rule_idx < rules.size(); ++rule_idx) {
+                if(!useful_rules[rule_idx]) {
+                    continue;
+                }
+                const auto& rule = rules[rule_idx];
+                auto& rule_first = first_sets[SymbolTraits::to_index(rule.symbol)];
+                for(auto component : rule.components) {
+                    auto new_first = rule_first;
+                    new_first |= first_sets[SymbolTraits::to_index(component)];
+                    if(new_first != rule_first) {
+                        rule_first = new_first;
+                        at_fixpoint = false;
+                    }
+                    if(!is_nullable(component)) {
+                        break;
+                    }
+                }
+            }
+        } while(!at_fixpoint);
+
+        // Compute FOLLOW sets (the terminals that can come right after each symbol) and the
+        //  FIRST set of the unmatched part of each dotted rule
+        std::vector<uint8_t> suffix_nullable(dotted_rules.size());
+        suffix_first_sets.resize(dotted_rules.size());
+        for(size_t rule_idx = 0; rule_idx < rules.size(); ++rule_idx) {
+            auto offset = rule_offsets[rule_idx];
+            const auto& components = rules[rule_idx].components;
+            suffix_nullable[offset + components.size()] = true;
+            for(size_t i = components.size(); i-- > 0;) {
+                suffix_first_sets[offset + i] = first_sets[SymbolTraits::to_index(components[i])];
+                if(is_nullable(components[i])) {
+                    suffix_first_sets[offset + i] |= suffix_first_sets[offset + i + 1];
+                    suffix_nullable[offset + i] = suffix_nullable[offset + i + 1];
+                }
+            }
+        }
+        do {
+            at_fixpoint = true;
+            for(size_t rule_idx = 0; rule_idx < rules.size(); ++rule_idx) {
+                if(!useful_rules[rule_idx]) {
+                    continue;
+                }
+                auto offset = rule_offsets[rule_idx];
+                const auto& rule = rules[rule_idx];
+                for(size_t i = 0; i < rule.components.size(); ++i) {
+                    auto& component_follow = follow_sets[SymbolTraits::to_index(rule.components[i])];
+                    auto new_follow = component_follow;
+                    new_follow |= suffix_first_sets[offset + i + 1];
+                    if(suffix_nullable[offset + i + 1]) {
+                        new_follow |= follow_sets[SymbolTraits::to_index(rule.symbol)];
+                    }
+                    if(new_follow != component_follow) {
+                        component_follow = new_follow;
+                        at_fixpoint = false;
+                    }
+                }
+            }
+        } while(!at_fixpoint);
+
+        // A dotted rule can only lead to a match of the next token if that token is in the FIRST set of
+        //  its unmatched part, or in the FOLLOW set of its rule's symbol if the unmatched part is nullable
+        lookahead_sets = suffix_first_sets;
+        for(size_t rule_idx = 0; rule_idx < rules.size(); ++rule_idx) {
+            for(auto i = rule_offsets[rule_idx]; i < rule_offsets[rule_idx + 1]; ++i) {
+                if(suffix_nullable[i]) {
+                    lookahead_sets[i] |= follow_sets[SymbolTraits::to_index(rules[rule_idx].symbol)];
+                }
+            }
+        }
+    }
+
+    /* Returns a range of indices [A, B) such that A is the index of the first rule in rules with rule_sym as
+       its symbol and B is the index of the rule one past F, where F is the final rule in the grammar with
+       rule_sym as its symbol. */
+    constexpr
+    index_range operator[](Symbol rule_sym) const noexcept { return rule_spans[SymbolTraits::to_index(rule_sym)]; }
+
+    constexpr
+    bool is_nullable(Symbol rule_sym) const noexcept { return nullable[SymbolTraits::to_index(rule_sym)]; }
+
+    /* Returns the index of item's dotted rule in dotted_rules. Every dividing point of every rule
+       has a distinct index. */
+    template<typename Layout>
+    constexpr
+    uint32_t dotted_rule_index(BasicEarleyItem<Layout> item) const noexcept { return rule_offsets[item.rule_idx] + item.progress; }
+
+    template<typename Layout>
+    constexpr
+    const DottedRule<Symbol>& dotted_rule(BasicEarleyItem<Layout> item) const noexcept { return dotted_rules[dotted_rule_index(item)]; }
+
+    /* Returns the items that are added to the state set when rule_sym is predicted. This includes the items
+       predicted by those items (and so on) and the advances past nullable symbols of all of them. */
+    constexpr
+    std::span<const PredictedItem> prediction(Symbol rule_sym) const noexcept
+    {
+        auto span = prediction_spans[SymbolTraits::to_index(rule_sym)];
+        return {prediction_items.data() + span.first, prediction_items.data() + span.limit};
+    }
+
+    /* Returns the set of symbols that are predicted when rule_sym is predicted (including rule_sym). The
+       prediction of each of these symbols is a subset of the prediction of rule_sym. */
+    constexpr
+    const SymbolSet<Symbol>& predicted_symbols(Symbol rule_sym) const noexcept
+    {
+        return predicted_symbol_sets[SymbolTraits::to_index(rule_sym)];
+    }
+
+    /* Returns the set of terminals that the next token must be one of for item to be part of a match
+       that continues past the next token. */
+    template<typename Layout>
+    constexpr
+    const SymbolSet<Symbol>& lookahead_set(BasicEarleyItem<Layout> item) const noexcept { return lookahead_sets[dotted_rule_index(item)]; }
+
+    constexpr
+    const SymbolSet<Symbol>& first_set(Symbol symbol) const noexcept { return first_sets[SymbolTraits::to_index(symbol)]; }
+
+    constexpr
+    const SymbolSet<Symbol>& follow_set(Symbol symbol) const noexcept { return follow_sets[SymbolTraits::to_index(symbol)]; }
+
+    /* Returns true if symbol derives a string of terminals (including the empty string) */
+    constexpr
+    bool is_productive(Symbol symbol) const noexcept { return productive[SymbolTraits::to_index(symbol)]; }
+
+    /* Returns true if symbol can be reached from the start symbol (always true if none was given) */
+    constexpr
+    bool is_reachable(Symbol symbol) const noexcept { return reachable[SymbolTraits::to_index(symbol)]; }
+
+    /* Returns true if the rule at rule_idx can be part of a match of the start symbol */
+    constexpr
+    bool is_useful(size_t rule_idx) const noexcept { return useful_rules[rule_idx]; }
+
+    std::span<const Rule<Symbol>> rules; /* The rules of the grammar */
+    uint32_t max_rule_size = 0; /* Number of components in the longest rule */
+    index_range rule_spans[SymbolTraits::symbol_count]{};
+    bool nullable[SymbolTraits::symbol_count]{};
+    std::vector<DottedRule<Symbol>> dotted_rules; /* The dotted rules of every rule, grouped by rule */
+    std::vector<uint32_t> rule_offsets; /* Index in dotted_rules of each rule's first dotted rule */
+    std::vector<PredictedItem> prediction_items; /* The prediction closures of every symbol, grouped by symbol */
+    TableSpan prediction_spans[SymbolTraits::symbol_count]{};
+    SymbolSet<Symbol> predicted_symbol_sets[SymbolTraits::symbol_count]{};
+    std::vector<Symbol> terminals; /* Every terminal used in the grammar */
+    SymbolSet<Symbol> first_sets[SymbolTraits::symbol_count]{};
+    SymbolSet<Symbol> follow_sets[SymbolTraits::symbol_count]{};
+    std::vector<SymbolSet<Symbol>> suffix_first_sets; /* FIRST set of the unmatched part of each dotted rule */
+    std::vector<SymbolSet<Symbol>> lookahead_sets;    /* lookahead_set() of each dotted rule */
+    bool productive[SymbolTraits::symbol_count]{}; /* is_productive() of each symbol */
+    bool reachable[SymbolTraits::symbol_count]{};  /* is_reachable() of each symbol */
+    std::vector<uint8_t> useful_rules; /* is_useful() of each rule */
+private:
+    /* Marks every symbol that has a rule whose components are all marked, repeating until no more symbols can
+       be marked, in time linear in the size of the grammar (Aycock and Horspool, 2002): each rule counts its
+       unmarked components, and marking a symbol decrements the counts of the rules it occurs in. Returns the
+       number of unmarked components of each rule. */
+    constexpr
+    std::vector<uint32_t> mark_derivable(bool (&marked)[SymbolTraits::symbol_count], const std::vector<uint32_t>& occurrence_offsets,
+                                         const std::vector<uint32_t>& occurrences) const
+    {
+        std::vector<uint32_t> unmarked_counts(rules.size());
+        std::vector<uint32_t> worklist;
+        for(uint32_t sym_index = 0; sym_index < SymbolTraits::symbol_count; ++sym_index) {
+            if(marked[sym_index]) {
+                worklist.push_back(sym_index);
+            }
+        }
+        auto mark = [&](Symbol symbol) {
+            auto sym_index = SymbolTraits::to_index(symbol);
+            if(!marked[sym_index]) {
+                marked[sym_index] = true;
+                worklist.push_back(sym_index);
+            }
+        };
+        for(size_t rule_idx = 0; rule_idx < rules.size(); ++rule_idx) {
+            unmarked_counts[rule_idx] = (uint32_t)rules[rule_idx].components.size();
+            if(unmarked_counts[rule_idx] == 0) {
+                mark(rules[rule_idx].symbol);
+            }
+        }
+        while(!worklist.empty()) {
+            auto sym_index = worklist.back();
+            worklist.pop_back();
+            for(auto i = occurrence_offsets[sym_index]; i < occurrence_offsets[sym_index + 1]; ++i) {
+                auto rule_idx = occurrences[i];
+                if(--unmarked_counts[rule_idx] == 0) {
+                    mark(rules[rule_idx].symbol);
+                }
+            }
+        }
+        return unmarked_counts;
+    }
+};
+
+/* A grammar with precomputed tables that the recognizer can run on, such as a RuleSet or a StaticRuleSet.
+   The recognizer only reads it through a const reference. */
+template<typename RuleSetType, typename Symbol>
+concept Grammar = requires(const RuleSetType& rule_set, Symbol symbol, EarleyItem item) {
+    { rule_set[symbol] } -> std::convertible_to<std::ranges::iota_view<uint32_t, uint32_t>>;
+    { rule_set.is_nullable(symbol) } -> std::same_as<bool>;
+    { rule_set.dotted_rule(item) } -> std::same_as<const DottedRule<Symbol>&>;
+    { rule_set.dotted_rules.data() } -> std::same_as<const DottedRule<Symbol>*>;
+    { rule_set.rule_offsets.data() } -> std::same_as<const uint32_t*>;
+    { rule_set.max_rule_size } -> std::convertible_to<size_t>;
+    { rule_set.prediction(symbol) } -> std::convertible_to<std::span<const PredictedItem>>;
+    { rule_set.predicted_symbols(symbol) } -> std::same_as<const SymbolSet<Symbol>&>;
+    { rule_set.lookahead_set(item) } -> std::same_as<const SymbolSet<Symbol>&>;
+    { *std::ranges::begin(rule_set.terminals) } -> std::convertible_to<Symbol>;
+};
+
+/* A transitive item (Leo, 1991) in a state set S(j). It memoizes the topmost item of the deterministic
+   reduction path followed whenever an item for its symbol completes with origin j, so the recognizer can
+   add that topmost item directly instead of completing every item along the path. This makes right
+   recursion run in linear time. */
+template<typename Item = EarleyItem>
+struct BasicLeoItem {
+    using span_offset_type = typename Item::span_offset_type;
+
+    explicit constexpr
+    BasicLeoItem(uint32_t symbol_index, Item top)
+        : symbol_index(symbol_index), top(top) {}
+
+    uint32_t symbol_index; /* symbol_traits<Symbol>::to_index() of the completed symbol */
+    Item top;              /* The completed item at the top of the reduction path */
+};
+
+using LeoItem = BasicLeoItem<EarleyItem>;
+
+template<typename Item>
+using BasicStateSetIterator = SpanListIterator<Item>;
+using StateSetIterator = BasicStateSetIterator<EarleyItem>;
+
+template<typename Item>
+using BasicEarleyItemIterator = typename std::span<const Item>::iterator;
+using EarleyItemIterator = BasicEarleyItemIterator<EarleyItem>;
+
+/* Returns true if the item is complete. Note that rule_comp_count
+   is assumed to equal rule.components.size(), where rule is the
+   Rule corresponding to item.rule_idx. */
+template<typename Layout>
+constexpr
+bool is_completed(BasicEarleyItem<Layout> item, size_t rule_comp_count)
+{
+    return item.progress == rule_comp_count;
+}
+
+/* Look ahead at the next unmatched component of a rule */
+template<typename Symbol, typename Layout>
+constexpr
+Symbol next_symbol(const Rule<Symbol>& rule, BasicEarleyItem<Layout> item)
+{
+    return rule.components[item.progress];
+}
+
+/* Returns true if the given item already exists in the given state set. Contiguous state sets are
+   scanned several items at a time (see item_scan.hpp). */
+template<typename Layout>
+constexpr
+bool item_exists(const std::ranges::forward_range auto& state_set, BasicEarleyItem<Layout> item)
+{
+    using Item = BasicEarleyItem<Layout>;
+    if constexpr(std::ranges::contiguous_range<decltype(state_set)> && detail::ScannableItem<Item>) {
+        if(!std::is_constant_evaluated()) {
+            const Item* first = std::ranges::data(state_set);
+            const Item* last = first + std::ranges::size(state_set);
+            return detail::find_item(first, last, item) != last;
+        }
+    }
+    return std::ranges::find(state_set, item) != state_set.end();
+}
+
+/* Counts of the work done by the recognizer, collected by the overloads of parse that take a ParseStats
+   (the other overloads do no counting). Counts add up over parses until reset is called. */
+struct ParseStats {
+    /* Counts for the items of one rule */
+    struct RuleCounts {
+        uint64_t items = 0;       /* Items added to state sets */
+        uint64_t duplicates = 0;  /* Items not added because they were already in their state set */
+        uint64_t completions = 0; /* Completed items processed */
+    };
+
+    /* If count_rules is true, rule_counts is filled in too */
+    explicit
+    ParseStats(bool count_rules = false) : count_rules(count_rules) {}
+
+    uint64_t state_sets = 0;
+    uint64_t predictions = 0;       /* Items predicted (including ones that were already in the state set) */
+    uint64_t completions = 0;       /* Items advanced by completing an item (including through Leo items) */
+    uint64_t nullable_advances = 0; /* Items advanced over a nullable symbol */
+    uint64_t scans = 0;             /* Items advanced by matching a token */
+    uint64_t duplicates = 0;        /* Items not added because they were already in their state set */
+    uint64_t max_state_set_size = 0;
+    uint64_t peak_items = 0;        /* Largest num_of_items() of the state sets */
+    uint64_t peak_bytes_committed = 0; /* Largest amount of memory committed for the items of the state sets */
+    /* Number of state sets with s items, where bit_width(s) is the index (so index i > 0 counts the
+       sizes in [2^(i-1), 2^i)) */
+    std::vector<uint64_t> state_set_size_histogram;
+    /* Counts for each rule, indexed by rule index (empty unless count_rules is true) */
+    std::vector<RuleCounts> rule_counts;
+    bool count_rules;
+
+    /* Calls callback(name, value) for each total count, e.g. to export them as metrics */
+    template<typename Callback>
+    void for_each_counter(Callback&& callback) const
+    {
+        callback(std::string_view{"state_sets"}, state_sets);
+        callback(std::string_view{"predictions"}, predictions);
+        callback(std::string_view{"completions"}, completions);
+        callback(std::string_view{"nullable_advances"}, nullable_advances);
+        callback(std::string_view{"scans"}, scans);
+        callback(std::string_view{"duplicates"}, duplicates);
+        callback(std::string_view{"max_state_set_size"}, max_state_set_size);
+        callback(std::string_view{"peak_items"}, peak_items);
+        callback(std::string_view{"peak_bytes_committed"}, peak_bytes_committed);
+    }
+
+    void reset() noexcept
+    {
+        *this = ParseStats{count_rules};
+    }
+
+    /* The functions below are called by the recognizer */
+
+    void start_parse(size_t rule_count)
+    {
+        if(count_rules && rule_counts.size() < rule_count) {
+            rule_counts.resize(rule_count);
+        }
+    }
+
+    void add_state_set(size_t size, size_t num_of_items, size_t bytes_committed)
+    {
+        ++state_sets;
+        max_state_set_size = std::max<uint64_t>(max_state_set_size, size);
+        peak_items = std::max<uint64_t>(peak_items, num_of_items);
+        peak_bytes_committed = std::max<uint64_t>(peak_bytes_committed, bytes_committed);
+        size_t bucket = std::bit_width(size);
+        if(bucket >= state_set_size_histogram.size()) {
+            state_set_size_histogram.resize(bucket + 1);
+        }
+        ++state_set_size_histogram[bucket];
+    }
+
+    void add_item(uint32_t rule_idx, bool was_added)
+    {
+        if(!was_added) {
+            ++duplicates;
+        }
+        if(count_rules) {
+            ++(was_added ? rule_counts[rule_idx].items : rule_counts[rule_idx].duplicates);
+        }
+    }
+
+    void add_completed_item(uint32_t rule_idx)
+    {
+        if(count_rules) {
+            ++rule_counts[rule_idx].completions;
+        }
+    }
+};
+
+namespace detail {
+
+/* Stats argument of the recognizer when nothing is counted */
+struct NoStats {};
+
+/* Calls on_exit when it goes out of scope, including when an exception is thrown */
+template<typename OnExit>
+class ScopeExit {
+public:
+    explicit
+    ScopeExit(OnExit on_exit) : m_on_exit(std::move(on_exit)) {}
+    ScopeExit(const ScopeExit&) = delete;
+    ScopeExit& operator=(const ScopeExit&) = delete;
+    ~ScopeExit() { m_on_exit(); }
+private:
+    OnExit m_on_exit;
+};
+
+/* Maps (state set, nonterminal) pairs to the items in that state set whose next unmatched
+   component is that nonterminal, so the completer only has to visit the items that a newly
+   completed item can actually advance. State sets are indexed on demand, and only once no more
+   items will be added to them. */
+template<typename Symbol>
+class WaitingIndex {
+public:
+    using SymbolTraits = symbol_traits<Symbol>;
+
+    bool is_indexed(size_t set_pos) const noexcept
+    {
+        return set_pos < set_runs.size() && set_runs[set_pos].begin != unindexed;
+    }
+
+    /* Indexes state_set, the state set at position set_pos */
+    template<typename Item>
+    void add_state_set(const Grammar<Symbol> auto& rule_set, size_t set_pos, std::span<const Item> state_set)
+    {
+        add_state_set(set_pos, state_set, [&rule_set](Item item, auto&& visit) {
+            const auto& dotted = rule_set.dotted_rule(item);
+            if(!dotted.is_completed && !dotted.next_is_terminal) {
+                visit(SymbolTraits::to_index(dotted.next_symbol));
+            }
+        });
+    }
+
+    /* Indexes state_set by the symbols that its items wait on, where for_each_waiting(item, visit) calls
+       visit(symbol index) for each symbol that item waits on (e.g. for items that are not Earley items) */
+    template<typename Item, typename ForEachWaiting>
+    void add_state_set(size_t set_pos, std::span<const Item> state_set, ForEachWaiting&& for_each_waiting)
+    {
+        // Counting sort of the waiting items by their next symbol (stable, so items waiting
+        //  on the same symbol stay in state set order)
+        std::ranges::fill(symbol_counts, 0);
+        for(auto item : state_set) {
+            for_each_waiting(item, [this](uint32_t sym_index) { ++symbol_counts[sym_index]; });
+        }
+        if(set_pos >= set_runs.size()) {
+            set_runs.resize(set_pos + 1, {unindexed, unindexed});
+        }
+        set_runs[set_pos].begin = (uint32_t)runs.size();
+        auto offset = (uint32_t)item_offsets.size();
+        for(uint32_t sym_index = 0; sym_index < SymbolTraits::symbol_count; ++sym_index) {
+            if(symbol_counts[sym_index] > 0) {
+                runs.push_back({sym_index, offset, offset + symbol_counts[sym_index]});
+                symbol_counts[sym_index] = offset;
+                offset = runs.back().end;
+            }
+        }
+        set_runs[set_pos].end = (uint32_t)runs.size();
+        item_offsets.resize(offset);
+        for(uint32_t item_offset = 0; item_offset < state_set.size(); ++item_offset) {
+            for_each_waiting(state_set[item_offset], [&](uint32_t sym_index) {
+                item_offsets[symbol_counts[sym_index]++] = item_offset;
+            });
+        }
+    }
+
+    /* Returns the offsets (relative to the start of the state set) of the items in the (indexed)
+       state set at set_pos that are waiting on symbol */
+    std::span<const uint32_t> waiting_on(size_t set_pos, Symbol symbol) const noexcept
+    {
+        return waiting_on_index(set_pos, SymbolTraits::to_index(symbol));
+    }
+
+    /* Same as waiting_on, by symbol index */
+    std::span<const uint32_t> waiting_on_index(size_t set_pos, uint32_t sym_index) const noexcept
+    {
+        auto first_run = runs.begin() + set_runs[set_pos].begin;
+        auto limit_run = runs.begin() + set_runs[set_pos].end;
+        auto run = std::ranges::lower_bound(first_run, limit_run, sym_index, {}, &Run::symbol_index);
+        if(run == limit_run || run->symbol_index != sym_index) {
+            return {};
+        }
+        return {item_offsets.begin() + run->begin, item_offsets.begin() + run->end};
+    }
+
+    /* Removes all state sets from the index without freeing any memory */
+    void clear() noexcept
+    {
+        item_offsets.clear();
+        runs.clear();
+        set_runs.clear();
+    }
+private:
+    static constexpr uint32_t unindexed = UINT32_MAX;
+
+    struct Run {
+        uint32_t symbol_index;
+        uint32_t begin; /* Range in item_offsets of the items waiting on the symbol */
+        uint32_t end;
+    };
+    struct RunRange {
+        uint32_t begin; /* Range in runs of the runs belonging to a state set */
+        uint32_t end;
+    };
+
+    std::vector<uint32_t> item_offsets;
+    std::vector<Run> runs;
+    std::vector<RunRange> set_runs;
+    uint32_t symbol_counts[SymbolTraits::symbol_count]{};
+};
+
+/* Returns the Leo item for the symbol with the given index in leo_set, or nullptr if there is none */
+template<typename Item>
+constexpr
+const BasicLeoItem<Item>* find_leo_item(std::span<const BasicLeoItem<Item>> leo_set, uint32_t symbol_index) noexcept
+{
+    // Leo items in a state set are sorted by symbol index
+    auto leo_item = std::ranges::lower_bound(leo_set, symbol_index, {}, &BasicLeoItem<Item>::symbol_index);
+    if(leo_item == leo_set.end() || leo_item->symbol_index != symbol_index) {
+        return nullptr;
+    }
+    return &*leo_item;
+}
+
+/* Adds the Leo items for the state set at set_pos, which must be complete, as the next span of
+   leo_items. A symbol gets a Leo item when exactly one item in the state set is waiting on it and
+   that item's rule ends with the symbol. */
+template<typename Symbol, typename Item>
+void add_leo_items(const Grammar<Symbol> auto& rule_set, const SpanList<Item>& state_sets, size_t set_pos,
+                   SpanList<BasicLeoItem<Item>>& leo_items)
+{
+    using SymbolTraits = symbol_traits<Symbol>;
+    uint32_t waiting_counts[SymbolTraits::symbol_count]{};
+    const Item* waiting_items[SymbolTraits::symbol_count];
+    for(const auto& item : state_sets[set_pos]) {
+        const auto& dotted = rule_set.dotted_rule(item);
+        if(!dotted.is_completed && !dotted.next_is_terminal) {
+            auto sym_index = SymbolTraits::to_index(dotted.next_symbol);
+            ++waiting_counts[sym_index];
+            waiting_items[sym_index] = &item;
+        }
+    }
+
+    leo_items.add_span();
+    for(uint32_t sym_index = 0; sym_index < SymbolTraits::symbol_count; ++sym_index) {
+        if(waiting_counts[sym_index] != 1) {
+            continue;
+        }
+        auto item = *waiting_items[sym_index];
+        Item top = item.advanced();
+        const auto& top_dotted = rule_set.dotted_rule(top);
+        if(!top_dotted.is_completed) {
+            continue;
+        }
+        // Continue up the reduction path if the parent item's origin has its own Leo item. Only
+        //  earlier state sets are followed, since the Leo items of this state set are still being added.
+        if(item.start_pos < set_pos) {
+            if(auto* parent_leo = find_leo_item(leo_items[item.start_pos], SymbolTraits::to_index(top_dotted.symbol))) {
+                top = parent_leo->top;
+            }
+        }
+        leo_items.emplace_back(sym_index, top);
+    }
+}
+
+/* Lookahead mode of parse where no lookahead is done (and terminals are matched with matches_terminal) */
+struct NoLookahead {
+    static constexpr bool filters_predictions = false;
+};
+
+/* Forest argument of recognize when no parse forest is built */
+struct NoForest {};
+
+/* Token type of process_state_set at the end of the input */
+struct EndOfInput {};
+
+/* Throws if items of type Item cannot represent every rule of rule_set */
+template<typename Item>
+void check_item_layout(const auto& rule_set)
+{
+    size_t rule_count = rule_set.rule_offsets.size() - 1;
+    if(rule_count > (size_t)std::numeric_limits<typename Item::rule_index_type>::max() + 1) {
+        throw std::runtime_error("Grammar has too many rules for the item layout");
+    }
+    if(rule_set.max_rule_size > std::numeric_limits<typename Item::progress_type>::max()) {
+        throw std::runtime_error("Grammar has a rule with too many components for the item layout");
+    }
+}
+
+/* State sets of at least this size are searched with a hash set instead of linearly */
+inline constexpr size_t min_hashed_set_size = 32;
+/* Earlier state sets of at least this size are searched with a WaitingIndex when completing */
+inline constexpr size_t min_indexed_set_size = 32;
+/* Rounds with fewer completions than this are completed on one thread */
+inline constexpr size_t min_parallel_completions = 64;
+
+/* The items that complete_round found by advancing the items waiting on one completed item */
+struct RoundCompletion {
+    size_t item_offset; /* Offset of the completed item in the current state set */
+    size_t worker;      /* Index of the buffer holding the advanced items */
+    size_t first;       /* Range of the advanced items in that buffer */
+    size_t limit;
+};
+
+/* Buffers that the recognizer only needs while it is running */
+template<typename Symbol, typename Item = EarleyItem>
+struct ParseScratch {
+    /* Offsets of the items of the current state set that match the current token */
+    std::vector<typename Item::span_offset_type> scanned_offsets;
+    /* Items in the current state set, for duplicate checks once the state set is too large
+       to search linearly (reused for each state set) */
+    ItemSet<Item> curr_items;
+    /* Items waiting on each nonterminal in previous state sets too large to search linearly */
+    WaitingIndex<Symbol> waiting_items;
+    /* If set, the completions of large state sets are found on these threads (see complete_round) */
+    WorkerPool* workers = nullptr;
+    /* Completed items of the current round (used only if workers is set) */
+    std::vector<RoundCompletion> round_completions;
+    /* Items advanced by the completions of the current round, one buffer per worker */
+    std::vector<std::vector<Item>> worker_items;
+
+    void clear() noexcept
+    {
+        scanned_offsets.clear();
+        curr_items.clear();
+        waiting_items.clear();
+        round_completions.clear();
+    }
+};
+
+/* Removes the items of the state sets that the recognizer can no longer use, so that their memory can be
+   reused by new items (see Recognizer::set_reclaim_state_sets) */
+template<typename Item>
+class StateSetReclaimer {
+public:
+    /* Reclaiming takes time linear in the live items and in the state sets looked at. If amortize_sets is
+       false, the state sets are reclaimed again once the live items have doubled, which keeps the items
+       bounded by the live ones but can take time quadratic in the input size when an early state set stays
+       live (e.g. the first one, for Stream -> Stream Record). Otherwise the state sets looked at are counted
+       like items too, which keeps the time linear, at the cost of keeping up to one dead item per state set. */
+    explicit
+    StateSetReclaimer(bool amortize_sets = false) : m_amortize_sets(amortize_sets) {}
+
+    /* Called once the state set at curr_pos has been added (and is the last one) */
+    template<bool UseLeo, typename Symbol>
+    void add_state_set(SpanList<Item>& state_sets, SpanList<BasicLeoItem<Item>>* leo_items,
+                       ParseScratch<Symbol, Item>& scratch, size_t curr_pos)
+    {
+        if(state_sets.num_of_items() >= m_threshold) {
+            reclaim<UseLeo>(state_sets, leo_items, scratch, curr_pos);
+        }
+    }
+
+    void reset() noexcept
+    {
+        m_threshold = min_reclaim_items;
+        m_first_live = 0;
+    }
+private:
+    /* Number of items that the state sets must have before they are first reclaimed */
+    static constexpr size_t min_reclaim_items = 16384;
+
+    template<bool UseLeo, typename Symbol>
+    void reclaim(SpanList<Item>& state_sets, [[maybe_unused]] SpanList<BasicLeoItem<Item>>* leo_items,
+                 ParseScratch<Symbol, Item>& scratch, size_t curr_pos)
+    {
+        // Items in a state set only start in it or in earlier state sets, so marking the start of each
+        //  item in each live state set (from the last one backwards) marks every live state set. The state
+        //  sets before m_first_live were already found dead, and stay dead, so only the later ones are
+        //  looked at.
+        m_live_sets.assign(curr_pos + 1 - m_first_live, false);
+        m_live_sets.back() = true;
+        for(size_t pos = curr_pos + 1; pos-- > m_first_live;) {
+            if(m_live_sets[pos - m_first_live]) {
+                for(auto item : state_sets[pos]) {
+                    m_live_sets[item.start_pos - m_first_live] = true;
+                }
+            }
+        }
+        size_t item_count = state_sets.num_of_items();
+        if(std::ranges::find(m_live_sets, false) != m_live_sets.end()) {
+            auto is_live = [this](size_t pos) { return m_live_sets[pos - m_first_live]; };
+            state_sets.remove_dead_spans(is_live, m_first_live);
+            if constexpr(UseLeo) {
+                leo_items->remove_dead_spans(is_live, m_first_live);
+            }
+            m_first_live += std::ranges::find(m_live_sets, true) - m_live_sets.begin();
+            // Drops the indexes of the removed state sets (the live ones are indexed again as needed)
+            scratch.waiting_items.clear();
+        }
+        // Reclaiming again only once the live items have doubled keeps the cost per item constant (apart
+        //  from the state sets looked at, see the constructor). When most items were live, reclaiming is
+        //  put off for longer.
+        size_t live_count = state_sets.num_of_items();
+        size_t growth = live_count * 2 > item_count ? 4 : 2;
+        size_t set_count = m_amortize_sets ? curr_pos - m_first_live : 0;
+        m_threshold = std::max(min_reclaim_items, growth * live_count + set_count);
+    }
+
+    bool m_amortize_sets;
+    size_t m_threshold = min_reclaim_items;
+    /* The state sets before this one were found dead when the state sets were last reclaimed */
+    size_t m_first_live = 0;
+    std::vector<bool> m_live_sets;
+};
+
+/* Starts a round of completions in the state set at curr_pos (the last one in state_sets), made of its items
+   from first_offset on. For each of those items that is completed and whose origin is an earlier state set
+   (and that has no Leo item), the items it advances in its origin set are found on the threads of
+   scratch.workers. They only depend on earlier state sets, so the completions are independent of each
+   other; process_state_set then adds the advanced items in item order, so the state set is the same as
+   when completing on one thread. Advanced items that are already in the state set are left out, unless
+   KeepDuplicates is true (so that they are counted as duplicates in the same way as on one thread). Rounds
+   with too few completions are left empty, to be completed on one thread. */
+template<bool UseLeo, bool KeepDuplicates, typename Symbol, typename Item>
+void complete_round(const Grammar<Symbol> auto& rule_set, const SpanList<Item>& state_sets, size_t curr_pos,
+                    size_t first_offset, ParseScratch<Symbol, Item>& scratch,
+                    [[maybe_unused]] const SpanList<BasicLeoItem<std::type_identity_t<Item>>>* leo_items)
+{
+    using SymbolTraits = symbol_traits<Symbol>;
+    auto& completions = scratch.round_completions;
+    auto& waiting_items = scratch.waiting_items;
+    completions.clear();
+    auto state_set = state_sets[curr_pos];
+    for(size_t offset = first_offset; offset < state_set.size(); ++offset) {
+        Item item = state_set[offset];
+        const auto& dotted = rule_set.dotted_rule(item);
+        if(!dotted.is_completed || item.start_pos == curr_pos) {
+            continue;
+        }
+        if constexpr(UseLeo) {
+            if(find_leo_item((*leo_items)[item.start_pos], SymbolTraits::to_index(dotted.symbol)) != nullptr) {
+                continue;
+            }
+        }
+        // The index is not thread-safe to build, so it is built before the round starts
+        if(state_sets[item.start_pos].size() >= min_indexed_set_size && !waiting_items.is_indexed(item.start_pos)) {
+            waiting_items.add_state_set(rule_set, item.start_pos, state_sets[item.start_pos]);
+        }
+        completions.push_back({offset, 0, 0, 0});
+    }
+    if(completions.size() < min_parallel_completions) {
+        completions.clear();
+        return;
+    }
+    auto& curr_items = scratch.curr_items;
+    if(curr_items.empty()) {
+        for(auto item : state_set) {
+            curr_items.insert(item);
+        }
+    }
+    scratch.worker_items.resize(scratch.workers->thread_count());
+    for(auto& items : scratch.worker_items) {
+        items.clear();
+    }
+
+    // Each task completes a chunk of consecutive completed items. The state sets and curr_items are only
+    //  read until the round ends.
+    constexpr size_t chunk_size = 32;
+    auto complete_chunk = [&](size_t worker, size_t chunk) {
+        auto& found = scratch.worker_items[worker];
+        auto chunk_end = std::min(completions.size(), (chunk + 1) * chunk_size);
+        for(size_t index = chunk * chunk_size; index < chunk_end; ++index) {
+            auto& completion = completions[index];
+            Item item = state_set[completion.item_offset];
+            auto symbol = rule_set.dotted_rule(item).symbol;
+            auto start_set = state_sets[item.start_pos];
+            auto advance = [&](Item start_item) {
+                Item new_item = start_item.advanced();
+                if(KeepDuplicates || !curr_items.contains(new_item)) {
+                    found.push_back(new_item);
+                }
+            };
+            completion.worker = worker;
+            completion.first = found.size();
+            if(start_set.size() >= min_indexed_set_size) {
+                for(auto item_offset : waiting_items.waiting_on(item.start_pos, symbol)) {
+                    advance(start_set[item_offset]);
+                }
+            } else {
+                for(auto start_item : start_set) {
+                    const auto& start_dotted = rule_set.dotted_rule(start_item);
+                    if(!start_dotted.is_completed && start_dotted.next_symbol == symbol) {
+                        advance(start_item);
+                    }
+                }
+            }
+            completion.limit = found.size();
+        }
+    };
+    scratch.workers->run((completions.size() + chunk_size - 1) / chunk_size, complete_chunk);
+}
+
+/* Processes the state set at curr_pos, which must be the last state set in state_sets: adds the items that
+   it predicts and completes, and then adds the next state set, holding the items scanned from curr_token
+   (empty if Token is EndOfInput). scratch must be cleared before the first
+   state set of an input; unless forest is NoForest, each derivation step of each item is reported to it,
+   and unless stats is NoStats, the work done is counted in it (see ParseStats).
+   Throws if a position after curr_pos cannot be represented by Item. */
+template<bool UseLeo, typename Symbol, typename Item, typename Token, typename LookaheadMode, typename Forest,
+         typename Stats = NoStats>
+EARLEY_ALWAYS_INLINE
+void process_state_set(const Grammar<Symbol> auto& rule_set, SpanList<Item>& state_sets_ref, size_t curr_pos,
+                       [[maybe_unused]] const Token& curr_token, ParseScratch<Symbol, Item>& scratch,
+                       [[maybe_unused]] SpanList<BasicLeoItem<std::type_identity_t<Item>>>* leo_items,
+                       [[maybe_unused]] const LookaheadMode& lookahead, [[maybe_unused]] Forest& forest,
+                       [[maybe_unused]] Stats&& stats = NoStats{})
+{
+    constexpr bool at_end = std::same_as<Token, EndOfInput>;
+    constexpr bool classify_tokens = !std::same_as<LookaheadMode, NoLookahead>;
+    constexpr bool build_forest = !std::same_as<Forest, NoForest>;
+    constexpr bool collect_stats = !std::same_as<std::remove_cvref_t<Stats>, NoStats>;
+    static_assert(!(UseLeo && build_forest), "Leo items skip the items that a parse forest is built from");
+    using SymbolTraits = symbol_traits<Symbol>;
+    using position_type = typename Item::position_type;
+    if constexpr(!at_end) {
+        if(curr_pos >= std::numeric_limits<position_type>::max()) {
+            throw std::runtime_error("Input is too long for the item layout");
+        }
+    }
+    // Local copies of the grammar tables, so that they do not need to be reloaded after every
+    //  write to state_sets
+    auto dotted_rule = [dotted_rules = rule_set.dotted_rules.data(),
+                        rule_offsets = rule_set.rule_offsets.data()](Item item) -> const DottedRule<Symbol>& {
+        return dotted_rules[rule_offsets[item.rule_idx] + item.progress];
+    };
+    // Moved into a local so that the compiler knows that writes to items cannot change it, and moved
+    //  back on the way out (also if an exception is thrown, so that the caller's state sets are kept)
+    SpanList<Item> state_sets = std::move(state_sets_ref);
+    ScopeExit restore_state_sets{[&]() noexcept { state_sets_ref = std::move(state_sets); }};
+    auto& scanned_offsets = scratch.scanned_offsets;
+    auto& curr_items = scratch.curr_items;
+    auto& waiting_items = scratch.waiting_items;
+    // Symbols that have been predicted in the current state set
+    SymbolSet<Symbol> predicted_symbols;
+    // Terminals that match the current token (if tokens are classified)
+    [[maybe_unused]] SymbolSet<Symbol> token_terminals;
+
+    auto state_set = state_sets.curr_span();
+    size_t curr_set_size = state_sets[curr_pos].size();
+    curr_items.clear();
+    // Predicted items are only filtered once there is a token to look at
+    constexpr bool filter_predictions = LookaheadMode::filters_predictions && !at_end;
+    if constexpr(classify_tokens && !at_end) {
+        token_terminals = lookahead.template classify_token<Symbol>(rule_set, curr_token);
+    }
+    // Adds n to one of the counts of stats (if counting)
+    auto count = [&](uint64_t ParseStats::* counter, uint64_t n = 1) {
+        if constexpr(collect_stats) {
+            stats.*counter += n;
+        }
+    };
+    // Adds new_item to the current state set if it is not already there. Returns true if it was added.
+    auto add_item = [&](Item new_item) {
+        bool is_duplicate;
+        if(curr_set_size < min_hashed_set_size) {
+            is_duplicate = item_exists(state_sets[curr_pos], new_item);
+        } else {
+            if(curr_items.empty()) {
+                for(auto item : state_set) {
+                    curr_items.insert(item);
+                }
+            }
+            is_duplicate = !curr_items.insert(new_item);
+        }
+        if constexpr(collect_stats) {
+            stats.add_item(new_item.rule_idx, !is_duplicate);
+        }
+        if(is_duplicate) {
+            return false;
+        }
+        state_sets.emplace_back(new_item);
+        ++curr_set_size;
+        return true;
+    };
+    // With worker threads, the items are processed in rounds: each round starts with the items added
+    //  since the last one, and its completions are found in parallel up front (see complete_round)
+    [[maybe_unused]] auto* workers = build_forest ? nullptr : scratch.workers;
+    [[maybe_unused]] size_t round_end = 0;
+    [[maybe_unused]] size_t next_completion = 0;
+    size_t item_offset = 0;
+    for(auto item : state_set) {
+        const size_t offset = item_offset++;
+        if constexpr(!build_forest) {
+            if(workers != nullptr && offset == round_end) {
+                round_end = curr_set_size;
+                next_completion = 0;
+                complete_round<UseLeo, collect_stats>(rule_set, state_sets, curr_pos, offset, scratch, leo_items);
+            }
+        }
+        const auto& item_dotted = dotted_rule(item);
+        if(item_dotted.is_completed) {
+            // Completion
+            if constexpr(collect_stats) {
+                stats.add_completed_item(item.rule_idx);
+            }
+            if constexpr(build_forest) {
+                if(item.progress == 0) {
+                    forest.add_empty_derivation(rule_set, item, curr_pos);
+                }
+            } else {
+                auto& completions = scratch.round_completions;
+                if(next_completion < completions.size() && completions[next_completion].item_offset == offset) {
+                    const auto& completion = completions[next_completion++];
+                    const auto& found = scratch.worker_items[completion.worker];
+                    count(&ParseStats::completions, completion.limit - completion.first);
+                    for(size_t index = completion.first; index < completion.limit; ++index) {
+                        add_item(found[index]);
+                    }
+                    continue;
+                }
+            }
+            if constexpr(UseLeo) {
+                if(item.start_pos < curr_pos) {
+                    auto* leo_item = find_leo_item((*leo_items)[item.start_pos], SymbolTraits::to_index(item_dotted.symbol));
+                    if(leo_item != nullptr) {
+                        count(&ParseStats::completions);
+                        add_item(leo_item->top);
+                        continue;
+                    }
+                }
+            }
+            // Note: adding an item can move the state sets, so the start set is looked up again
+            //  after each item is added
+            auto start_set = state_sets[item.start_pos];
+            auto start_set_size = start_set.size();
+            if(item.start_pos < curr_pos && start_set_size >= min_indexed_set_size) {
+                if(!waiting_items.is_indexed(item.start_pos)) {
+                    waiting_items.add_state_set(rule_set, item.start_pos, start_set);
+                }
+                for(auto item_offset : waiting_items.waiting_on(item.start_pos, item_dotted.symbol)) {
+                    auto start_item = start_set[item_offset];
+                    Item new_item = start_item.advanced();
+                    if constexpr(build_forest) {
+                        forest.add_derivation(rule_set, new_item, curr_pos, start_item, item.start_pos,
+                                              forest.symbol_node(item_dotted.symbol, item.start_pos, curr_pos));
+                    }
+                    count(&ParseStats::completions);
+                    if(add_item(new_item)) {
+                        start_set = state_sets[item.start_pos];
+                    }
+                }
+            } else {
+                for(size_t item_offset = 0; item_offset < start_set_size; ++item_offset) {
+                    auto start_item = start_set[item_offset];
+                    const auto& start_dotted = dotted_rule(start_item);
+                    if(!start_dotted.is_completed && start_dotted.next_symbol == item_dotted.symbol) {
+                        Item new_item = start_item.advanced();
+                        if constexpr(build_forest) {
+                            forest.add_derivation(rule_set, new_item, curr_pos, start_item, item.start_pos,
+                                                  forest.symbol_node(item_dotted.symbol, item.start_pos, curr_pos));
+                        }
+                        count(&ParseStats::completions);
+                        if(add_item(new_item)) {
+                            start_set = state_sets[item.start_pos];
+                        }
+                    }
+                }
+            }
+        } else if(item_dotted.next_is_terminal) {
+            // Scan (the matching items are advanced into the next state set once this one is complete)
+            if constexpr(!at_end) {
+                bool is_match;
+                if constexpr(classify_tokens) {
+                    is_match = token_terminals.test(item_dotted.next_symbol);
+                } else {
+                    is_match = matches_terminal(item_dotted.next_symbol, curr_token);
+                }
+                if(is_match) {
+                    scanned_offsets.push_back((typename Item::span_offset_type)offset);
+                }
+            }
+        } else {
+            // Prediction (skipped if an earlier prediction in this state set already added
+            //  everything that predicting next_sym would add)
+            auto next_sym = item_dotted.next_symbol;
+            if(!predicted_symbols.test(next_sym)) {
+                predicted_symbols |= rule_set.predicted_symbols(next_sym);
+                for(auto predicted_item : rule_set.prediction(next_sym)) {
+                    Item new_item(predicted_item.rule_idx, (position_type)curr_pos, predicted_item.progress);
+                    if constexpr(filter_predictions) {
+                        if(!rule_set.lookahead_set(new_item).intersects(token_terminals)) {
+                            continue;
+                        }
+                    }
+                    if constexpr(build_forest) {
+                        // Predicted items past the start of their rule skipped nullable components
+                        if(new_item.progress > 0) {
+                            Item prev_item(new_item.rule_idx, (position_type)curr_pos, new_item.progress - 1);
+                            forest.add_derivation(rule_set, new_item, curr_pos, prev_item, curr_pos,
+                                                  forest.symbol_node(dotted_rule(prev_item).next_symbol, curr_pos, curr_pos));
+                        }
+                    }
+                    count(&ParseStats::predictions);
+                    add_item(new_item);
+                }
+            }
+            // Advance item if it is incomplete and the next symbol is nullable
+            if(item_dotted.next_is_nullable) {
+                Item advanced_item = item.advanced();
+                if constexpr(build_forest) {
+                    forest.add_derivation(rule_set, advanced_item, curr_pos, item, curr_pos,
+                                          forest.symbol_node(next_sym, curr_pos, curr_pos));
+                }
+                count(&ParseStats::nullable_advances);
+                add_item(advanced_item);
+            }
+        }
+    }
+    if constexpr(UseLeo) {
+        add_leo_items<Symbol>(rule_set, state_sets, curr_pos, *leo_items);
+    }
+    scratch.round_completions.clear();
+    state_sets.add_span();
+    if constexpr(!at_end) {
+        // Now that the current state set is complete, the scanned items are advanced directly into the next
+        //  one, so that each is written once. Room is made for them up front, so that the current state set
+        //  does not move while it is read.
+        state_sets.reserve(scanned_offsets.size());
+        const Item* curr_set = state_sets[curr_pos].data();
+        for(auto offset : scanned_offsets) {
+            Item item = curr_set[offset];
+            state_sets.emplace_back(item.advanced());
+            if constexpr(build_forest) {
+                forest.add_derivation(rule_set, item.advanced(), curr_pos + 1, item, curr_pos,
+                                      forest.terminal_node(dotted_rule(item).next_symbol, curr_pos));
+            }
+            if constexpr(collect_stats) {
+                stats.add_item(item.rule_idx, true);
+            }
+        }
+        count(&ParseStats::scans, scanned_offsets.size());
+        scanned_offsets.clear();
+    }
+    if constexpr(collect_stats) {
+        stats.add_state_set(curr_set_size, state_sets.num_of_items(), state_sets.bytes_committed());
+    }
+}
+
+/* Recognizes input, returning its state sets (and adding its Leo items to leo_items if UseLeo is true).
+   The state sets are stored in the memory of empty_state_sets, which must be empty; scratch must be cleared.
+   Unless forest is NoForest, each derivation step of each item is also reported to forest (see ParseForest). */
+template<typename Token, bool UseLeo, typename Symbol, typename Item, typename InputRange, typename LookaheadMode,
+         typename Forest = NoForest, typename Stats = NoStats>
+SpanList<Item> recognize(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, InputRange&& input,
+                         SpanList<Item>&& empty_state_sets, ParseScratch<Symbol, Item>& scratch,
+                         SpanList<BasicLeoItem<std::type_identity_t<Item>>>* leo_items, const LookaheadMode& lookahead,
+                         Forest&& forest = NoForest{}, Stats&& stats = NoStats{})
+{
+    constexpr bool collect_stats = !std::same_as<std::remove_cvref_t<Stats>, NoStats>;
+    check_item_layout<Item>(rule_set);
+    if constexpr(collect_stats) {
+        stats.start_parse(rule_set.rule_offsets.size() - 1);
+    }
+    SpanList<Item> state_sets = std::move(empty_state_sets);
+    // Initialize S(0)
+    state_sets.add_span();
+    for(auto rule_idx : rule_set[start_symbol]) {
+        state_sets.emplace_back(rule_idx, 0);
+        if constexpr(collect_stats) {
+            stats.add_item(rule_idx, true);
+        }
     }
-struct symbol_traits {
-    static constexpr auto symbol_count = static_cast<uint8_t>(Symbol::Symbol_Count);
 
-    static constexpr
-    uint8_t to_index(Symbol s) noexcept { return static_cast<uint8_t>(s); }
-};
+    // Process input
+    auto curr_token = std::ranges::begin(input);
+    auto end_token = std::ranges::end(input);
+    for(size_t curr_pos = 0; !state_sets[curr_pos].empty(); ++curr_pos) {
+        if(curr_token != end_token) {
+            const Token token = *curr_token;
+            process_state_set<UseLeo>(rule_set, state_sets, curr_pos, token, scratch, leo_items, lookahead, forest, stats);
+            ++curr_token;
+        } else {
+            process_state_set<UseLeo>(rule_set, state_sets, curr_pos, EndOfInput{}, scratch, leo_items, lookahead, forest,
+                                      stats);
+        }
+    }
+    return state_sets;
+}
 
-/* Represents a grammar rule where symbol is the left-hand side
-   and components is the right-hand side of the rule. */
-template<typename Symbol>
-struct Rule {
-    Symbol symbol;
-    std::vector<Symbol> components;
-};
+template<typename Token, bool UseLeo, typename Item, typename Symbol, typename InputRange, typename LookaheadMode,
+         typename Stats = NoStats>
+SpanList<Item> parse(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, size_t item_capacity, InputRange&& input,
+                     SpanList<BasicLeoItem<Item>>* leo_items, const LookaheadMode& lookahead, Stats&& stats = NoStats{})
+{
+    ParseScratch<Symbol, Item> scratch;
+    return recognize<Token, UseLeo>(rule_set, start_symbol, std::forward<InputRange>(input), SpanList<Item>{item_capacity},
+                                    scratch, leo_items, lookahead, NoForest{}, stats);
+}
 
-/* Represents a grammar and associated data structures. All interactions
-   with the grammar should take place through this object. */
-template<typename Symbol>
-struct RuleSet {
-    using index_range = std::ranges::iota_view<uint16_t, uint16_t>;
-    using SymbolTraits = symbol_traits<Symbol>;
-    static constexpr auto symbol_count = SymbolTraits::symbol_count;
+} // namespace detail
 
-    explicit constexpr
-    RuleSet(std::span<const Rule<Symbol>> rules)
-        : rules(rules)
+/* Requirements on the symbol type of a grammar that parses tokens of type Token */
+template<typename Symbol, typename Token>
+concept GrammarSymbol = std::regular<Symbol>
+    && requires(Symbol s, Token t) {
+        { is_terminal(s) } -> std::same_as<bool>;
+        { matches_terminal(s, t) } -> std::same_as<bool>;
+    };
+
+/* Classifier used by Lookahead when none is given: matches the token against every terminal
+   in the grammar */
+struct MatchTerminals {
+    template<typename Symbol, typename Token>
+    constexpr
+    SymbolSet<Symbol> operator()(const Grammar<Symbol> auto& rule_set, const Token& token) const
     {
-        // Assumes rules are grouped by symbol
-        auto progress = rules.begin();
-        while(progress != rules.end()) {
-            auto symbol = progress->symbol;
-            auto start_idx = (uint16_t)(progress - rules.begin());
-            progress = std::ranges::find_if_not(progress + 1, rules.end(), [symbol](auto s) { return s == symbol; }, &Rule<Symbol>::symbol);
-            rule_spans[SymbolTraits::to_index(symbol)] = {start_idx, (uint16_t)(progress - rules.begin())};
+        SymbolSet<Symbol> token_terminals;
+        for(Symbol terminal : rule_set.terminals) {
+            if(matches_terminal(terminal, token)) {
+                token_terminals.set(terminal);
+            }
         }
+        return token_terminals;
+    }
+};
 
-        // Mark all nullable rules
-        bool at_fixpoint;
-        do {
-            at_fixpoint = true;
-            for(const auto& rule : rules) {
-                if(!is_nullable(rule.symbol)
-                 && std::ranges::all_of(rule.components, [this](Symbol s) { return is_nullable(s); })) {
-                    nullable[SymbolTraits::to_index(rule.symbol)] = true;
-                    at_fixpoint = false;
-                }
-            }
-        } while(!at_fixpoint);
+namespace detail {
+
+template<typename Symbol, typename Classifier, typename Token>
+constexpr
+SymbolSet<Symbol> classify_token(const Classifier& classify, const Grammar<Symbol> auto& rule_set, const Token& token)
+{
+    if constexpr(std::same_as<Classifier, MatchTerminals>) {
+        return classify.template operator()<Symbol>(rule_set, token);
+    } else {
+        return classify(token);
     }
+}
 
-    /* Returns a range of indices [A, B) such that A is the index of the first rule in rules with rule_sym as
-       its symbol and B is the index of the rule one past F, where F is the final rule in the grammar with
-       rule_sym as its symbol. */
+} // namespace detail
+
+/* Lookahead mode of parse: an item is only predicted if the next token can be matched by it (or, if the
+   rest of its rule is nullable, by something that can follow its rule's symbol), using the FIRST and FOLLOW
+   sets of the grammar. classify(token) must return a SymbolSet<Symbol> holding exactly the terminals that
+   match the token, e.g. by looking up its token kind in a table (see TerminalTable); it is also used to scan
+   the token. By default, matches_terminal is called for each terminal in the grammar instead.
+
+   State sets only contain the items that can be part of a parse continuing past the next token, so any
+   full parse found in them is the same as without lookahead. */
+template<typename Classifier = MatchTerminals>
+struct Lookahead {
+    static constexpr bool filters_predictions = true;
+
+    [[no_unique_address]] Classifier classify;
+
+    template<typename Symbol, typename Token>
     constexpr
-    index_range operator[](Symbol rule_sym) const noexcept { return rule_spans[SymbolTraits::to_index(rule_sym)]; }
+    SymbolSet<Symbol> classify_token(const Grammar<Symbol> auto& rule_set, const Token& token) const
+    {
+        return detail::classify_token<Symbol>(classify, rule_set, token);
+    }
+};
+
+/* Lookahead mode of parse where no lookahead is done, but each token is classified once (as with
+   Lookahead), so that scanning an item only tests one bit of the classification instead of calling
+   matches_terminal */
+template<typename Classifier>
+struct ClassifyTokens {
+    static constexpr bool filters_predictions = false;
 
+    [[no_unique_address]] Classifier classify;
+
+    template<typename Symbol, typename Token>
     constexpr
-    bool is_nullable(Symbol rule_sym) const noexcept { return nullable[SymbolTraits::to_index(rule_sym)]; }
+    SymbolSet<Symbol> classify_token(const Grammar<Symbol> auto& rule_set, const Token& token) const
+    {
+        return detail::classify_token<Symbol>(classify, rule_set, token);
+    }
+};
 
-    std::span<const Rule<Symbol>> rules; /* The rules of the grammar */
-    index_range rule_spans[SymbolTraits::symbol_count]{};
-    bool nullable[SymbolTraits::symbol_count]{};
+/* Lookahead or ClassifyTokens */
+template<typename Mode>
+concept TokenMode = !std::same_as<Mode, detail::NoLookahead> && requires {
+    { Mode::filters_predictions } -> std::convertible_to<bool>;
 };
 
-/* Represents a match (partial or complete) of a particular rule starting at a particular
-   position in the input. */
-struct EarleyItem {
+/* TokenMode, or detail::NoLookahead for none */
+template<typename Mode>
+concept OptionalTokenMode = std::same_as<Mode, detail::NoLookahead> || TokenMode<Mode>;
+
+/* Classifier for Lookahead and ClassifyTokens when tokens are bytes: a table of the terminals that match
+   each of the 256 byte values, filled in by calling matches_terminal once for each byte value and terminal.
+   It can be built at compile time from a StaticRuleSet if matches_terminal is constexpr. */
+template<typename Symbol, typename Token = char>
+    requires (sizeof(Token) == 1)
+class TerminalTable {
+public:
     explicit constexpr
-    EarleyItem(uint16_t rule_idx, uint32_t start_pos, uint16_t progress = 0)
-        : rule_idx(rule_idx), progress(progress), start_pos(start_pos) {}
+    TerminalTable(const Grammar<Symbol> auto& rule_set)
+    {
+        for(size_t byte = 0; byte < table.size(); ++byte) {
+            table[byte] = MatchTerminals{}.template operator()<Symbol>(rule_set, (Token)byte);
+        }
+    }
 
     constexpr
-    bool operator==(const EarleyItem&) const noexcept = default;
-
-    uint16_t rule_idx;  /* Index of the rule that is being matched */
-    uint16_t progress;  /* Dividing point between this item's matched/unmatched components */
-    uint32_t start_pos; /* Where in input this match starts */
+    const SymbolSet<Symbol>& operator()(Token token) const noexcept { return table[(unsigned char)token]; }
+private:
+    std::array<SymbolSet<Symbol>, 256> table{};
 };
 
-using StateSetIterator = SpanList<EarleyItem>::const_iterator;
+template<typename Symbol>
+TerminalTable(const RuleSet<Symbol>&) -> TerminalTable<Symbol>;
 
-using EarleyItemIterator = std::span<const EarleyItem>::iterator;
+inline constexpr Lookahead<> lookahead{};
 
-/* Returns true if the item is complete. Note that rule_comp_count
-   is assumed to equal rule.components.size(), where rule is the
-   Rule corresponding to item.rule_idx. */
+/* The Earley recognizer. The output is a list of state sets, each of which contains
+   zero or more Earley items. item_capacity is the number of items to initially reserve
+   memory for; the state sets grow past it as needed. Item is the type of those items, e.g.
+   CompactEarleyItem for small grammars and short inputs (see BasicEarleyItem). */
+template<typename Token, typename Item = EarleyItem, GrammarSymbol<Token> Symbol, std::ranges::input_range InputRange>
+    requires std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+SpanList<Item> parse(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, size_t item_capacity, InputRange&& input)
+{
+    return detail::parse<Token, false, Item>(rule_set, start_symbol, item_capacity, std::forward<InputRange>(input), nullptr,
+                                       detail::NoLookahead{});
+}
+
+/* The Earley recognizer using the given lookahead mode (see Lookahead and ClassifyTokens) */
+template<typename Token, typename Item = EarleyItem, GrammarSymbol<Token> Symbol, std::ranges::input_range InputRange,
+         TokenMode LookaheadMode>
+    requires std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+SpanList<Item> parse(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, size_t item_capacity, InputRange&& input,
+                     const LookaheadMode& lookahead)
+{
+    return detail::parse<Token, false, Item>(rule_set, start_symbol, item_capacity, std::forward<InputRange>(input), nullptr,
+                                       lookahead);
+}
+
+/* The Earley recognizer, also counting the work it does in stats (see ParseStats) */
+template<typename Token, typename Item = EarleyItem, GrammarSymbol<Token> Symbol, std::ranges::input_range InputRange>
+    requires std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+SpanList<Item> parse(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, size_t item_capacity, InputRange&& input,
+                     ParseStats& stats)
+{
+    return detail::parse<Token, false, Item>(rule_set, start_symbol, item_capacity, std::forward<InputRange>(input), nullptr,
+                                             detail::NoLookahead{}, stats);
+}
+
+/* The Earley recognizer using the given lookahead mode, also counting the work it does in stats */
+template<typename Token, typename Item = EarleyItem, GrammarSymbol<Token> Symbol, std::ranges::input_range InputRange,
+         TokenMode LookaheadMode>
+    requires std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+SpanList<Item> parse(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, size_t item_capacity, InputRange&& input,
+                     const LookaheadMode& lookahead, ParseStats& stats)
+{
+    return detail::parse<Token, false, Item>(rule_set, start_symbol, item_capacity, std::forward<InputRange>(input), nullptr,
+                                             lookahead, stats);
+}
+
+/* The Earley recognizer using Leo items, so that right-recursive rules are recognized in linear time.
+   Completed items that are on a deterministic reduction path are not added to the state sets (only the
+   topmost item is); the overloads of find_completed_item that take leo_items can be used to recover them.
+   leo_items must be empty and will hold the Leo items of each state set. */
+template<typename Token, typename Item = EarleyItem, GrammarSymbol<Token> Symbol, std::ranges::input_range InputRange>
+    requires std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+SpanList<Item> parse(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, size_t item_capacity, InputRange&& input,
+                     SpanList<BasicLeoItem<Item>>& leo_items)
+{
+    return detail::parse<Token, true, Item>(rule_set, start_symbol, item_capacity, std::forward<InputRange>(input), &leo_items,
+                                      detail::NoLookahead{});
+}
+
+/* The Earley recognizer using Leo items and the given lookahead mode */
+template<typename Token, typename Item = EarleyItem, GrammarSymbol<Token> Symbol, std::ranges::input_range InputRange,
+         TokenMode LookaheadMode>
+    requires std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+SpanList<Item> parse(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, size_t item_capacity, InputRange&& input,
+                     SpanList<BasicLeoItem<Item>>& leo_items, const LookaheadMode& lookahead)
+{
+    return detail::parse<Token, true, Item>(rule_set, start_symbol, item_capacity, std::forward<InputRange>(input), &leo_items,
+                                      lookahead);
+}
+
+/* The Earley recognizer using Leo items, also counting the work it does in stats */
+template<typename Token, typename Item = EarleyItem, GrammarSymbol<Token> Symbol, std::ranges::input_range InputRange>
+    requires std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+SpanList<Item> parse(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, size_t item_capacity, InputRange&& input,
+                     SpanList<BasicLeoItem<Item>>& leo_items, ParseStats& stats)
+{
+    return detail::parse<Token, true, Item>(rule_set, start_symbol, item_capacity, std::forward<InputRange>(input), &leo_items,
+                                            detail::NoLookahead{}, stats);
+}
+
+/* A change to an input: removed_count tokens starting at offset were replaced by inserted_count tokens */
+struct InputEdit {
+    uint32_t offset;
+    uint32_t removed_count;
+    uint32_t inserted_count;
+};
+
+namespace detail {
+
+/* Returns the position in the edited input of an item that started at start_pos in the old input, or
+   UINT32_MAX if the state set it started in has no counterpart in the edited input */
 constexpr
-bool is_completed(EarleyItem item, uint16_t rule_comp_count)
+uint32_t edited_position(InputEdit edit, uint32_t start_pos) noexcept
 {
-    return item.progress == rule_comp_count;
+    if(start_pos <= edit.offset) {
+        return start_pos;
+    } else if(start_pos < edit.offset + edit.removed_count) {
+        return UINT32_MAX;
+    }
+    uint32_t new_pos = start_pos - edit.removed_count + edit.inserted_count;
+    // If nothing was inserted, the state set at the edit is still the old one from before the removed tokens
+    return new_pos > edit.offset ? new_pos : UINT32_MAX;
 }
 
-/* Look ahead at the next unmatched component of a rule */
+/* Returns true if the state set at pos has every item that predicting and completing its items would add,
+   as it does if it was built without Leo items or lookahead */
 template<typename Symbol>
-constexpr
-Symbol next_symbol(const Rule<Symbol>& rule, EarleyItem item)
+bool is_closed_state_set(const Grammar<Symbol> auto& rule_set, const SpanList<EarleyItem>& state_sets, uint32_t pos)
 {
-    return rule.components[item.progress];
+    auto state_set = state_sets[pos];
+    return std::ranges::all_of(state_set, [&](EarleyItem item) {
+        const auto& dotted = rule_set.dotted_rule(item);
+        if(!dotted.is_completed) {
+            return dotted.next_is_terminal
+                || std::ranges::all_of(rule_set.prediction(dotted.next_symbol), [&](PredictedItem predicted) {
+                       return item_exists(state_set, EarleyItem((EarleyItem::rule_index_type)predicted.rule_idx, pos,
+                                                                (EarleyItem::progress_type)predicted.progress));
+                   });
+        }
+        return item.start_pos == pos || std::ranges::all_of(state_sets[item.start_pos], [&](EarleyItem start_item) {
+            const auto& start_dotted = rule_set.dotted_rule(start_item);
+            return start_dotted.is_completed || start_dotted.next_symbol != dotted.symbol
+                || item_exists(state_set, start_item.advanced());
+        });
+    });
 }
 
-/* Returns true if the given item already exists in the given state set */
-constexpr
-bool item_exists(const std::ranges::forward_range auto& state_set, EarleyItem item)
+} // namespace detail
+
+/* Updates state_sets, the output of parse for an input, to be the output of parse for input, the result of
+   applying edit to that input. Each state set only depends on the tokens before it, so the state sets up to
+   the edit are kept, and recognition resumes from there. Once a state set after the edit is the same as
+   the one at the corresponding position of the old input (and the items in it only refer to state sets that
+   are the same too), all of the following old state sets are reused instead of being recognized again.
+   The old state sets are compared against where they are, so an edit that is resynchronized soon after
+   costs about as much as recognizing the state sets up to that point; the following ones are only moved
+   (and their items renumbered) if the edit changes the length of the input or of the state sets.
+   The state sets must have been built for start_symbol without Leo items or lookahead, using the same
+   grammar (which is asserted). */
+template<typename Token, GrammarSymbol<Token> Symbol, std::ranges::input_range InputRange>
+    requires std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+SpanList<EarleyItem> reparse(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, SpanList<EarleyItem>&& state_sets,
+                             InputRange&& input, InputEdit edit)
 {
-    return std::ranges::find(state_set, item) != state_set.end();
+    if(edit.offset >= state_sets.size() || state_sets[edit.offset].empty()) {
+        // The input was already rejected before the edit, so nothing changes
+        return std::move(state_sets);
+    }
+    assert(std::ranges::find(rule_set[start_symbol], state_sets[0][0].rule_idx) != rule_set[start_symbol].end());
+    assert(detail::is_closed_state_set<Symbol>(rule_set, state_sets, edit.offset));
+
+    // The new state sets are added over the old ones after the edit, so the old items are copied aside just
+    //  before they could be overwritten, and only as far as the new state sets reach. If a state set grows
+    //  past the items copied aside (or the state sets have to grow), the old state sets can no longer be
+    //  compared against, and the rest of the input is recognized again.
+    const size_t old_set_count = state_sets.size();
+    std::vector<size_t> old_offsets; /* Offset of each old state set after the edit, then the end of the last one */
+    old_offsets.reserve(old_set_count - edit.offset);
+    size_t old_end = state_sets.num_of_items();
+    for(size_t set_pos = old_set_count; set_pos-- > edit.offset + 1;) {
+        old_offsets.push_back(old_end);
+        old_end -= state_sets[set_pos].size();
+    }
+    old_offsets.push_back(old_end);
+    std::ranges::reverse(old_offsets);
+    old_end = old_offsets.back();
+    const size_t old_capacity = state_sets.capacity();
+    std::vector<EarleyItem> saved_items;
+    size_t saved_end = old_offsets.front();
+    bool can_reuse = true;
+    auto save_old_items = [&](size_t limit) {
+        limit = std::min(limit, old_end);
+        if(limit > saved_end) {
+            saved_items.insert(saved_items.end(), state_sets.data() + saved_end, state_sets.data() + limit);
+            saved_end = limit;
+        }
+    };
+    auto old_item = [&](size_t index) {
+        return index < saved_end ? saved_items[index - old_offsets.front()] : state_sets.data()[index];
+    };
+    auto old_item_range = [&](uint32_t set_pos) {
+        return std::views::iota(old_offsets[set_pos - edit.offset - 1], old_offsets[set_pos - edit.offset])
+             | std::views::transform(old_item);
+    };
+    state_sets.truncate(edit.offset + 1);
+
+    detail::check_item_layout<EarleyItem>(rule_set);
+    detail::ParseScratch<Symbol> scratch;
+    detail::NoForest forest;
+    auto curr_token = std::ranges::next(std::ranges::begin(input), edit.offset);
+    auto end_token = std::ranges::end(input);
+    for(uint32_t curr_pos = edit.offset; !state_sets[curr_pos].empty(); ++curr_pos) {
+        if(can_reuse) {
+            // Copy aside at least as many old items as have been overwritten so far
+            save_old_items(state_sets.num_of_items() + std::max<size_t>(saved_items.size(), 4096));
+        }
+        if(curr_token != end_token) {
+            const Token token = *curr_token;
+            detail::process_state_set<false>(rule_set, state_sets, curr_pos, token, scratch, nullptr,
+                                             detail::NoLookahead{}, forest);
+            ++curr_token;
+        } else {
+            detail::process_state_set<false>(rule_set, state_sets, curr_pos, detail::EndOfInput{}, scratch, nullptr,
+                                             detail::NoLookahead{}, forest);
+        }
+        if(saved_end < old_end && (state_sets.num_of_items() > saved_end || state_sets.capacity() != old_capacity)) {
+            can_reuse = false;
+        }
+
+        // Compare the (now complete) state set at curr_pos with the old one at the same place in the input.
+        //  Later state sets only depend on it, the tokens after it, and the state sets its items start in, so
+        //  they are all the same as the old ones if it is the same and none of its items start in a state
+        //  set after the edit (other than itself).
+        uint32_t old_pos = curr_pos + edit.removed_count - edit.inserted_count;
+        if(!can_reuse || curr_pos < edit.offset + edit.inserted_count || old_pos + 1 >= old_set_count) {
+            continue;
+        }
+        auto new_set = state_sets[curr_pos];
+        auto is_same_set = [&](const auto& old_set) {
+            return std::ranges::equal(new_set, old_set, [edit](EarleyItem new_item, EarleyItem old_item) {
+                return new_item.rule_idx == old_item.rule_idx && new_item.progress == old_item.progress
+                    && new_item.start_pos == detail::edited_position(edit, old_item.start_pos);
+            });
+        };
+        bool is_same = old_pos <= edit.offset ? is_same_set(state_sets[old_pos]) : is_same_set(old_item_range(old_pos));
+        if(!is_same || std::ranges::any_of(new_set, [&](EarleyItem item) {
+               return item.start_pos > edit.offset && item.start_pos < curr_pos;
+           })) {
+            continue;
+        }
+        // Every later state set would be the same as the old one, so reuse them. If they would start where
+        //  they already are and keep their positions, only the items that were overwritten are copied back.
+        state_sets.truncate(curr_pos + 1);
+        const size_t first_old_item = old_offsets[old_pos - edit.offset];
+        const bool in_place = state_sets.num_of_items() == first_old_item && edit.inserted_count == edit.removed_count;
+        if(state_sets.num_of_items() > first_old_item) {
+            save_old_items(old_end);
+        }
+        auto edited_item = [edit](EarleyItem item) {
+            assert(detail::edited_position(edit, item.start_pos) != UINT32_MAX);
+            return EarleyItem{item.rule_idx, detail::edited_position(edit, item.start_pos), item.progress};
+        };
+        for(uint32_t set_pos = old_pos + 1; set_pos < old_set_count; ++set_pos) {
+            size_t index = old_offsets[set_pos - edit.offset - 1];
+            size_t limit = old_offsets[set_pos - edit.offset];
+            state_sets.add_span();
+            if(in_place) {
+                for(; index < std::min(limit, saved_end); ++index) {
+                    state_sets.emplace_back(old_item(index));
+                }
+                state_sets.restore(limit - index);
+            } else {
+                for(; index < limit; ++index) {
+                    state_sets.emplace_back(edited_item(old_item(index)));
+                }
+            }
+        }
+        break;
+    }
+    return std::move(state_sets);
 }
 
-/* The Earley recognizer. The output is a list of state sets, each of which contains
-   zero or more Earley items. */
-template<typename Token, std::regular Symbol, std::ranges::input_range InputRange>
-    requires
-        std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
-     && requires(Symbol s, Token t) {
-            { is_terminal(s) } -> std::same_as<bool>;
-            { matches_terminal(s, t) } -> std::same_as<bool>;
-        }
-SpanList<EarleyItem> parse(const RuleSet<Symbol>& rule_set, Symbol start_symbol, size_t max_item_capacity, InputRange&& input)
+/* The result of recognizing an input without keeping its parse (see Parser::recognize) */
+struct RecognizeResult {
+    bool accepted = false;
+    /* If the input was not accepted, the index of the first token that no match of the start symbol can
+       contain, which is the input size if the input ended too early. Otherwise the input size. */
+    size_t error_pos = 0;
+
+    constexpr
+    operator bool() const noexcept { return accepted; }
+};
+
+namespace detail {
+
+/* Recognizes input like recognize, but stops at the first token that no match can contain, and reclaims
+   the state sets that can no longer be used as it goes (see StateSetReclaimer). What is left of the state
+   sets is stored in the memory of state_sets_ref, which must be empty; scratch must be cleared. */
+template<typename Token, bool UseLeo, typename Symbol, typename Item, typename InputRange, typename LookaheadMode>
+RecognizeResult recognize_only(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, InputRange&& input,
+                               SpanList<Item>& state_sets_ref, ParseScratch<Symbol, Item>& scratch,
+                               SpanList<BasicLeoItem<std::type_identity_t<Item>>>* leo_items,
+                               const LookaheadMode& lookahead, StateSetReclaimer<Item>& reclaimer)
 {
-    SpanList<EarleyItem> state_sets{max_item_capacity};
+    check_item_layout<Item>(rule_set);
+    reclaimer.reset();
+    // The state sets are kept in a local while recognizing, like in process_state_set
+    SpanList<Item> state_sets = std::move(state_sets_ref);
+    ScopeExit restore_state_sets{[&]() noexcept { state_sets_ref = std::move(state_sets); }};
+    auto result = [](bool accepted, size_t pos) { return RecognizeResult{accepted, pos}; };
     // Initialize S(0)
     state_sets.add_span();
     for(auto rule_idx : rule_set[start_symbol]) {
         state_sets.emplace_back(rule_idx, 0);
     }
+    if(state_sets[0].empty()) {
+        return result(false, 0);
+    }
 
-    // Process input
-    std::vector<EarleyItem> next_state_set;
-    auto curr_token = std::ranges::begin(input);
+    NoForest forest;
+    size_t curr_pos = 0;
     auto end_token = std::ranges::end(input);
-    for(uint32_t curr_pos = 0; !state_sets[curr_pos].empty(); ++curr_pos, ++curr_token) {
-        auto state_set = state_sets.curr_span();
-        for(auto item : state_set) {
-            const auto& item_rule = rule_set.rules[item.rule_idx];
-            if(is_completed(item, item_rule.components.size())) {
-                // Completion
-                for(auto start_item : state_sets[item.start_pos]) {
-                    const auto& start_rule = rule_set.rules[start_item.rule_idx];
-                    if(!is_completed(start_item, start_rule.components.size())
-                        && next_symbol(start_rule, start_item) == item_rule.symbol
-                        && !item_exists(state_set, start_item)) {
-                        state_sets.emplace_back(start_item.rule_idx, start_item.start_pos, start_item.progress + 1);
-                    }
-                }
-            } else {
-                auto next_sym = next_symbol(item_rule, item);
-                if(is_terminal(next_sym) && curr_token != end_token) {
-                    // Scan
-                    if(matches_terminal(next_sym, *curr_token)) {
-                        next_state_set.emplace_back(item.rule_idx, item.start_pos, item.progress + 1);
-                    }
-                } else {
-                    // Prediction
-                    EarleyItem predicted_item{0, curr_pos};
-                    for(auto rule_idx : rule_set[next_sym]) {
-                        predicted_item.rule_idx = rule_idx;
-                        if(!item_exists(state_set, predicted_item)) {
-                            state_sets.emplace_back(predicted_item);
-                        }
-                    }
-                    // Advance item if it is incomplete and the next symbol is nullable
-                    if(rule_set.is_nullable(next_sym)) {
-                        predicted_item = item;
-                        ++predicted_item.progress;
-                        if(!item_exists(state_set, predicted_item)) {
-                            state_sets.emplace_back(std::move(predicted_item));
-                        }
-                    }
-                }
-            }
+    for(auto curr_token = std::ranges::begin(input); curr_token != end_token; ++curr_token) {
+        const Token token = *curr_token;
+        process_state_set<UseLeo>(rule_set, state_sets, curr_pos, token, scratch, leo_items, lookahead, forest);
+        if(state_sets[curr_pos + 1].empty()) {
+            return result(false, curr_pos);
         }
-        state_sets.add_span();
-        state_sets.append(next_state_set.begin(), next_state_set.end());
-        next_state_set.clear();
+        ++curr_pos;
+        reclaimer.template add_state_set<UseLeo>(state_sets, leo_items, scratch, curr_pos);
     }
-    return state_sets;
+    process_state_set<UseLeo>(rule_set, state_sets, curr_pos, EndOfInput{}, scratch, leo_items, lookahead, forest);
+    bool accepted = std::ranges::any_of(state_sets[curr_pos], [&](Item item) {
+        const auto& dotted = rule_set.dotted_rule(item);
+        return item.start_pos == 0 && dotted.is_completed && dotted.symbol == start_symbol;
+    });
+    return result(accepted, curr_pos);
+}
+
+} // namespace detail
+
+/* Runs the Earley recognizer on one input after another, reusing the memory of the state sets and of the
+   recognizer's buffers. Once it has parsed an input, parsing inputs that need no more items does not allocate.
+   If UseLeo is true, the recognizer uses Leo items (see the parse overload that takes leo_items). Item is the
+   type of the items in the state sets (see BasicEarleyItem). */
+template<typename Symbol, bool UseLeo = false, typename Item = EarleyItem>
+class Parser {
+public:
+    /* item_capacity is the number of items to initially reserve memory for, and memory_options is how
+       that memory is allocated (see BigArrayOptions) */
+    explicit
+    Parser(size_t item_capacity = 4096, const BigArrayOptions& memory_options = {})
+        : m_state_sets(item_capacity, memory_options), m_leo_items(UseLeo ? item_capacity : 1, memory_options) {}
+
+    /* Same as earley::parse, but the output is stored in (and references) this Parser. It is only valid
+       until the next call to parse or reset. */
+    template<typename Token, std::ranges::input_range InputRange>
+        requires GrammarSymbol<Symbol, Token> && std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+    const SpanList<Item>& parse(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, InputRange&& input)
+    {
+        return parse<Token>(rule_set, start_symbol, std::forward<InputRange>(input), detail::NoLookahead{});
+    }
+
+    /* Same as parse, using the given lookahead mode (see Lookahead and ClassifyTokens) */
+    template<typename Token, std::ranges::input_range InputRange, OptionalTokenMode LookaheadMode>
+        requires GrammarSymbol<Symbol, Token> && std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+    const SpanList<Item>& parse(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, InputRange&& input,
+                                const LookaheadMode& lookahead)
+    {
+        reset();
+        m_state_sets = detail::recognize<Token, UseLeo>(rule_set, start_symbol, std::forward<InputRange>(input),
+                                                        std::move(m_state_sets), m_scratch, &m_leo_items, lookahead);
+        return m_state_sets;
+    }
+
+    /* Same as parse, also counting the work done in stats (see ParseStats) */
+    template<typename Token, std::ranges::input_range InputRange>
+        requires GrammarSymbol<Symbol, Token> && std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+    const SpanList<Item>& parse(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, InputRange&& input,
+                                ParseStats& stats)
+    {
+        return parse<Token>(rule_set, start_symbol, std::forward<InputRange>(input), detail::NoLookahead{}, stats);
+    }
+
+    /* Same as parse, using the given lookahead mode (detail::NoLookahead for none) and also counting the
+       work done in stats (see ParseStats) */
+    template<typename Token, std::ranges::input_range InputRange, OptionalTokenMode LookaheadMode>
+        requires GrammarSymbol<Symbol, Token> && std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+    const SpanList<Item>& parse(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, InputRange&& input,
+                                const LookaheadMode& lookahead, ParseStats& stats)
+    {
+        reset();
+        m_state_sets = detail::recognize<Token, UseLeo>(rule_set, start_symbol, std::forward<InputRange>(input),
+                                                        std::move(m_state_sets), m_scratch, &m_leo_items, lookahead,
+                                                        detail::NoForest{}, stats);
+        return m_state_sets;
+    }
+
+    /* Checks if the input is a match of the start symbol, for when only that (and not a parse tree) is
+       needed. The input is read only up to the first token that no match can contain, and the state sets
+       that can no longer be used are reclaimed as the input is read (see Recognizer::set_reclaim_state_sets),
+       so the items kept are the live ones plus at most about one per token, instead of all of them. Reclaiming
+       takes time linear in the input (see detail::StateSetReclaimer). */
+    template<typename Token, std::ranges::input_range InputRange, OptionalTokenMode LookaheadMode = detail::NoLookahead>
+        requires GrammarSymbol<Symbol, Token> && std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+    RecognizeResult recognize(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, InputRange&& input,
+                              const LookaheadMode& lookahead = {})
+    {
+        reset();
+        return detail::recognize_only<Token, UseLeo>(rule_set, start_symbol, std::forward<InputRange>(input),
+                                                     m_state_sets, m_scratch, &m_leo_items, lookahead, m_reclaimer);
+    }
+
+    /* Removes the output of the last parse without freeing any memory */
+    void reset() noexcept
+    {
+        m_state_sets.clear();
+        m_leo_items.clear();
+        m_scratch.clear();
+    }
+
+    /* If thread_count is more than 1, later parses use that many threads (including the calling one) to
+       complete the items of large state sets, which helps with highly ambiguous inputs whose state sets have
+       many completed items. The state sets are the same as with one thread. */
+    void set_completion_threads(size_t thread_count)
+    {
+        m_workers = thread_count > 1 ? std::make_unique<WorkerPool>(thread_count) : nullptr;
+        m_scratch.workers = m_workers.get();
+    }
+
+    /* The state sets of the last parse */
+    const SpanList<Item>& state_sets() const noexcept { return m_state_sets; }
+    /* The Leo items of the last parse (always empty if UseLeo is false) */
+    const SpanList<BasicLeoItem<Item>>& leo_items() const noexcept { return m_leo_items; }
+private:
+    SpanList<Item> m_state_sets;
+    SpanList<BasicLeoItem<Item>> m_leo_items;
+    detail::ParseScratch<Symbol, Item> m_scratch;
+    detail::StateSetReclaimer<Item> m_reclaimer{true};
+    std::unique_ptr<WorkerPool> m_workers;
+};
+
+/* Same as Parser::recognize, with Leo items so that right-recursive rules also take bounded memory */
+template<typename Token, typename Symbol, std::ranges::input_range InputRange,
+         OptionalTokenMode LookaheadMode = detail::NoLookahead>
+    requires GrammarSymbol<Symbol, Token> && std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+RecognizeResult recognize(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, InputRange&& input,
+                          const LookaheadMode& lookahead = {})
+{
+    Parser<Symbol, true> parser;
+    return parser.template recognize<Token>(rule_set, start_symbol, std::forward<InputRange>(input), lookahead);
 }
 
-struct ParseResult {
+/* A push-mode recognizer: instead of reading the input from a range, it is given the input one token (or
+   span of tokens) at a time with feed, and finish is called once the input ends. Each token is processed as
+   soon as it is fed, so the input never needs to be buffered, and a rejected input is reported as soon as no
+   item can match it. The state sets after finish are the same as the ones parse returns for the whole input.
+   The rule set must outlive the Recognizer. If UseLeo is true, the recognizer uses Leo items (see the parse
+   overload that takes leo_items). Item is the type of the items in the state sets (see BasicEarleyItem).
+
+   For long streams of input, see set_reclaim_state_sets. */
+template<typename Symbol, typename RuleSetType = RuleSet<Symbol>, typename LookaheadMode = detail::NoLookahead,
+         bool UseLeo = false, typename Item = EarleyItem>
+class Recognizer {
+public:
+    /* item_capacity is the number of items to initially reserve memory for, and memory_options is how
+       that memory is allocated (see BigArrayOptions) */
+    explicit
+    Recognizer(const RuleSetType& rule_set, Symbol start_symbol, size_t item_capacity = 4096,
+               const BigArrayOptions& memory_options = {})
+        : Recognizer(rule_set, start_symbol, LookaheadMode{}, item_capacity, memory_options) {}
+
+    /* Same as the other constructor, using the given lookahead mode (see Lookahead and ClassifyTokens) */
+    Recognizer(const RuleSetType& rule_set, Symbol start_symbol, const std::type_identity_t<LookaheadMode>& lookahead,
+               size_t item_capacity = 4096, const BigArrayOptions& memory_options = {})
+        : m_rule_set(&rule_set), m_start_symbol(start_symbol), m_lookahead(lookahead),
+          m_state_sets(item_capacity, memory_options), m_leo_items(UseLeo ? item_capacity : 1, memory_options)
+    {
+        detail::check_item_layout<Item>(rule_set);
+        reset();
+    }
+
+    /* Processes the next token of the input. Returns false if the input has been rejected (i.e. no input
+       starting with the tokens fed so far can be recognized), in which case later tokens are ignored.
+       Throws std::runtime_error if the state sets cannot grow (see BigArray and SpanList) or the input is
+       too long for Item; the state sets are then left partly processed, so the Recognizer can only be
+       used again after reset. */
+    template<typename Token>
+        requires GrammarSymbol<Symbol, Token>
+    bool feed(const Token& token)
+    {
+        assert(!m_is_finished);
+        if(!is_rejected()) {
+            detail::process_state_set<UseLeo>(*m_rule_set, m_state_sets, m_pos, token, m_scratch, &m_leo_items,
+                                              m_lookahead, m_forest);
+            ++m_pos;
+            if(m_reclaim) {
+                m_reclaimer.template add_state_set<UseLeo>(m_state_sets, &m_leo_items, m_scratch, m_pos);
+            }
+        }
+        return !is_rejected();
+    }
+
+    /* Processes each of the given tokens in order. Returns false as soon as the input is rejected. */
+    template<typename Token, size_t Extent>
+        requires GrammarSymbol<Symbol, std::remove_const_t<Token>>
+    bool feed(std::span<Token, Extent> tokens)
+    {
+        for(const auto& token : tokens) {
+            if(!feed(token)) {
+                return false;
+            }
+        }
+        return !is_rejected();
+    }
+
+    /* Ends the input, returning its state sets (see parse). They are stored in (and reference) this
+       Recognizer, so they are only valid until it is reset. No more tokens can be fed until then. Throws
+       like feed. */
+    const SpanList<Item>& finish()
+    {
+        if(!is_rejected() && !m_is_finished) {
+            detail::process_state_set<UseLeo>(*m_rule_set, m_state_sets, m_pos, detail::EndOfInput{}, m_scratch,
+                                              &m_leo_items, m_lookahead, m_forest);
+        }
+        m_is_finished = true;
+        return m_state_sets;
+    }
+
+    /* Starts over with an empty input, without freeing any memory. Throws std::runtime_error if the state
+       sets have to grow to hold S(0) and cannot (see BigArray). */
+    void reset()
+    {
+        m_state_sets.clear();
+        m_leo_items.clear();
+        m_scratch.clear();
+        m_pos = 0;
+        m_is_finished = false;
+        m_reclaimer.reset();
+        // Initialize S(0)
+        m_state_sets.add_span();
+        for(auto rule_idx : (*m_rule_set)[m_start_symbol]) {
+            m_state_sets.emplace_back(rule_idx, 0);
+        }
+    }
+
+    /* If reclaim is true, the items of state sets that can no longer be used by the recognizer are removed
+       as tokens are fed, and their memory is reused for new items. A state set is only used while an item
+       that started in it can still be completed, so for recognizing long streams (e.g. with a rule like
+       Stream -> Stream Record) memory stays bounded by the items that are still live instead of growing
+       with the input. The removed state sets are left empty, so they cannot be used to build a parse tree,
+       but the last state set (and so find_full_parse) is unaffected. */
+    void set_reclaim_state_sets(bool reclaim) noexcept { m_reclaim = reclaim; }
+
+    /* True if no input starting with the tokens fed so far can be recognized */
+    bool is_rejected() const noexcept { return m_state_sets[m_pos].empty(); }
+    bool is_finished() const noexcept { return m_is_finished; }
+    /* True if finish has been called and the input is a match of the start symbol */
+    bool is_accepted() const noexcept
+    {
+        return m_is_finished && std::ranges::any_of(m_state_sets[m_pos], [this](auto item) {
+            auto dotted = m_rule_set->dotted_rule(item);
+            return item.start_pos == 0 && dotted.is_completed && dotted.symbol == m_start_symbol;
+        });
+    }
+    /* Number of tokens fed (and not ignored) so far */
+    size_t position() const noexcept { return m_pos; }
+    /* The state sets of the tokens fed so far. The last one is the state set that the next token will be
+       scanned from; it is only complete once finish has been called. */
+    const SpanList<Item>& state_sets() const noexcept { return m_state_sets; }
+    /* The Leo items of the tokens fed so far (always empty if UseLeo is false) */
+    const SpanList<BasicLeoItem<Item>>& leo_items() const noexcept { return m_leo_items; }
+private:
+    const RuleSetType* m_rule_set;
+    Symbol m_start_symbol;
+    [[no_unique_address]] LookaheadMode m_lookahead;
+    [[no_unique_address]] detail::NoForest m_forest;
+    SpanList<Item> m_state_sets;
+    SpanList<BasicLeoItem<Item>> m_leo_items;
+    detail::ParseScratch<Symbol, Item> m_scratch;
+    size_t m_pos = 0;
+    bool m_is_finished = false;
+    bool m_reclaim = false;
+    detail::StateSetReclaimer<Item> m_reclaimer;
+};
+
+template<typename RuleSetType, typename Symbol, TokenMode LookaheadMode>
+Recognizer(const RuleSetType&, Symbol, const LookaheadMode&) -> Recognizer<Symbol, RuleSetType, LookaheadMode>;
+template<typename RuleSetType, typename Symbol, TokenMode LookaheadMode>
+Recognizer(const RuleSetType&, Symbol, const LookaheadMode&, size_t) -> Recognizer<Symbol, RuleSetType, LookaheadMode>;
+
+template<typename Item = EarleyItem>
+struct BasicParseResult {
     constexpr
-    ParseResult() = default;
+    BasicParseResult() = default;
     constexpr
-    ParseResult(StateSetIterator state_set, EarleyItemIterator item)
+    BasicParseResult(BasicStateSetIterator<Item> state_set, BasicEarleyItemIterator<Item> item)
         : state_set(state_set), item(item) {}
 
-    StateSetIterator state_set;
-    EarleyItemIterator item;
+    BasicStateSetIterator<Item> state_set;
+    BasicEarleyItemIterator<Item> item;
 
     constexpr
-    operator bool() const noexcept { return item != EarleyItemIterator{}; }
+    operator bool() const noexcept { return item != BasicEarleyItemIterator<Item>{}; }
 };
 
+using ParseResult = BasicParseResult<EarleyItem>;
+
 /* Finds an Earley item (and its containing state set) that has the given symbol and
    matches the full input. If no such Earley item exists, it returns a result that
    evaluates to false. */
-template<typename Symbol>
+template<typename Symbol, typename Item>
 constexpr
-ParseResult find_full_parse(std::span<const Rule<Symbol>> rules, Symbol symbol,
-                            const SpanList<EarleyItem>& state_sets, std::ranges::input_range auto&& input)
+BasicParseResult<Item> find_full_parse(std::span<const Rule<Symbol>> rules, Symbol symbol,
+                                       const SpanList<Item>& state_sets, std::ranges::input_range auto&& input)
 {
-    if(state_sets.size() < input.size()) {
+    if(state_sets.size() <= input.size()) {
         return {};
     }
 
     auto state_set = state_sets.begin() + input.size();
-    auto full_parse = std::ranges::find_if(*state_set, [&rules, symbol](const auto& item) {
+    auto is_full_parse = [&rules, symbol](const auto& item) {
         const auto& rule = rules[item.rule_idx];
         return is_completed(item, rule.components.size())
             && item.start_pos == 0
             && rule.symbol == symbol;
-    });
+    };
+    if constexpr(::detail::ScannableItem<Item>) {
+        if(!std::is_constant_evaluated()) {
+            // Only the items starting at 0 need to be looked up in rules
+            const auto start_pos_mask = ::detail::item_bits(Item(0, std::numeric_limits<typename Item::position_type>::max(), 0));
+            const Item* first = state_set->data();
+            const Item* last = first + state_set->size();
+            while((first = ::detail::find_masked(first, last, start_pos_mask, 0)) != last) {
+                if(is_full_parse(*first)) {
+                    return {state_set, state_set->begin() + (first - state_set->data())};
+                }
+                ++first;
+            }
+            return {};
+        }
+    }
+    auto full_parse = std::ranges::find_if(*state_set, is_full_parse);
     if(full_parse == state_set->end()) {
         return {};
     }
@@ -252,10 +2162,9 @@ ParseResult find_full_parse(std::span<const Rule<Symbol>> rules, Symbol symbol,
 
 /* Find a completed Earley item with the given symbol as its left-hand side in the provided range of
    Earley items */
-template<typename Symbol>
+template<typename Symbol, std::forward_iterator ItemIterator>
 constexpr
-EarleyItemIterator find_completed_item(std::span<const Rule<Symbol>> rules,
-                                       EarleyItemIterator first, EarleyItemIterator limit, Symbol comp_sym)
+ItemIterator find_completed_item(std::span<const Rule<Symbol>> rules, ItemIterator first, ItemIterator limit, Symbol comp_sym)
 {
     return std::ranges::find_if(first, limit, [rules, comp_sym](const auto& item) {
         const auto& item_rule = rules[item.rule_idx];
@@ -275,11 +2184,76 @@ EarleyItemIterator find_completed_item(std::span<const Rule<Symbol>> rules,
     });
 }
 
+namespace detail {
+
+/* Calls callback on each completed item in state_set that the Leo-mode recognizer did not add since
+   it was on a deterministic reduction path, until callback returns true. */
+template<typename Symbol, typename Item, typename Callback>
+void for_each_leo_skipped_item(std::span<const Rule<Symbol>> rules, const SpanList<Item>& state_sets,
+                               const SpanList<BasicLeoItem<Item>>& leo_items, BasicStateSetIterator<Item> state_set,
+                               Callback&& callback)
+{
+    using SymbolTraits = symbol_traits<Symbol>;
+    auto set_pos = (size_t)(state_set - state_sets.begin());
+    for(auto item : *state_set) {
+        const auto& rule = rules[item.rule_idx];
+        if(!is_completed(item, rule.components.size()) || item.start_pos >= set_pos) {
+            continue;
+        }
+        // Retrace the reduction path that was followed when this item was completed
+        auto symbol = rule.symbol;
+        auto origin = item.start_pos;
+        while(const auto* leo_item = find_leo_item(leo_items[origin], SymbolTraits::to_index(symbol))) {
+            // The single item in the origin state set that is waiting on symbol
+            auto parent = std::ranges::find_if(state_sets[origin], [&rules, symbol](const auto& origin_item) {
+                const auto& origin_rule = rules[origin_item.rule_idx];
+                return !is_completed(origin_item, origin_rule.components.size())
+                    && next_symbol(origin_rule, origin_item) == symbol;
+            });
+            Item skipped_item = parent->advanced();
+            if(skipped_item == leo_item->top) {
+                break;
+            }
+            if(callback(skipped_item)) {
+                return;
+            }
+            symbol = rules[skipped_item.rule_idx].symbol;
+            origin = skipped_item.start_pos;
+        }
+    }
+}
+
+} // namespace detail
+
+/* Find a completed Earley item with the given symbol as its left-hand side in the given state set
+   of the output of the Leo-mode recognizer. Unlike the other overload, this also finds the items
+   that were left out of the state set because they were on a deterministic reduction path. */
+template<typename Symbol, typename Item>
+std::optional<Item> find_completed_item(std::span<const Rule<Symbol>> rules, const SpanList<Item>& state_sets,
+                                        const SpanList<BasicLeoItem<Item>>& leo_items, BasicStateSetIterator<Item> state_set,
+                                        Symbol comp_sym)
+{
+    auto item = find_completed_item(rules, state_set->begin(), state_set->end(), comp_sym);
+    if(item != state_set->end()) {
+        return *item;
+    }
+    std::optional<Item> skipped_item;
+    detail::for_each_leo_skipped_item(rules, state_sets, leo_items, state_set, [&](Item candidate) {
+        if(rules[candidate.rule_idx].symbol == comp_sym) {
+            skipped_item = candidate;
+            return true;
+        }
+        return false;
+    });
+    return skipped_item;
+}
+
 /* Given that we are iterating in reverse over the direct subcomponents of an Earley item and
 the current subcomponent is a terminal symbol, advance the state set iterator to the state
 set relevant for the next subcomponent of our traversal. */
+template<typename Item>
 constexpr
-void advance_from_terminal(StateSetIterator& state_set)
+void advance_from_terminal(BasicStateSetIterator<Item>& state_set)
 {
     --state_set;
 }
@@ -287,10 +2261,20 @@ void advance_from_terminal(StateSetIterator& state_set)
 /* Given that we are iterating in reverse over the direct subcomponents of an Earley item and
 the current subcomponent is a nonterminal, advance the state set iterator to the state set
 relevant for the next subcomponent in the traversal. */
+template<typename Item>
 constexpr
-void advance_from_nonterminal(const SpanList<EarleyItem>& state_sets, StateSetIterator& state_set, EarleyItemIterator item)
+void advance_from_nonterminal(const SpanList<Item>& state_sets, BasicStateSetIterator<Item>& state_set,
+                              BasicEarleyItemIterator<Item> item)
 {
     state_set = state_sets.begin() + item->start_pos;
 }
 
+/* Same as above, but for an item returned by the Leo-aware overload of find_completed_item */
+template<typename Item>
+constexpr
+void advance_from_nonterminal(const SpanList<Item>& state_sets, BasicStateSetIterator<Item>& state_set, Item item)
+{
+    state_set = state_sets.begin() + item.start_pos;
+}
+
 } // namespace earley
\ No newline at end of file
@@ -19,15 +19,17 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "earley.hpp"
 #include <ostream>
+#include <vector>
+#include <algorithm>
 
 namespace earley {
 
-template<typename Symbol>
-std::ostream& print_item(std::ostream& out, std::span<const Rule<Symbol>> rules, EarleyItem item)
+template<typename Symbol, typename Layout>
+std::ostream& print_item(std::ostream& out, std::span<const Rule<Symbol>> rules, BasicEarleyItem<Layout> item)
 {
     auto& rule = rules[item.rule_idx];
     out << rule.symbol << " -> ";
-    for(uint16_t i = 0; i < rule.components.size(); ++i) {
+    for(size_t i = 0; i < rule.components.size(); ++i) {
         if(i == item.progress) {
             out << ". ";
         }
@@ -40,8 +42,8 @@ std::ostream& print_item(std::ostream& out, std::span<const Rule<Symbol>> rules,
     return out;
 }
 
-template<typename Symbol>
-std::ostream& print_state_set(std::ostream& out, std::span<const Rule<Symbol>> rules, std::span<const earley::EarleyItem> state_set)
+template<typename Symbol, typename Item>
+std::ostream& print_state_set(std::ostream& out, std::span<const Rule<Symbol>> rules, std::span<const Item> state_set)
 {
     out << "{\n";
     for(const auto& item : state_set) {
@@ -51,4 +53,40 @@ std::ostream& print_state_set(std::ostream& out, std::span<const Rule<Symbol>> r
     return out << "}";
 }
 
+/* Prints the counts in stats, followed by the counts of the (at most) max_rules rules with the most items */
+template<typename Symbol>
+std::ostream& print_stats(std::ostream& out, std::span<const Rule<Symbol>> rules, const ParseStats& stats,
+                          size_t max_rules = 10)
+{
+    stats.for_each_counter([&out](std::string_view name, uint64_t value) {
+        out << name << ": " << value << "\n";
+    });
+    out << "state set sizes:";
+    for(size_t bucket = 0; bucket < stats.state_set_size_histogram.size(); ++bucket) {
+        if(stats.state_set_size_histogram[bucket] > 0) {
+            out << " <" << (uint64_t{1} << bucket) << ": " << stats.state_set_size_histogram[bucket];
+        }
+    }
+    out << "\n";
+
+    std::vector<uint32_t> rule_indices(stats.rule_counts.size());
+    for(uint32_t rule_idx = 0; rule_idx < rule_indices.size(); ++rule_idx) {
+        rule_indices[rule_idx] = rule_idx;
+    }
+    std::ranges::stable_sort(rule_indices, std::ranges::greater{},
+                             [&stats](uint32_t rule_idx) { return stats.rule_counts[rule_idx].items; });
+    rule_indices.resize(std::min(rule_indices.size(), max_rules));
+    for(auto rule_idx : rule_indices) {
+        const auto& counts = stats.rule_counts[rule_idx];
+        const auto& rule = rules[rule_idx];
+        out << "  " << rule.symbol << " ->";
+        for(auto component : rule.components) {
+            out << " " << component;
+        }
+        out << ": " << counts.items << " items, " << counts.duplicates << " duplicates, "
+            << counts.completions << " completions\n";
+    }
+    return out;
+}
+
 } // namespace earley
\ No newline at end of file
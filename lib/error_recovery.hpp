@@ -0,0 +1,220 @@
+/*
+Libearley parser library
+Copyright (C) 2024  Cole Blakley
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <ranges>
+#include <concepts>
+#include <algorithm>
+#include "earley.hpp"
+
+namespace earley {
+
+/* Returns the terminals that some item of state_set could scan next, i.e. the tokens that would have
+   been accepted after that state set */
+template<typename Symbol, typename Item>
+SymbolSet<Symbol> expected_terminals(const Grammar<Symbol> auto& rule_set, std::span<const Item> state_set)
+{
+    SymbolSet<Symbol> expected;
+    for(auto item : state_set) {
+        const auto& dotted = rule_set.dotted_rule(item);
+        if(!dotted.is_completed && dotted.next_is_terminal) {
+            expected.set(dotted.next_symbol);
+        }
+    }
+    return expected;
+}
+
+/* How parse_with_recovery got past an error */
+enum class RecoveryKind : uint8_t {
+    Stopped,  /* It did not: parsing stopped at the error */
+    Inserted, /* A missing terminal was inserted before the token at the error */
+    Skipped   /* One or more tokens were skipped, starting with the one at the error */
+};
+
+/* An error found by parse_with_recovery */
+template<typename Symbol>
+struct ParseError {
+    /* Index of the first token that could not be matched, or the input size if the input ended too early */
+    size_t pos = 0;
+    /* The terminals that would have been accepted at pos */
+    SymbolSet<Symbol> expected;
+    RecoveryKind recovery = RecoveryKind::Stopped;
+    /* The terminal inserted before pos (only for RecoveryKind::Inserted) */
+    Symbol inserted{};
+    /* The number of tokens skipped from pos on (only for RecoveryKind::Skipped) */
+    size_t skipped_count = 0;
+};
+
+/* Limits on the work parse_with_recovery does to get past each error. With the defaults, it stops at the
+   first error, only reporting it. */
+struct RecoveryOptions {
+    /* If true, each of the expected terminals is tried as a missing token before the one at the error */
+    bool insert_tokens = false;
+    /* The most tokens that can be skipped to get past one error */
+    size_t max_skipped_tokens = 0;
+    /* Parsing stops at this error, even if it could be recovered from */
+    size_t max_errors = SIZE_MAX;
+};
+
+/* Same as parse, but instead of stopping when no item can match a token, reports an error (with the
+   expected terminals) to errors and tries to get past it: first by inserting one of the expected
+   terminals before the token (if options.insert_tokens is set), and then by skipping up to
+   options.max_skipped_tokens tokens. Each attempt scans or processes one state set, so getting past an
+   error takes a bounded amount of work, and one pass finds the errors of the whole input. If the input
+   ends without a match of the start symbol, that is reported too, with a terminal inserted at the end
+   if one completes the match. errors is cleared first, so it is empty afterwards if and only if the
+   input matched.
+
+   An inserted terminal takes a state set of its own and a skipped token takes none, so after an error
+   the position of a state set is no longer the index of a token (and find_full_parse does not apply).
+   Only the recognizer without Leo items or lookahead supports recovery. */
+template<typename Token, typename Item = EarleyItem, GrammarSymbol<Token> Symbol, std::ranges::input_range InputRange>
+    requires std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+SpanList<Item> parse_with_recovery(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, size_t item_capacity,
+                                   InputRange&& input, std::vector<ParseError<Symbol>>& errors,
+                                   const RecoveryOptions& options = {})
+{
+    detail::check_item_layout<Item>(rule_set);
+    errors.clear();
+    detail::ParseScratch<Symbol, Item> scratch;
+    detail::NoForest forest;
+    SpanList<Item> state_sets{item_capacity};
+    auto process = [&](size_t set_pos, const auto& token) {
+        detail::process_state_set<false>(rule_set, state_sets, set_pos, token, scratch, nullptr, detail::NoLookahead{},
+                                         forest);
+    };
+    // Replaces the state sets after the one at set_pos (already processed) with the items it scans
+    //  with a terminal that is_match returns true for. Returns true if any were scanned.
+    auto rescan = [&](size_t set_pos, auto&& is_match) {
+        state_sets.truncate(set_pos + 1);
+        // The removed state sets may have been indexed
+        scratch.waiting_items.clear();
+        state_sets.add_span();
+        for(size_t offset = 0; offset < state_sets[set_pos].size(); ++offset) {
+            Item item = state_sets[set_pos][offset];
+            const auto& dotted = rule_set.dotted_rule(item);
+            if(!dotted.is_completed && dotted.next_is_terminal && is_match(dotted.next_symbol)) {
+                state_sets.emplace_back(item.advanced());
+            }
+        }
+        return !state_sets[set_pos + 1].empty();
+    };
+    auto is_accepted = [&](size_t set_pos) {
+        return std::ranges::any_of(state_sets[set_pos], [&](Item item) {
+            const auto& dotted = rule_set.dotted_rule(item);
+            return item.start_pos == 0 && dotted.is_completed && dotted.symbol == start_symbol;
+        });
+    };
+
+    // Initialize S(0)
+    state_sets.add_span();
+    for(auto rule_idx : rule_set[start_symbol]) {
+        state_sets.emplace_back(rule_idx, 0);
+    }
+    if(state_sets[0].empty()) {
+        errors.push_back({0, {}});
+        return state_sets;
+    }
+
+    size_t set_pos = 0;
+    size_t token_pos = 0;
+    auto curr_token = std::ranges::begin(input);
+    auto end_token = std::ranges::end(input);
+    while(curr_token != end_token) {
+        const Token token = *curr_token;
+        process(set_pos, token);
+        ++curr_token;
+        if(!state_sets[set_pos + 1].empty()) {
+            ++set_pos;
+            ++token_pos;
+            continue;
+        }
+
+        ParseError<Symbol> error{token_pos, expected_terminals<Symbol>(rule_set, state_sets[set_pos])};
+        if(errors.size() + 1 >= options.max_errors) {
+            errors.push_back(error);
+            return state_sets;
+        }
+        if(options.insert_tokens) {
+            for(auto terminal : rule_set.terminals) {
+                if(!error.expected.test(terminal)) {
+                    continue;
+                }
+                rescan(set_pos, [terminal](Symbol next) { return next == terminal; });
+                process(set_pos + 1, token);
+                if(!state_sets[set_pos + 2].empty()) {
+                    error.recovery = RecoveryKind::Inserted;
+                    error.inserted = terminal;
+                    set_pos += 2;
+                    break;
+                }
+            }
+        }
+        // Skipping a token leaves the state set as it was, to scan the next token
+        for(size_t skipped_count = 1;
+            error.recovery == RecoveryKind::Stopped && skipped_count <= options.max_skipped_tokens && curr_token != end_token;
+            ++skipped_count) {
+            const Token next_token = *curr_token;
+            ++curr_token;
+            if(rescan(set_pos, [&next_token](Symbol next) { return matches_terminal(next, next_token); })) {
+                error.recovery = RecoveryKind::Skipped;
+                error.skipped_count = skipped_count;
+                token_pos += skipped_count;
+                ++set_pos;
+            }
+        }
+        errors.push_back(error);
+        if(error.recovery == RecoveryKind::Stopped) {
+            // Like parse, end with the empty state set after the error
+            state_sets.truncate(set_pos + 1);
+            state_sets.add_span();
+            return state_sets;
+        }
+        ++token_pos;
+    }
+
+    process(set_pos, detail::EndOfInput{});
+    if(!is_accepted(set_pos)) {
+        ParseError<Symbol> error{token_pos, expected_terminals<Symbol>(rule_set, state_sets[set_pos])};
+        if(options.insert_tokens && errors.size() + 1 < options.max_errors) {
+            for(auto terminal : rule_set.terminals) {
+                if(!error.expected.test(terminal)) {
+                    continue;
+                }
+                rescan(set_pos, [terminal](Symbol next) { return next == terminal; });
+                process(set_pos + 1, detail::EndOfInput{});
+                if(is_accepted(set_pos + 1)) {
+                    error.recovery = RecoveryKind::Inserted;
+                    error.inserted = terminal;
+                    break;
+                }
+            }
+            if(error.recovery == RecoveryKind::Stopped) {
+                state_sets.truncate(set_pos + 1);
+                state_sets.add_span();
+            }
+        }
+        errors.push_back(error);
+    }
+    return state_sets;
+}
+
+} // namespace earley
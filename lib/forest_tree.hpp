@@ -0,0 +1,250 @@
+/*
+Libearley parser library
+Copyright (C) 2024  Cole Blakley
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <span>
+#include <vector>
+#include "earley.hpp"
+#include "parse_forest.hpp"
+
+namespace earley {
+
+/* One parse tree chosen out of a ParseForest, by choosing one derivation for each node under root. Each
+   node's derivation is chosen by comparing the node's derivations with each other and keeping the best
+   one, so an ambiguous forest is disambiguated without listing its trees: the time taken is linear in
+   the number of nodes and derivations. Of two derivations of a node:
+   - The one whose rule has the lower priority is chosen, since rules with higher priorities bind more
+     tightly (see Rule)
+   - Otherwise, if both rules are Left associative, the one whose last component starts later is chosen
+     (so "1-2-3" is "(1-2)-3"), and if both are Right associative, the one whose last component starts
+     earlier is chosen (so "2^3^4" is "2^(3^4)")
+   - Otherwise, the one with the lower rule index is chosen, then the one whose last component starts later
+   The same comparison splits the components within a rule (e.g. "a b c" for a rule S -> A A). A
+   derivation that has a child spanning the same input as the node is only chosen if the child can be
+   derived without the node, so cyclic grammars (e.g. S -> S) have finite trees too. The forest must
+   outlive the ForestTree. */
+template<typename Symbol>
+class ForestTree {
+public:
+    ForestTree(std::span<const Rule<Symbol>> rules, const ParseForest<Symbol>& forest, ForestNodeId root)
+        : m_rules(rules), m_forest(&forest), m_root(root), m_derivations(forest.num_of_nodes(), no_derivation)
+    {
+        if(root != no_forest_node) {
+            choose_derivations(ground(), root);
+        }
+    }
+
+    /* The root of the tree, or no_forest_node if the tree is empty */
+    ForestNodeId root() const noexcept { return m_root; }
+    bool empty() const noexcept { return m_root == no_forest_node; }
+
+    /* Returns true if node is a symbol or intermediate node of the tree */
+    bool contains(ForestNodeId node) const noexcept
+    {
+        return node < m_derivations.size() && m_derivations[node].rule_idx != no_derivation.rule_idx;
+    }
+
+    /* The derivation chosen for node, which must be a symbol or intermediate node of the tree */
+    const ForestDerivation& derivation(ForestNodeId node) const noexcept
+    {
+        assert(contains(node));
+        return m_derivations[node];
+    }
+
+    /* Calls callback on the node of each component of the rule chosen for node (a symbol node of the
+       tree), left to right. Empty components have symbol nodes with no children. */
+    template<typename Callback>
+    void for_each_child(ForestNodeId node, Callback&& callback) const
+    {
+        const auto& chosen = derivation(node);
+        for_each_prefix_child(chosen.left, callback);
+        if(chosen.right != no_forest_node) {
+            callback(chosen.right);
+        }
+    }
+private:
+    static constexpr ForestDerivation no_derivation{UINT32_MAX, no_forest_node, no_forest_node, UINT32_MAX};
+    static constexpr uint32_t ungrounded = UINT32_MAX;
+
+    /* Calls callback on each component node covered by node, the left child of a derivation */
+    template<typename Callback>
+    void for_each_prefix_child(ForestNodeId node, Callback& callback) const
+    {
+        if(node == no_forest_node) {
+            return;
+        }
+        if(!(*m_forest)[node].is_intermediate()) {
+            callback(node);
+            return;
+        }
+        const auto& chosen = m_derivations[node];
+        for_each_prefix_child(chosen.left, callback);
+        callback(chosen.right);
+    }
+
+    /* Returns the order in which each node is first found to have a finite derivation, grounded once one of its
+       derivations has only grounded (or terminal) children. A node's children in that derivation are always
+       grounded before it, so only choosing children grounded before a node when they span the same input
+       keeps the tree acyclic. */
+    std::vector<uint32_t> ground() const
+    {
+        const auto& forest = *m_forest;
+        const size_t node_count = forest.num_of_nodes();
+        std::vector<uint32_t> order(node_count, ungrounded);
+        std::vector<ForestNodeId> grounded;
+        grounded.reserve(node_count);
+        auto ground_node = [&](ForestNodeId node) {
+            if(order[node] == ungrounded) {
+                order[node] = (uint32_t)grounded.size();
+                grounded.push_back(node);
+            }
+        };
+        auto is_inner_child = [&](ForestNodeId child) {
+            return child != no_forest_node && !forest[child].is_terminal();
+        };
+
+        // Count the ungrounded children of each derivation, and index the derivations that each node is
+        //  a child of (once per occurrence)
+        std::vector<ForestNodeId> owners;
+        std::vector<ForestDerivation> derivations;
+        std::vector<uint8_t> pending;
+        std::vector<uint32_t> occurrence_offsets(node_count + 1);
+        for(ForestNodeId node = 0; node < node_count; ++node) {
+            forest.for_each_derivation(node, [&](const ForestDerivation& derivation) {
+                uint8_t count = 0;
+                for(auto child : {derivation.left, derivation.right}) {
+                    if(is_inner_child(child)) {
+                        ++count;
+                        ++occurrence_offsets[child + 1];
+                    }
+                }
+                owners.push_back(node);
+                derivations.push_back(derivation);
+                pending.push_back(count);
+                if(count == 0) {
+                    ground_node(node);
+                }
+            });
+        }
+        for(size_t node = 0; node < node_count; ++node) {
+            occurrence_offsets[node + 1] += occurrence_offsets[node];
+        }
+        std::vector<uint32_t> occurrences(occurrence_offsets.back());
+        {
+            auto next_occurrence = occurrence_offsets;
+            for(uint32_t index = 0; index < derivations.size(); ++index) {
+                for(auto child : {derivations[index].left, derivations[index].right}) {
+                    if(is_inner_child(child)) {
+                        occurrences[next_occurrence[child]++] = index;
+                    }
+                }
+            }
+        }
+
+        for(size_t i = 0; i < grounded.size(); ++i) {
+            auto node = grounded[i];
+            for(auto index = occurrence_offsets[node]; index < occurrence_offsets[node + 1]; ++index) {
+                auto occurrence = occurrences[index];
+                if(--pending[occurrence] == 0) {
+                    ground_node(owners[occurrence]);
+                }
+            }
+        }
+        return order;
+    }
+
+    /* Chooses a derivation for each node under root, top-down. Each choice only depends on the node, so
+       nodes shared by several parents are only visited once. */
+    void choose_derivations(const std::vector<uint32_t>& order, ForestNodeId root)
+    {
+        const auto& forest = *m_forest;
+        assert(forest[root].is_terminal() || order[root] != ungrounded);
+        std::vector<ForestNodeId> stack{root};
+        while(!stack.empty()) {
+            auto node = stack.back();
+            stack.pop_back();
+            if(forest[node].is_terminal() || contains(node)) {
+                continue;
+            }
+            const auto& label = forest[node];
+            ForestDerivation best = no_derivation;
+            forest.for_each_derivation(node, [&](const ForestDerivation& derivation) {
+                for(auto child : {derivation.left, derivation.right}) {
+                    if(child == no_forest_node || forest[child].is_terminal()) {
+                        continue;
+                    }
+                    const auto& child_label = forest[child];
+                    if(order[child] == ungrounded
+                       || (child_label.start_pos == label.start_pos && child_label.end_pos == label.end_pos
+                           && order[child] >= order[node])) {
+                        return;
+                    }
+                }
+                if(best.rule_idx == no_derivation.rule_idx || is_preferred(label, derivation, best)) {
+                    best = derivation;
+                }
+            });
+            assert(best.rule_idx != no_derivation.rule_idx);
+            m_derivations[node] = best;
+            for(auto child : {best.right, best.left}) {
+                if(child != no_forest_node) {
+                    stack.push_back(child);
+                }
+            }
+        }
+    }
+
+    /* Where the last component of a derivation of node starts */
+    uint32_t split_pos(const ForestNode& node, const ForestDerivation& derivation) const noexcept
+    {
+        return derivation.right == no_forest_node ? node.start_pos : (*m_forest)[derivation.right].start_pos;
+    }
+
+    /* Returns true if derivation a of node is chosen over derivation b */
+    bool is_preferred(const ForestNode& node, const ForestDerivation& a, const ForestDerivation& b) const noexcept
+    {
+        const auto& rule_a = m_rules[a.rule_idx];
+        const auto& rule_b = m_rules[b.rule_idx];
+        if(rule_a.priority != rule_b.priority) {
+            return rule_a.priority < rule_b.priority;
+        }
+        auto split_a = split_pos(node, a);
+        auto split_b = split_pos(node, b);
+        if(rule_a.associativity == rule_b.associativity && split_a != split_b) {
+            switch(rule_a.associativity) {
+                case Associativity::Left:  return split_a > split_b;
+                case Associativity::Right: return split_a < split_b;
+                case Associativity::None:  break;
+            }
+        }
+        if(a.rule_idx != b.rule_idx) {
+            return a.rule_idx < b.rule_idx;
+        }
+        return split_a > split_b;
+    }
+
+    std::span<const Rule<Symbol>> m_rules;
+    const ParseForest<Symbol>* m_forest;
+    ForestNodeId m_root;
+    std::vector<ForestDerivation> m_derivations; /* Derivation chosen for each node (no_derivation if none) */
+};
+
+} // namespace earley
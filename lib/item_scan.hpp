@@ -0,0 +1,158 @@
+/*
+Libearley parser library
+Copyright (C) 2024  Cole Blakley
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+#include <type_traits>
+
+/* Linear scans over arrays of 4- or 8-byte items (e.g. the items of a state set), comparing several items per
+   instruction. The instruction set is picked at compile time: AVX2 if enabled (e.g. with -mavx2), else
+   SSE2 on x86-64 or NEON on AArch64. Define EARLEY_NO_SIMD to always use the scalar loop. */
+#if !defined(EARLEY_NO_SIMD) && defined(__AVX2__)
+    #define EARLEY_SIMD_AVX2
+    #include <immintrin.h>
+#elif !defined(EARLEY_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+    #define EARLEY_SIMD_SSE2
+    #include <emmintrin.h>
+#elif !defined(EARLEY_NO_SIMD) && defined(__aarch64__)
+    #define EARLEY_SIMD_NEON
+    #include <arm_neon.h>
+#endif
+
+namespace detail {
+
+/* Items that can be scanned as one integer lane each */
+template<typename T>
+concept ScannableItem = (sizeof(T) == sizeof(uint32_t) || sizeof(T) == sizeof(uint64_t))
+                        && std::is_trivially_copyable_v<T> && std::has_unique_object_representations_v<T>;
+
+template<ScannableItem T>
+using item_lane_t = std::conditional_t<sizeof(T) == sizeof(uint32_t), uint32_t, uint64_t>;
+
+/* Name of the instruction set used by find_masked */
+inline constexpr const char* item_scan_isa =
+#if defined(EARLEY_SIMD_AVX2)
+    "avx2";
+#elif defined(EARLEY_SIMD_SSE2)
+    "sse2";
+#elif defined(EARLEY_SIMD_NEON)
+    "neon";
+#else
+    "scalar";
+#endif
+
+template<ScannableItem T>
+constexpr
+item_lane_t<T> item_bits(const T& item) noexcept { return std::bit_cast<item_lane_t<T>>(item); }
+
+/* Returns the first item in [first, last) whose bits, masked by mask, equal value (or last if there is
+   none). mask selects the fields to compare; value must have no bits set outside of mask. */
+template<ScannableItem T>
+const T* find_masked(const T* first, const T* last, item_lane_t<T> mask, item_lane_t<T> value) noexcept
+{
+#if defined(EARLEY_SIMD_AVX2) || defined(EARLEY_SIMD_SSE2) || defined(EARLEY_SIMD_NEON)
+    constexpr bool is_wide = sizeof(T) == sizeof(uint64_t);
+#endif
+    // Each iteration compares 8 items (16 items if they are 4 bytes), returning as soon as a block has a match
+#if defined(EARLEY_SIMD_AVX2)
+    constexpr ptrdiff_t vector_items = 32 / sizeof(T);
+    const __m256i mask_lanes = is_wide ? _mm256_set1_epi64x((long long)mask) : _mm256_set1_epi32((int)mask);
+    const __m256i value_lanes = is_wide ? _mm256_set1_epi64x((long long)value) : _mm256_set1_epi32((int)value);
+    auto match_bits = [&](const T* items) {
+        __m256i lanes = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)items), mask_lanes);
+        if constexpr(is_wide) {
+            return (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(lanes, value_lanes)));
+        } else {
+            return (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(lanes, value_lanes)));
+        }
+    };
+    for(; last - first >= 2 * vector_items; first += 2 * vector_items) {
+        if(unsigned bits = match_bits(first) | (match_bits(first + vector_items) << vector_items)) {
+            return first + std::countr_zero(bits);
+        }
+    }
+#elif defined(EARLEY_SIMD_SSE2)
+    constexpr ptrdiff_t vector_items = 16 / sizeof(T);
+    const __m128i mask_lanes = is_wide ? _mm_set1_epi64x((long long)mask) : _mm_set1_epi32((int)mask);
+    const __m128i value_lanes = is_wide ? _mm_set1_epi64x((long long)value) : _mm_set1_epi32((int)value);
+    auto match_bits = [&](const T* items) {
+        __m128i lanes = _mm_loadu_si128((const __m128i*)items);
+        __m128i matches = _mm_cmpeq_epi32(_mm_and_si128(lanes, mask_lanes), value_lanes);
+        if constexpr(is_wide) {
+            // SSE2 has no 64-bit compare, so both 32-bit halves of a lane have to match
+            matches = _mm_and_si128(matches, _mm_shuffle_epi32(matches, _MM_SHUFFLE(2, 3, 0, 1)));
+            return (unsigned)_mm_movemask_pd(_mm_castsi128_pd(matches));
+        } else {
+            return (unsigned)_mm_movemask_ps(_mm_castsi128_ps(matches));
+        }
+    };
+    for(; last - first >= 4 * vector_items; first += 4 * vector_items) {
+        unsigned bits = match_bits(first) | (match_bits(first + vector_items) << vector_items)
+                        | (match_bits(first + 2 * vector_items) << 2 * vector_items)
+                        | (match_bits(first + 3 * vector_items) << 3 * vector_items);
+        if(bits) {
+            return first + std::countr_zero(bits);
+        }
+    }
+#elif defined(EARLEY_SIMD_NEON)
+    constexpr ptrdiff_t vector_items = 16 / sizeof(T);
+    auto any_match = [&](const T* items) {
+        uint32x4_t any;
+        if constexpr(is_wide) {
+            const uint64x2_t mask_lanes = vdupq_n_u64(mask);
+            const uint64x2_t value_lanes = vdupq_n_u64(value);
+            auto matches = [&](const T* block) {
+                return vceqq_u64(vandq_u64(vld1q_u64((const uint64_t*)block), mask_lanes), value_lanes);
+            };
+            any = vreinterpretq_u32_u64(vorrq_u64(vorrq_u64(matches(items), matches(items + 2)),
+                                                  vorrq_u64(matches(items + 4), matches(items + 6))));
+        } else {
+            const uint32x4_t mask_lanes = vdupq_n_u32(mask);
+            const uint32x4_t value_lanes = vdupq_n_u32(value);
+            auto matches = [&](const T* block) {
+                return vceqq_u32(vandq_u32(vld1q_u32((const uint32_t*)block), mask_lanes), value_lanes);
+            };
+            any = vorrq_u32(vorrq_u32(matches(items), matches(items + 4)), vorrq_u32(matches(items + 8), matches(items + 12)));
+        }
+        return vmaxvq_u32(any) != 0;
+    };
+    for(; last - first >= 4 * vector_items; first += 4 * vector_items) {
+        if(any_match(first)) {
+            // Find which item of the block matched
+            break;
+        }
+    }
+#endif
+    for(; first != last; ++first) {
+        if((item_bits(*first) & mask) == value) {
+            return first;
+        }
+    }
+    return last;
+}
+
+/* Returns the first item in [first, last) equal to item (or last if there is none) */
+template<ScannableItem T>
+const T* find_item(const T* first, const T* last, const T& item) noexcept
+{
+    return find_masked(first, last, (item_lane_t<T>)~item_lane_t<T>{0}, item_bits(item));
+}
+
+} // namespace detail
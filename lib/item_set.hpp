@@ -0,0 +1,219 @@
+/*
+Libearley parser library
+Copyright (C) 2024  Cole Blakley
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <bit>
+#include <type_traits>
+
+namespace detail {
+
+/* Hashes the given bytes, one 64-bit word at a time */
+inline
+uint64_t hash_bytes(const char* bytes, size_t size) noexcept
+{
+    uint64_t hash = 0;
+    for(size_t offset = 0; offset < size; offset += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes + offset, std::min(sizeof(uint64_t), size - offset));
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+} // namespace detail
+
+/* Open-addressing hash set of small, trivially copyable items. Clearing takes constant time
+   and keeps all allocated slots, so a single ItemSet can be reused for every state set of a
+   parse without allocating. */
+template<typename T>
+    requires std::is_trivially_copyable_v<T> && std::has_unique_object_representations_v<T>
+class ItemSet {
+public:
+    explicit
+    ItemSet(size_t initial_capacity = 64)
+        : slots(std::bit_ceil(std::max<size_t>(initial_capacity, 2))) {}
+
+    /* Adds value to the set. Returns true if value was not already in the set. */
+    bool insert(const T& value)
+    {
+        if((m_size + 1) * 2 > slots.size()) {
+            grow();
+        }
+        Slot& slot = find_slot((const char*)&value);
+        if(slot.generation == generation) {
+            return false;
+        }
+        std::memcpy(slot.value, &value, sizeof(T));
+        slot.generation = generation;
+        ++m_size;
+        return true;
+    }
+
+    bool contains(const T& value) const noexcept
+    {
+        return const_cast<ItemSet*>(this)->find_slot((const char*)&value).generation == generation;
+    }
+
+    /* Removes all items from the set without freeing any memory */
+    void clear() noexcept
+    {
+        m_size = 0;
+        if(++generation == 0) {
+            // Generation counter wrapped around, so old stamps could be mistaken for live slots
+            for(auto& slot : slots) {
+                slot.generation = 0;
+            }
+            generation = 1;
+        }
+    }
+
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+    size_t capacity() const noexcept { return slots.size(); }
+private:
+    struct Slot {
+        alignas(T) char value[sizeof(T)];
+        uint32_t generation = 0; /* Slot is occupied only if this matches ItemSet::generation */
+    };
+
+    /* Returns the slot holding the item with the given representation, or the empty slot where
+       it would be inserted */
+    Slot& find_slot(const char* value) noexcept
+    {
+        size_t mask = slots.size() - 1;
+        size_t index = detail::hash_bytes(value, sizeof(T)) & mask;
+        while(slots[index].generation == generation
+              && std::memcmp(slots[index].value, value, sizeof(T)) != 0) {
+            index = (index + 1) & mask;
+        }
+        return slots[index];
+    }
+
+    void grow()
+    {
+        std::vector<Slot> old_slots(slots.size() * 2);
+        old_slots.swap(slots);
+        auto old_generation = generation;
+        generation = 1;
+        for(const auto& slot : old_slots) {
+            if(slot.generation == old_generation) {
+                Slot& new_slot = find_slot(slot.value);
+                new_slot = slot;
+                new_slot.generation = generation;
+            }
+        }
+    }
+
+    std::vector<Slot> slots;
+    size_t m_size = 0;
+    uint32_t generation = 1;
+};
+
+/* Open-addressing hash map with small, trivially copyable keys and values. Like ItemSet, clearing
+   takes constant time and keeps all allocated slots. */
+template<typename Key, typename Value>
+    requires std::is_trivially_copyable_v<Key> && std::has_unique_object_representations_v<Key>
+             && std::is_trivially_copyable_v<Value> && std::default_initializable<Value>
+class ItemMap {
+public:
+    explicit
+    ItemMap(size_t initial_capacity = 64)
+        : slots(std::bit_ceil(std::max<size_t>(initial_capacity, 2))) {}
+
+    /* Returns the value of key, first adding key with the given value if it is not already in the map.
+       The returned reference is invalidated by the next insertion. */
+    Value& try_emplace(const Key& key, const Value& value)
+    {
+        if((m_size + 1) * 2 > slots.size()) {
+            grow();
+        }
+        Slot& slot = find_slot((const char*)&key);
+        if(slot.generation != generation) {
+            std::memcpy(slot.key, &key, sizeof(Key));
+            slot.value = value;
+            slot.generation = generation;
+            ++m_size;
+        }
+        return slot.value;
+    }
+
+    /* Returns the value of key, or nullptr if key is not in the map */
+    const Value* find(const Key& key) const noexcept
+    {
+        const Slot& slot = const_cast<ItemMap*>(this)->find_slot((const char*)&key);
+        return slot.generation == generation ? &slot.value : nullptr;
+    }
+
+    /* Removes all keys from the map without freeing any memory */
+    void clear() noexcept
+    {
+        m_size = 0;
+        if(++generation == 0) {
+            for(auto& slot : slots) {
+                slot.generation = 0;
+            }
+            generation = 1;
+        }
+    }
+
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+    size_t capacity() const noexcept { return slots.size(); }
+private:
+    struct Slot {
+        alignas(Key) char key[sizeof(Key)];
+        Value value;
+        uint32_t generation = 0; /* Slot is occupied only if this matches ItemMap::generation */
+    };
+
+    Slot& find_slot(const char* key) noexcept
+    {
+        size_t mask = slots.size() - 1;
+        size_t index = detail::hash_bytes(key, sizeof(Key)) & mask;
+        while(slots[index].generation == generation
+              && std::memcmp(slots[index].key, key, sizeof(Key)) != 0) {
+            index = (index + 1) & mask;
+        }
+        return slots[index];
+    }
+
+    void grow()
+    {
+        std::vector<Slot> old_slots(slots.size() * 2);
+        old_slots.swap(slots);
+        auto old_generation = generation;
+        generation = 1;
+        for(const auto& slot : old_slots) {
+            if(slot.generation == old_generation) {
+                Slot& new_slot = find_slot(slot.key);
+                new_slot = slot;
+                new_slot.generation = generation;
+            }
+        }
+    }
+
+    std::vector<Slot> slots;
+    size_t m_size = 0;
+    uint32_t generation = 1;
+};
@@ -0,0 +1,397 @@
+/*
+Libearley parser library
+Copyright (C) 2024  Cole Blakley
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <vector>
+#include <map>
+#include <optional>
+#include <span>
+#include <ranges>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include "earley.hpp"
+#include "item_set.hpp"
+#include "item_scan.hpp"
+
+/* An alternative recognizer that runs on an LR(0) automaton of the grammar, with the advances past nullable
+   symbols built into its states (Aycock and Horspool, "Practical Earley Parsing", 2002). Each state of the
+   automaton is a set of dotted rules, so a state set holds one (state, origin) item where the other
+   recognizer holds one Earley item per dotted rule. As in that paper, the states are split in two: the
+   kernel states reached by scanning or completing a symbol, and the predicted states holding every item
+   predicted by a kernel state, whose origin is always the current position. */
+
+namespace earley {
+
+/* An item of the LR(0) recognizer: a state of an Lr0Automaton and the position in the input where the match
+   of the dotted rules in that state started */
+struct Lr0Item {
+    using span_offset_type = uint32_t; /* Used by SpanList */
+
+    constexpr
+    bool operator==(const Lr0Item&) const noexcept = default;
+
+    uint32_t state;
+    uint32_t start_pos;
+};
+
+template<typename Symbol>
+class Lr0Automaton {
+public:
+    using SymbolTraits = symbol_traits<Symbol>;
+    static constexpr uint32_t no_state = std::numeric_limits<uint32_t>::max();
+
+    /* A transition over a terminal */
+    struct Scan {
+        Symbol terminal;
+        uint32_t target;
+    };
+
+    struct State {
+        TableSpan items;          /* Its dotted rules, in dotted_rules() */
+        TableSpan completed;      /* Symbols of its completed rules (by symbol index), in completed_symbols */
+        TableSpan scans;          /* Its transitions over terminals, in scans */
+        TableSpan waits;          /* Symbols (by symbol index) of its transitions over nonterminals */
+        uint32_t predicted_state = no_state; /* State holding the items predicted by this one, if any */
+        bool is_accepting = false; /* True if it has a completed rule of the start symbol */
+    };
+
+    /* Builds the automaton of the grammar for matches of start_symbol. Only the rules that rule_set
+       predicts are included. */
+    Lr0Automaton(const Grammar<Symbol> auto& rule_set, Symbol start_symbol)
+    {
+        auto dotted_rule = [&](PredictedItem item) -> const DottedRule<Symbol>& {
+            return rule_set.dotted_rules.data()[rule_set.rule_offsets.data()[item.rule_idx] + item.progress];
+        };
+        std::map<std::vector<PredictedItemKey>, uint32_t> state_ids;
+        std::vector<std::vector<PredictedItemKey>> pending_items;
+        auto add_state = [&](std::vector<PredictedItemKey>&& state_items) {
+            std::ranges::sort(state_items);
+            auto [unique_end, _] = std::ranges::unique(state_items);
+            state_items.erase(unique_end, state_items.end());
+            auto [state_id, is_new] = state_ids.try_emplace(state_items, (uint32_t)pending_items.size());
+            if(is_new) {
+                pending_items.push_back(std::move(state_items));
+            }
+            return state_id->second;
+        };
+        auto predict = [&](Symbol symbol, std::vector<PredictedItemKey>& state_items) {
+            for(auto predicted_item : rule_set.prediction(symbol)) {
+                state_items.push_back(to_key(predicted_item));
+            }
+        };
+
+        std::vector<PredictedItemKey> start_items;
+        predict(start_symbol, start_items);
+        start_state = add_state(std::move(start_items));
+
+        // The items of the target of each transition of a state, by the symbol it is over
+        std::vector<std::vector<PredictedItemKey>> kernels(SymbolTraits::symbol_count);
+        std::vector<Symbol> kernel_symbols(SymbolTraits::symbol_count);
+        // Each state is expanded once, in the order states are found (which can add more states)
+        for(uint32_t state_id = 0; state_id < pending_items.size(); ++state_id) {
+            State state;
+            state.items.first = (uint32_t)m_dotted_rules.size();
+            state.completed.first = (uint32_t)completed_symbols.size();
+            std::vector<PredictedItemKey> predicted_items;
+            SymbolSet<Symbol> completed_set;
+            SymbolSet<Symbol> predicted_set;
+            SymbolSet<Symbol> terminal_kernels;
+            for(auto key : pending_items[state_id]) {
+                auto item = from_key(key);
+                m_dotted_rules.push_back(item);
+                const auto& dotted = dotted_rule(item);
+                if(dotted.is_completed) {
+                    if(!completed_set.test(dotted.symbol)) {
+                        completed_set.set(dotted.symbol);
+                        completed_symbols.push_back(SymbolTraits::to_index(dotted.symbol));
+                    }
+                    state.is_accepting |= dotted.symbol == start_symbol;
+                    continue;
+                }
+                // The target of the transition over the next symbol also has the advances past any nullable
+                //  symbols after it, since they match at the same position
+                auto& kernel = kernels[SymbolTraits::to_index(dotted.next_symbol)];
+                kernel_symbols[SymbolTraits::to_index(dotted.next_symbol)] = dotted.next_symbol;
+                if(dotted.next_is_terminal) {
+                    terminal_kernels.set(dotted.next_symbol);
+                }
+                PredictedItem advanced{item.rule_idx, item.progress + 1};
+                kernel.push_back(to_key(advanced));
+                while(!dotted_rule(advanced).is_completed && dotted_rule(advanced).next_is_nullable) {
+                    ++advanced.progress;
+                    kernel.push_back(to_key(advanced));
+                }
+                if(!dotted.next_is_terminal && !predicted_set.test(dotted.next_symbol)) {
+                    predicted_set.set(dotted.next_symbol);
+                    predict(dotted.next_symbol, predicted_items);
+                }
+            }
+            state.items.limit = (uint32_t)m_dotted_rules.size();
+            state.completed.limit = (uint32_t)completed_symbols.size();
+            if(!predicted_items.empty()) {
+                state.predicted_state = add_state(std::move(predicted_items));
+            }
+
+            gotos.resize(gotos.size() + SymbolTraits::symbol_count, no_state);
+            state.waits.first = (uint32_t)m_waiting_symbols.size();
+            std::vector<Scan> state_scans;
+            for(size_t sym_index = 0; sym_index < SymbolTraits::symbol_count; ++sym_index) {
+                if(kernels[sym_index].empty()) {
+                    continue;
+                }
+                auto target = add_state(std::move(kernels[sym_index]));
+                kernels[sym_index].clear();
+                gotos[state_id * SymbolTraits::symbol_count + sym_index] = target;
+                if(terminal_kernels.test(sym_index)) {
+                    state_scans.push_back({kernel_symbols[sym_index], target});
+                } else {
+                    m_waiting_symbols.push_back((uint32_t)sym_index);
+                }
+            }
+            state.waits.limit = (uint32_t)m_waiting_symbols.size();
+            state.scans = {(uint32_t)scans.size(), (uint32_t)(scans.size() + state_scans.size())};
+            scans.insert(scans.end(), state_scans.begin(), state_scans.end());
+            states.push_back(state);
+        }
+    }
+
+    size_t state_count() const noexcept { return states.size(); }
+    uint32_t start() const noexcept { return start_state; }
+    const State& operator[](uint32_t state_id) const noexcept { return states[state_id]; }
+
+    /* Returns the state reached from state_id over symbol (by symbol index), or no_state */
+    uint32_t transition(uint32_t state_id, size_t sym_index) const noexcept
+    {
+        return gotos[state_id * SymbolTraits::symbol_count + sym_index];
+    }
+
+    std::span<const uint32_t> completed(const State& state) const noexcept
+    {
+        return {completed_symbols.data() + state.completed.first, completed_symbols.data() + state.completed.limit};
+    }
+
+    std::span<const Scan> scan_transitions(const State& state) const noexcept
+    {
+        return {scans.data() + state.scans.first, scans.data() + state.scans.limit};
+    }
+
+    std::span<const uint32_t> waiting_symbols(const State& state) const noexcept
+    {
+        return {m_waiting_symbols.data() + state.waits.first, m_waiting_symbols.data() + state.waits.limit};
+    }
+
+    /* Returns the dotted rules (by rule index and dividing point) of state */
+    std::span<const PredictedItem> dotted_rules(const State& state) const noexcept
+    {
+        return {m_dotted_rules.data() + state.items.first, m_dotted_rules.data() + state.items.limit};
+    }
+private:
+    /* A PredictedItem packed into one integer, so that states can be sorted and compared */
+    using PredictedItemKey = uint64_t;
+
+    static
+    PredictedItemKey to_key(PredictedItem item) noexcept { return (uint64_t)item.rule_idx << 32 | item.progress; }
+    static
+    PredictedItem from_key(PredictedItemKey key) noexcept { return {(uint32_t)(key >> 32), (uint32_t)key}; }
+
+    std::vector<State> states;
+    std::vector<uint32_t> gotos; /* transition() of every state and symbol (symbol_count entries per state) */
+    std::vector<uint32_t> completed_symbols;
+    std::vector<Scan> scans;
+    std::vector<uint32_t> m_waiting_symbols;
+    std::vector<PredictedItem> m_dotted_rules;
+    uint32_t start_state = 0;
+};
+
+/* The LR(0) recognizer. Returns the same kind of state sets as parse, holding Lr0Items instead of Earley
+   items (see to_earley_items), and likewise stops after the first state set that has no items. */
+template<typename Token, GrammarSymbol<Token> Symbol, std::ranges::input_range InputRange>
+    requires std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+SpanList<Lr0Item> parse(const Lr0Automaton<Symbol>& automaton, size_t item_capacity, InputRange&& input)
+{
+    SpanList<Lr0Item> state_sets{item_capacity};
+    ItemSet<Lr0Item> curr_items;
+    // Completing a symbol only depends on the symbol and its origin, so each pair is completed once per state set
+    struct Completion {
+        uint32_t sym_index;
+        uint32_t start_pos;
+    };
+    std::vector<Completion> completions;
+    ItemSet<Completion> completion_set;
+    auto is_new_completion = [&](Completion completion) {
+        if(completions.size() < detail::min_hashed_set_size) {
+            const Completion* last = completions.data() + completions.size();
+            if(::detail::find_item(completions.data(), last, completion) != last) {
+                return false;
+            }
+        } else {
+            if(completion_set.empty()) {
+                for(auto prev_completion : completions) {
+                    completion_set.insert(prev_completion);
+                }
+            }
+            if(!completion_set.insert(completion)) {
+                return false;
+            }
+        }
+        completions.push_back(completion);
+        return true;
+    };
+    detail::WaitingIndex<Symbol> waiting_items;
+    std::vector<Lr0Item> scanned_items;
+    // Like the other recognizer, small state sets are searched linearly and larger ones with a hash set.
+    //  curr_set is the last state set, which items are added to.
+    std::span<const Lr0Item> curr_set;
+    auto add_item = [&](Lr0Item new_item) {
+        if(curr_set.size() < detail::min_hashed_set_size) {
+            const Lr0Item* last = curr_set.data() + curr_set.size();
+            if(::detail::find_item(curr_set.data(), last, new_item) != last) {
+                return false;
+            }
+        } else {
+            if(curr_items.empty()) {
+                for(auto item : curr_set) {
+                    curr_items.insert(item);
+                }
+            }
+            if(!curr_items.insert(new_item)) {
+                return false;
+            }
+        }
+        state_sets.emplace_back(new_item);
+        curr_set = state_sets[state_sets.size() - 1];
+        return true;
+    };
+    state_sets.add_span();
+    add_item({automaton.start(), 0});
+
+    auto curr_token = std::ranges::begin(input);
+    auto end_token = std::ranges::end(input);
+    for(size_t curr_pos = 0; !state_sets[curr_pos].empty(); ++curr_pos) {
+        if(curr_pos > std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error("Input is too long for the LR(0) recognizer");
+        }
+        bool at_end = curr_token == end_token;
+        std::optional<Token> token;
+        if(!at_end) {
+            token = *curr_token;
+        }
+        completions.clear();
+        completion_set.clear();
+        for(size_t offset = 0; offset < curr_set.size(); ++offset) {
+            auto item = curr_set[offset];
+            const auto& state = automaton[item.state];
+            // Items with the current position as their origin are predicted items, which already hold
+            //  everything their own predictions and completions (of nullable symbols) would add
+            if(item.start_pos != curr_pos) {
+                if(state.predicted_state != automaton.no_state) {
+                    add_item({state.predicted_state, (uint32_t)curr_pos});
+                }
+                for(auto sym_index : automaton.completed(state)) {
+                    if(!is_new_completion({sym_index, item.start_pos})) {
+                        continue;
+                    }
+                    auto start_set = state_sets[item.start_pos];
+                    auto advance = [&](Lr0Item start_item) {
+                        auto target = automaton.transition(start_item.state, sym_index);
+                        if(target != automaton.no_state && add_item({target, start_item.start_pos})) {
+                            start_set = state_sets[item.start_pos];
+                        }
+                    };
+                    if(start_set.size() >= detail::min_indexed_set_size) {
+                        if(!waiting_items.is_indexed(item.start_pos)) {
+                            waiting_items.add_state_set(item.start_pos, start_set, [&](Lr0Item start_item, auto&& visit) {
+                                for(auto waiting_sym_index : automaton.waiting_symbols(automaton[start_item.state])) {
+                                    visit(waiting_sym_index);
+                                }
+                            });
+                        }
+                        for(auto start_offset : waiting_items.waiting_on_index(item.start_pos, sym_index)) {
+                            advance(start_set[start_offset]);
+                        }
+                    } else {
+                        for(size_t start_offset = 0; start_offset < start_set.size(); ++start_offset) {
+                            advance(start_set[start_offset]);
+                        }
+                    }
+                }
+            }
+            if(!at_end) {
+                for(auto scan : automaton.scan_transitions(state)) {
+                    if(matches_terminal(scan.terminal, *token)) {
+                        scanned_items.push_back({scan.target, item.start_pos});
+                    }
+                }
+            }
+        }
+
+        state_sets.add_span();
+        curr_set = {};
+        curr_items.clear();
+        for(auto scanned_item : scanned_items) {
+            add_item(scanned_item);
+        }
+        scanned_items.clear();
+        if(!at_end) {
+            ++curr_token;
+        }
+    }
+    return state_sets;
+}
+
+/* Returns true if the LR(0) state sets hold a match of the start symbol over the first input_size tokens */
+template<typename Symbol>
+bool accepts(const Lr0Automaton<Symbol>& automaton, const SpanList<Lr0Item>& state_sets, size_t input_size)
+{
+    if(state_sets.size() <= input_size) {
+        return false;
+    }
+    return std::ranges::any_of(state_sets[input_size], [&](Lr0Item item) {
+        return item.start_pos == 0 && automaton[item.state].is_accepting;
+    });
+}
+
+/* Translates the state sets of the LR(0) recognizer into the Earley items they stand for, so that they can be
+   passed to find_full_parse and the other functions that read the output of parse. Each state set holds
+   the same items as the one parse would return (without the unpredicted items of the first one), though
+   not in the same order. */
+template<typename Item = EarleyItem, typename Symbol>
+SpanList<Item> to_earley_items(const Lr0Automaton<Symbol>& automaton, const SpanList<Lr0Item>& state_sets)
+{
+    SpanList<Item> earley_state_sets{state_sets.num_of_items() * 2};
+    ItemSet<Item> added_items;
+    for(auto state_set : state_sets) {
+        earley_state_sets.add_span();
+        added_items.clear();
+        for(auto lr0_item : state_set) {
+            for(auto dotted : automaton.dotted_rules(automaton[lr0_item.state])) {
+                Item item((typename Item::rule_index_type)dotted.rule_idx, (typename Item::position_type)lr0_item.start_pos,
+                          (typename Item::progress_type)dotted.progress);
+                if(added_items.insert(item)) {
+                    earley_state_sets.emplace_back(item);
+                }
+            }
+        }
+    }
+    return earley_state_sets;
+}
+
+} // namespace earley
@@ -0,0 +1,157 @@
+/*
+Libearley parser library
+Copyright (C) 2024  Cole Blakley
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "mapped_file.hpp"
+#include <stdexcept>
+#include <string>
+#include <cassert>
+#include <cstring>
+
+#if defined(unix) || defined(__unix) || defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static
+std::runtime_error file_error(const char* what, const char* path)
+{
+    return std::runtime_error(std::string{what} + " '" + path + "': " + strerror(errno));
+}
+
+MappedFile::MappedFile(const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        throw file_error("Failed to open", path);
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0) {
+        auto error = file_error("Failed to get the size of", path);
+        close(fd);
+        throw error;
+    }
+    m_size = (size_t)info.st_size;
+    // Empty files cannot be mapped, and are left as an empty range
+    if(m_size > 0) {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED) {
+            auto error = file_error("Failed to map", path);
+            close(fd);
+            throw error;
+        }
+        m_data = (const char*)data;
+        madvise(data, m_size, MADV_SEQUENTIAL);
+    }
+    // The mapping stays valid after the file is closed
+    close(fd);
+}
+
+MappedFile::~MappedFile() noexcept
+{
+    if(m_data != nullptr) {
+        [[maybe_unused]] int err = munmap((void*)m_data, m_size);
+        assert(err == 0);
+    }
+}
+
+/* Returns the range of whole pages in [offset, offset + size) of the mapping at data */
+static
+std::pair<char*, size_t> whole_pages(const char* data, size_t offset, size_t size) noexcept
+{
+    auto page_size = (size_t)getpagesize();
+    size_t first = (offset + page_size - 1) / page_size * page_size;
+    size_t limit = (offset + size) / page_size * page_size;
+    return {(char*)data + first, limit > first ? limit - first : 0};
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const noexcept
+{
+    // madvise needs a page-aligned address, so the start is rounded down
+    auto page_size = (size_t)getpagesize();
+    size_t first = offset / page_size * page_size;
+    madvise((void*)(m_data + first), std::min(size + (offset - first), m_size - first), MADV_WILLNEED);
+}
+
+void MappedFile::release(size_t offset, size_t size) const noexcept
+{
+    // Partial pages at the edges could still hold parts of the neighboring windows, so they are kept
+    auto [pages, byte_count] = whole_pages(m_data, offset, size);
+    if(byte_count > 0) {
+        madvise((void*)pages, byte_count, MADV_DONTNEED);
+    }
+}
+
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+MappedFile::MappedFile(const char* path)
+{
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error(std::string{"Failed to open '"} + path + "'");
+    }
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw std::runtime_error(std::string{"Failed to get the size of '"} + path + "'");
+    }
+    m_size = (size_t)size.QuadPart;
+    if(m_size > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void* data = mapping == nullptr ? nullptr : MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if(mapping != nullptr) {
+            // The view keeps the mapping alive
+            CloseHandle(mapping);
+        }
+        if(data == nullptr) {
+            CloseHandle(file);
+            throw std::runtime_error(std::string{"Failed to map '"} + path + "'");
+        }
+        m_data = (const char*)data;
+    }
+    CloseHandle(file);
+}
+
+MappedFile::~MappedFile() noexcept
+{
+    if(m_data != nullptr) {
+        [[maybe_unused]] BOOL success = UnmapViewOfFile(m_data);
+        assert(success);
+    }
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const noexcept
+{
+    WIN32_MEMORY_RANGE_ENTRY range{(void*)(m_data + offset), std::min(size, m_size - offset)};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MappedFile::release(size_t, size_t) const noexcept
+{
+    // Clean pages of a file mapping are dropped by Windows as needed
+}
+
+#else
+
+#error "Platform not supported"
+
+#endif /* ifdef (platform) */
@@ -0,0 +1,84 @@
+/*
+Libearley parser library
+Copyright (C) 2024  Cole Blakley
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <span>
+#include <string_view>
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+#include <cstddef>
+
+/* A file mapped read-only into memory, so that its contents can be parsed in place instead of being copied
+   into a buffer first (e.g. earley::parse<char>(rule_set, start_symbol, capacity, file.contents())). The
+   mapping is advised for sequential access, so the OS reads ahead of the recognizer. Throws
+   std::runtime_error if the file cannot be opened or mapped. */
+class MappedFile {
+public:
+    explicit
+    MappedFile(const char* path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept
+        : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)) {}
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        return *this;
+    }
+    ~MappedFile() noexcept;
+
+    std::span<const char> contents() const noexcept { return {m_data, m_size}; }
+    std::string_view view() const noexcept { return {m_data, m_size}; }
+    size_t size() const noexcept { return m_size; }
+    const char* begin() const noexcept { return m_data; }
+    const char* end() const noexcept { return m_data + m_size; }
+
+    /* Calls callback(window) on consecutive windows (std::span<const char>) of the contents of at most
+       window_size bytes each, stopping early if callback returns false. The pages of each window are
+       released once callback returns, so that when streaming a file too large for memory into a
+       Recognizer, the memory used by the file stays bounded by a few windows. Throws std::invalid_argument
+       if window_size is 0. */
+    template<typename Callback>
+    void for_each_window(size_t window_size, Callback&& callback) const
+    {
+        if(window_size == 0) {
+            throw std::invalid_argument("MappedFile::for_each_window: window_size must be more than 0");
+        }
+        for(size_t offset = 0; offset < m_size; offset += window_size) {
+            std::span<const char> window{m_data + offset, std::min(window_size, m_size - offset)};
+            if(offset + window_size < m_size) {
+                prefetch(offset + window_size, window_size);
+            }
+            bool keep_going = callback(window);
+            release(offset, window.size());
+            if(!keep_going) {
+                return;
+            }
+        }
+    }
+private:
+    /* Hints that [offset, offset + size) will be read soon */
+    void prefetch(size_t offset, size_t size) const noexcept;
+    /* Hints that [offset, offset + size) will not be read again, so its pages can be dropped */
+    void release(size_t offset, size_t size) const noexcept;
+
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+};
@@ -0,0 +1,126 @@
+/*
+Libearley parser library
+Copyright (C) 2024  Cole Blakley
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <ranges>
+#include <concepts>
+#include <exception>
+#include <algorithm>
+#include "earley.hpp"
+
+namespace earley {
+
+namespace detail {
+
+/* Returns true if state_sets (the output of the recognizer for an input of input_size tokens) has a
+   completed item for start_symbol spanning the whole input */
+template<typename Symbol, typename Item>
+bool accepts(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, const SpanList<Item>& state_sets, size_t input_size)
+{
+    if(state_sets.size() <= input_size) {
+        return false;
+    }
+    return std::ranges::any_of(state_sets[input_size], [&](Item item) {
+        const auto& dotted = rule_set.dotted_rule(EarleyItem{item.rule_idx, 0, item.progress});
+        return item.start_pos == 0 && dotted.is_completed && dotted.symbol == start_symbol;
+    });
+}
+
+} // namespace detail
+
+/* Recognizes each of inputs (a range of input ranges) with rule_set, on thread_count threads (one per
+   hardware thread if thread_count is 0), counting the calling thread. Each thread takes the next input
+   that has not been started yet, so long inputs do not hold up the others. Each thread parses with its
+   own Parser, so state sets are allocated once per thread instead of once per input. Each Parser is
+   created on its thread with memory_options (e.g. numa_node = BigArrayOptions::current_node, so that the
+   state sets of each thread stay on the NUMA node it started on).
+
+   callback(index, state_sets) is called on the thread that parsed inputs[index] with the output of the
+   recognizer. state_sets are only valid until callback returns, and callback may be called concurrently
+   for different inputs. If a callback, a parse or the creation of a Parser throws, no more inputs are
+   started and the exception is rethrown once the running parses finish. rule_set is only read (see RuleSet), so it may be shared. */
+template<typename Token, GrammarSymbol<Token> Symbol, std::ranges::random_access_range Inputs, typename Callback>
+    requires std::ranges::sized_range<Inputs> && std::ranges::input_range<std::ranges::range_reference_t<Inputs>>
+          && std::invocable<Callback&, size_t, const SpanList<EarleyItem>&>
+void parse_batch(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, Inputs&& inputs, Callback&& callback,
+                 size_t thread_count = 0, const BigArrayOptions& memory_options = {})
+{
+    const size_t input_count = std::ranges::size(inputs);
+    if(thread_count == 0) {
+        thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    thread_count = std::min(thread_count, input_count);
+
+    std::atomic<size_t> next_input = 0;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto run_worker = [&] {
+        // Creating the Parser can throw too (e.g. if memory_options cannot be met), and an exception
+        //  must not escape a worker thread
+        try {
+            Parser<Symbol> parser{4096, memory_options};
+            size_t index;
+            while((index = next_input.fetch_add(1, std::memory_order_relaxed)) < input_count) {
+                callback(index, parser.template parse<Token>(rule_set, start_symbol, std::ranges::begin(inputs)[index]));
+            }
+        } catch(...) {
+            // Stop the other threads from starting new inputs
+            next_input.store(input_count, std::memory_order_relaxed);
+            std::scoped_lock lock{error_mutex};
+            if(!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(thread_count == 0 ? 0 : thread_count - 1);
+        for(size_t i = 1; i < thread_count; ++i) {
+            workers.emplace_back(run_worker);
+        }
+        run_worker();
+    }
+    if(error) {
+        std::rethrow_exception(error);
+    }
+}
+
+/* Same as parse_batch, but returns whether each of inputs fully matches start_symbol. Each input must be
+   a forward range, since it is read again to find its size. */
+template<typename Token, GrammarSymbol<Token> Symbol, std::ranges::random_access_range Inputs>
+    requires std::ranges::sized_range<Inputs> && std::ranges::forward_range<std::ranges::range_reference_t<Inputs>>
+std::vector<bool> parse_batch(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, Inputs&& inputs,
+                              size_t thread_count = 0, const BigArrayOptions& memory_options = {})
+{
+    // std::vector<bool> packs its elements, so threads cannot write to it at the same time
+    std::vector<uint8_t> accepted(std::ranges::size(inputs));
+    parse_batch<Token>(rule_set, start_symbol, inputs, [&](size_t index, const SpanList<EarleyItem>& state_sets) {
+        auto input_size = (size_t)std::ranges::distance(std::ranges::begin(inputs)[index]);
+        accepted[index] = detail::accepts(rule_set, start_symbol, state_sets, input_size);
+    }, thread_count, memory_options);
+    return {accepted.begin(), accepted.end()};
+}
+
+} // namespace earley
@@ -0,0 +1,237 @@
+/*
+Libearley parser library
+Copyright (C) 2024  Cole Blakley
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <ranges>
+#include <concepts>
+#include "big_array.hpp"
+#include "item_set.hpp"
+#include "earley.hpp"
+
+namespace earley {
+
+/* Index of a node in a ParseForest */
+using ForestNodeId = uint32_t;
+
+/* Used in place of a ForestNodeId when there is no node */
+inline constexpr ForestNodeId no_forest_node = UINT32_MAX;
+
+/* A node of a ParseForest. Each node stands for every derivation of its label from the tokens in
+   [start_pos, end_pos):
+   - Symbol nodes are labeled by a symbol
+   - Terminal nodes are labeled by a terminal (and always span one token)
+   - Intermediate nodes are labeled by the first progress components of a rule. They binarize the forest,
+     so that a node never has more than two children in one derivation. */
+struct ForestNode {
+    static constexpr uint16_t symbol_progress = UINT16_MAX;
+    static constexpr uint16_t terminal_progress = UINT16_MAX - 1;
+
+    uint16_t id;       /* Symbol index (symbol and terminal nodes) or rule index (intermediate nodes) */
+    uint16_t progress; /* symbol_progress, terminal_progress, or the progress of an intermediate node */
+    uint32_t start_pos;
+    uint32_t end_pos;
+
+    constexpr
+    bool is_symbol() const noexcept { return progress == symbol_progress; }
+    constexpr
+    bool is_terminal() const noexcept { return progress == terminal_progress; }
+    constexpr
+    bool is_intermediate() const noexcept { return progress < terminal_progress; }
+    constexpr
+    bool is_empty() const noexcept { return start_pos == end_pos; }
+
+    constexpr
+    bool operator==(const ForestNode&) const noexcept = default;
+};
+
+/* One derivation of a node (a packed node): the rule used, the node for all but the last of its
+   components (no_forest_node if there is at most one component), and the node for its last component
+   (no_forest_node if the rule is empty). */
+struct ForestDerivation {
+    uint32_t rule_idx;
+    ForestNodeId left;
+    ForestNodeId right;
+    uint32_t next; /* Index of the node's next derivation */
+};
+
+/* A binarized shared packed parse forest (SPPF) of every parse of an input, built by the recognizer (see
+   the overload of parse that takes a ParseForest). Each (label, start, end) triple gets exactly one node, so
+   subtrees shared between parses are stored once and ambiguity is represented with multiple derivations
+   of one node instead of multiple trees. Nodes and derivations are kept in arenas that are only freed
+   along with the ParseForest. */
+template<typename Symbol>
+class ParseForest {
+public:
+    using SymbolTraits = symbol_traits<Symbol>;
+
+    explicit
+    ParseForest(size_t node_capacity = 4096)
+        : m_nodes(node_capacity), m_derivations(node_capacity), first_derivations(node_capacity), node_ids(node_capacity),
+          derivation_keys(node_capacity) {}
+
+    const ForestNode& operator[](ForestNodeId node) const noexcept { return m_nodes[node]; }
+    size_t num_of_nodes() const noexcept { return m_nodes.size(); }
+    size_t num_of_derivations() const noexcept { return m_derivations.size(); }
+
+    /* Returns the node for all derivations of symbol from [start_pos, end_pos), or no_forest_node if
+       there are none. The node for the start symbol spanning the whole input is the root of the forest. */
+    ForestNodeId find_symbol_node(Symbol symbol, uint32_t start_pos, uint32_t end_pos) const noexcept
+    {
+        auto id = node_ids.find({(uint16_t)SymbolTraits::to_index(symbol), ForestNode::symbol_progress, start_pos, end_pos});
+        return id == nullptr ? no_forest_node : *id;
+    }
+
+    /* Calls callback on each derivation of node */
+    template<typename Callback>
+    void for_each_derivation(ForestNodeId node, Callback&& callback) const
+    {
+        for(auto index = first_derivations[node]; index != no_derivation; index = m_derivations[index].next) {
+            callback(m_derivations[index]);
+        }
+    }
+
+    /* Returns true if node has more than one derivation */
+    bool is_ambiguous(ForestNodeId node) const noexcept
+    {
+        auto first = first_derivations[node];
+        return first != no_derivation && m_derivations[first].next != no_derivation;
+    }
+
+    /* Removes all nodes without freeing any memory */
+    void clear() noexcept
+    {
+        m_nodes.clear();
+        m_derivations.clear();
+        first_derivations.clear();
+        node_ids.clear();
+        derivation_keys.clear();
+        derivation_keys_end = 0;
+    }
+
+    /* The functions below are called by the recognizer as it adds items */
+
+    ForestNodeId symbol_node(Symbol symbol, uint32_t start_pos, uint32_t end_pos)
+    {
+        return get_node({(uint16_t)SymbolTraits::to_index(symbol), ForestNode::symbol_progress, start_pos, end_pos});
+    }
+
+    ForestNodeId terminal_node(Symbol terminal, uint32_t pos)
+    {
+        return get_node({(uint16_t)SymbolTraits::to_index(terminal), ForestNode::terminal_progress, pos, pos + 1});
+    }
+
+    /* Records that item, in the state set at end_pos, was derived by advancing prev_item (in the state set at
+       prev_end_pos) over the component whose node is child */
+    void add_derivation(const Grammar<Symbol> auto& rule_set, EarleyItem item, uint32_t end_pos,
+                        EarleyItem prev_item, uint32_t prev_end_pos, ForestNodeId child)
+    {
+        if(item.progress == 1 && !rule_set.dotted_rule(item).is_completed) {
+            // The node of the item is child itself
+            return;
+        }
+        auto left = item_node(rule_set, prev_item, prev_end_pos);
+        add_derivation(item_node(rule_set, item, end_pos), end_pos, item.rule_idx, left, child);
+    }
+
+    /* Records that item, a completed item for an empty rule, is in the state set at pos */
+    void add_empty_derivation(const Grammar<Symbol> auto& rule_set, EarleyItem item, uint32_t pos)
+    {
+        add_derivation(symbol_node(rule_set.dotted_rule(item).symbol, pos, pos), pos, item.rule_idx, no_forest_node,
+                       no_forest_node);
+    }
+private:
+    static constexpr uint32_t no_derivation = UINT32_MAX;
+
+    /* A derivation of a node, for finding out whether it was already added */
+    struct DerivationKey {
+        ForestNodeId node;
+        uint32_t rule_idx;
+        ForestNodeId left;
+        ForestNodeId right;
+    };
+
+    ForestNodeId get_node(const ForestNode& label)
+    {
+        auto id = node_ids.try_emplace(label, (ForestNodeId)m_nodes.size());
+        if(id == m_nodes.size()) {
+            m_nodes.emplace_back(label);
+            first_derivations.emplace_back(no_derivation);
+        }
+        return id;
+    }
+
+    /* Returns the node for the derivations of item in the state set at end_pos */
+    ForestNodeId item_node(const Grammar<Symbol> auto& rule_set, EarleyItem item, uint32_t end_pos)
+    {
+        if(item.progress == 0) {
+            return no_forest_node;
+        }
+        const auto& dotted = rule_set.dotted_rule(item);
+        if(dotted.is_completed) {
+            return symbol_node(dotted.symbol, item.start_pos, end_pos);
+        } else if(item.progress == 1) {
+            const auto& first = rule_set.dotted_rule(EarleyItem{item.rule_idx, item.start_pos, 0});
+            return first.next_is_terminal ? terminal_node(first.next_symbol, item.start_pos)
+                                          : symbol_node(first.next_symbol, item.start_pos, end_pos);
+        }
+        return get_node({item.rule_idx, item.progress, item.start_pos, end_pos});
+    }
+
+    /* Adds a derivation to node, which ends at end_pos, unless node already has it */
+    void add_derivation(ForestNodeId node, uint32_t end_pos, uint32_t rule_idx, ForestNodeId left, ForestNodeId right)
+    {
+        // Nodes of ambiguous grammars can have a derivation per split of their input, so duplicates are
+        //  found by hashing instead of walking the node's derivations. The recognizer adds the derivations
+        //  of the nodes ending at each position before those ending at the next one, so only the keys of
+        //  nodes ending at end_pos are kept, which keeps the set small.
+        if(end_pos != derivation_keys_end) {
+            derivation_keys.clear();
+            derivation_keys_end = end_pos;
+        }
+        if(!derivation_keys.insert({node, rule_idx, left, right})) {
+            return;
+        }
+        m_derivations.push_back(ForestDerivation{rule_idx, left, right, first_derivations[node]});
+        first_derivations[node] = (uint32_t)m_derivations.size() - 1;
+    }
+
+    BigArray<ForestNode> m_nodes;
+    BigArray<ForestDerivation> m_derivations;
+    BigArray<uint32_t> first_derivations; /* Index of the first derivation of each node */
+    ItemMap<ForestNode, ForestNodeId> node_ids;
+    ItemSet<DerivationKey> derivation_keys; /* The derivations of the nodes ending at derivation_keys_end */
+    uint32_t derivation_keys_end = 0;
+};
+
+/* The Earley recognizer, also building a parse forest of every full parse of the input (and of every
+   parse of a prefix of it). forest must be empty. The parse forest can be traversed in time linear in its
+   size, instead of searching the state sets for the items of each node. */
+template<typename Token, GrammarSymbol<Token> Symbol, std::ranges::input_range InputRange>
+    requires std::convertible_to<std::ranges::range_value_t<InputRange>, Token>
+SpanList<EarleyItem> parse(const Grammar<Symbol> auto& rule_set, Symbol start_symbol, size_t item_capacity, InputRange&& input,
+                           ParseForest<Symbol>& forest)
+{
+    detail::ParseScratch<Symbol> scratch;
+    return detail::recognize<Token, false>(rule_set, start_symbol, std::forward<InputRange>(input),
+                                           SpanList<EarleyItem>{item_capacity}, scratch, nullptr, detail::NoLookahead{},
+                                           forest);
+}
+
+} // namespace earley
@@ -0,0 +1,318 @@
+/*
+Libearley parser library
+Copyright (C) 2024  Cole Blakley
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <span>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <optional>
+#include <iterator>
+#include <stdexcept>
+#include "earley.hpp"
+
+namespace earley {
+
+enum class TreeEventKind : uint8_t {
+    Enter,   /* A rule is entered, before any of its children (pre-order) */
+    Exit,    /* A rule is left, after all of its children (post-order) */
+    Terminal /* A token is matched by a terminal */
+};
+
+/* A step of a walk over a parse tree. For Enter/Exit, symbol is the left-hand side of the rule at
+   rule_idx and [start_pos, end_pos) is the input it matched. For Terminal, symbol is the terminal (a
+   component of the rule at rule_idx) and [start_pos, end_pos) is its token. */
+template<typename Symbol>
+struct TreeEvent {
+    TreeEventKind kind;
+    Symbol symbol;
+    uint32_t rule_idx;
+    size_t start_pos;
+    size_t end_pos;
+};
+
+/* Walks one derivation of a parse result (e.g. from find_full_parse) left to right, yielding a
+   TreeEvent at a time from next(), or through begin()/end() as an input range. No tree is built: the
+   children of a node are found in the state sets when the node is entered, and pending nodes are kept
+   on an explicit stack, so the walk can be as deep as the input is long and can be stopped at any
+   point. Each component of a rule is matched to a completed item only if the rest of the rule's
+   prefix is in the state set where that item starts, so (unlike find_completed_item) the children
+   found always fit together, and if a choice of child leads to a dead end, the next one is tried. A
+   child spanning the same input as its parent is only chosen if it can be derived without the parent
+   (see rank), so cyclic grammars have finite walks too, and every parse that is found can be walked.
+   The state sets must come from a recognizer that keeps every completed item (i.e. not the Leo-mode
+   recognizer). */
+template<typename Symbol, typename Item = EarleyItem>
+class ParseTreeWalker {
+public:
+    using event_type = TreeEvent<Symbol>;
+
+    ParseTreeWalker(std::span<const Rule<Symbol>> rules, const SpanList<Item>& state_sets,
+                    BasicParseResult<Item> root)
+        : m_rules(rules), m_state_sets(&state_sets), m_same_span_symbols(symbol_traits<Symbol>::symbol_count)
+    {
+        find_same_span_symbols();
+        if(root) {
+            m_stack.push_back({TreeEventKind::Enter, *root.item, (size_t)(root.state_set - state_sets.begin())});
+        }
+    }
+
+    /* Returns the next event of the walk, or std::nullopt once the walk is done. Throws
+       std::runtime_error if a node's children cannot be found (e.g. when given Leo-mode state sets). */
+    std::optional<event_type> next()
+    {
+        if(m_stack.empty()) {
+            return std::nullopt;
+        }
+        Frame frame = m_stack.back();
+        m_stack.pop_back();
+        const auto& rule = m_rules[frame.item.rule_idx];
+        switch(frame.kind) {
+            case TreeEventKind::Terminal:
+                return event_type{TreeEventKind::Terminal, rule.components[frame.item.progress], frame.item.rule_idx,
+                                  frame.end_pos - 1, frame.end_pos};
+            case TreeEventKind::Enter:
+                m_stack.push_back({TreeEventKind::Exit, frame.item, frame.end_pos});
+                push_children(frame.item, frame.end_pos);
+                ++m_depth;
+                break;
+            case TreeEventKind::Exit:
+                --m_depth;
+                break;
+        }
+        return event_type{frame.kind, rule.symbol, frame.item.rule_idx, frame.item.start_pos, frame.end_pos};
+    }
+
+    /* Number of nodes entered but not yet exited */
+    size_t depth() const noexcept { return m_depth; }
+
+    class iterator {
+    public:
+        using value_type = event_type;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit
+        iterator(ParseTreeWalker& walker) : m_walker(&walker), m_event(walker.next()) {}
+
+        const value_type& operator*() const noexcept { return *m_event; }
+        const value_type* operator->() const noexcept { return &*m_event; }
+        iterator& operator++()
+        {
+            m_event = m_walker->next();
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+        bool operator==(std::default_sentinel_t) const noexcept { return !m_event; }
+    private:
+        ParseTreeWalker* m_walker = nullptr;
+        std::optional<value_type> m_event;
+    };
+
+    /* Starts yielding the remaining events. Like any input range, it can only be walked once. */
+    iterator begin() { return iterator{*this}; }
+    std::default_sentinel_t end() const noexcept { return {}; }
+private:
+    struct Frame {
+        TreeEventKind kind;
+        /* The completed item of an Enter/Exit node, or for a Terminal, the item whose next
+           component is the terminal */
+        Item item;
+        size_t end_pos;
+    };
+
+    static constexpr uint32_t unranked = UINT32_MAX;
+    static constexpr uint32_t unknown_rank = UINT32_MAX - 1;
+
+    /* A search for the children of the completed item ending at end_pos */
+    struct ChildSearch {
+        Item item;
+        size_t end_pos;
+        /* Children spanning the same input as item must have a lower rank than this (see rank), which
+           is looked up the first time such a child is found if it is unknown_rank */
+        uint32_t max_rank;
+        /* The children found so far, rightmost first */
+        std::vector<Frame>& children;
+        /* The (progress, pos) pairs from which no children can be found for the prefix before progress */
+        std::vector<std::pair<size_t, size_t>>& dead_ends;
+    };
+
+    /* Pushes the children of the completed item ending at end_pos, rightmost first so that they are
+       popped left to right */
+    void push_children(Item item, size_t end_pos)
+    {
+        m_children.clear();
+        m_dead_ends.clear();
+        ChildSearch search{item, end_pos, unknown_rank, m_children, m_dead_ends};
+        if(!find_children(search, m_rules[item.rule_idx].components.size(), end_pos)) {
+            throw std::runtime_error("ParseTreeWalker: no derivation found for a node's children");
+        }
+        m_stack.insert(m_stack.end(), m_children.begin(), m_children.end());
+    }
+
+    /* Finds children for the components before progress of the searched item, which must cover the input
+       from the item's start to pos, appending them to search.children. Any completed item for a component
+       that starts where the prefix before it ends will do, except that a child spanning the same input as
+       the searched item (and able to derive its symbol) must have a lower rank, so other children are tried
+       when one leads to a dead end. */
+    bool find_children(ChildSearch& search, size_t progress, size_t pos)
+    {
+        using progress_type = decltype(search.item.progress);
+        if(progress == 0) {
+            assert(pos == search.item.start_pos);
+            return true;
+        }
+        const auto& rule = m_rules[search.item.rule_idx];
+        const auto& state_sets = *m_state_sets;
+        Item prefix(search.item.rule_idx, search.item.start_pos, (progress_type)(progress - 1));
+        auto component = rule.components[progress - 1];
+        if(is_terminal(component)) {
+            // The prefix before a terminal was scanned from the previous state set, so it always fits
+            search.children.push_back({TreeEventKind::Terminal, prefix, pos});
+            if(find_children(search, progress - 1, pos - 1)) {
+                return true;
+            }
+            search.children.pop_back();
+            return false;
+        }
+        const auto& state_set = state_sets[pos];
+        for(auto child = find_completed_item(m_rules, state_set.begin(), state_set.end(), component);
+            child != state_set.end(); child = find_completed_item(m_rules, child + 1, state_set.end(), component)) {
+            size_t child_start = child->start_pos;
+            if(progress == 1 ? child_start != search.item.start_pos : !item_exists(state_sets[child_start], prefix)) {
+                continue;
+            }
+            if(child_start == search.item.start_pos && pos == search.end_pos
+               && m_same_span_symbols[symbol_traits<Symbol>::to_index(component)].test(rule.symbol)) {
+                if(search.max_rank == unknown_rank) {
+                    search.max_rank = rank(search.item, search.end_pos);
+                }
+                if(rank(*child, pos) >= search.max_rank) {
+                    continue;
+                }
+            }
+            if(std::ranges::find(search.dead_ends, std::pair{progress - 1, child_start}) != search.dead_ends.end()) {
+                continue;
+            }
+            search.children.push_back({TreeEventKind::Enter, *child, pos});
+            if(find_children(search, progress - 1, child_start)) {
+                return true;
+            }
+            search.children.pop_back();
+            search.dead_ends.emplace_back(progress - 1, child_start);
+        }
+        return false;
+    }
+
+    /* Finds the symbols that each symbol can derive over the same input (through rules whose other
+       components can all be empty), since only children of those symbols can be part of a cycle */
+    void find_same_span_symbols()
+    {
+        SymbolSet<Symbol> nullable;
+        bool is_changed = true;
+        while(is_changed) {
+            is_changed = false;
+            for(const auto& rule : m_rules) {
+                if(!nullable.test(rule.symbol) && std::ranges::all_of(rule.components, [&](Symbol component) {
+                       return !is_terminal(component) && nullable.test(component);
+                   })) {
+                    nullable.set(rule.symbol);
+                    is_changed = true;
+                }
+            }
+        }
+        is_changed = true;
+        while(is_changed) {
+            is_changed = false;
+            for(const auto& rule : m_rules) {
+                auto& derived = m_same_span_symbols[symbol_traits<Symbol>::to_index(rule.symbol)];
+                for(size_t i = 0; i < rule.components.size(); ++i) {
+                    auto component = rule.components[i];
+                    bool others_nullable = true;
+                    for(size_t j = 0; j < rule.components.size() && others_nullable; ++j) {
+                        others_nullable = j == i || (!is_terminal(rule.components[j]) && nullable.test(rule.components[j]));
+                    }
+                    if(is_terminal(component) || !others_nullable) {
+                        continue;
+                    }
+                    auto old_derived = derived;
+                    derived.set(component);
+                    derived |= m_same_span_symbols[symbol_traits<Symbol>::to_index(component)];
+                    is_changed |= derived != old_derived;
+                }
+            }
+        }
+    }
+
+    /* Returns the rank of the completed item ending at end_pos among the completed items spanning the same
+       input: items with rank 0 have children that all span less input, and items with rank r have children
+       that span less input or have a lower rank. Every item in the state sets has a finite derivation, so
+       has a rank, and choosing only lower-ranked children of the same span keeps walks finite even when the
+       grammar is cyclic. The ranks of a span are computed the first time one of them is needed. */
+    uint32_t rank(Item item, size_t end_pos)
+    {
+        auto [entry, is_new] = m_ranks.try_emplace({(size_t)item.start_pos, end_pos});
+        auto& ranks = entry->second;
+        if(is_new) {
+            for(auto candidate : (*m_state_sets)[end_pos]) {
+                if(candidate.start_pos == item.start_pos
+                   && candidate.progress == m_rules[candidate.rule_idx].components.size()) {
+                    ranks.emplace_back(candidate, unranked);
+                }
+            }
+            std::vector<Frame> children;
+            std::vector<std::pair<size_t, size_t>> dead_ends;
+            bool is_changed = true;
+            for(uint32_t pass = 0; is_changed; ++pass) {
+                is_changed = false;
+                for(auto& [candidate, candidate_rank] : ranks) {
+                    if(candidate_rank != unranked) {
+                        continue;
+                    }
+                    children.clear();
+                    dead_ends.clear();
+                    ChildSearch search{candidate, end_pos, pass, children, dead_ends};
+                    if(find_children(search, m_rules[candidate.rule_idx].components.size(), end_pos)) {
+                        candidate_rank = pass;
+                        is_changed = true;
+                    }
+                }
+            }
+        }
+        auto ranked = std::ranges::find(ranks, item, &std::pair<Item, uint32_t>::first);
+        return ranked != ranks.end() ? ranked->second : unranked;
+    }
+
+    std::span<const Rule<Symbol>> m_rules;
+    const SpanList<Item>* m_state_sets;
+    /* The symbols that each symbol (by index) can derive over the same input */
+    std::vector<SymbolSet<Symbol>> m_same_span_symbols;
+    std::vector<Frame> m_stack;
+    size_t m_depth = 0;
+    /* Scratch space for push_children */
+    std::vector<Frame> m_children;
+    std::vector<std::pair<size_t, size_t>> m_dead_ends;
+    /* The ranks of the completed items of each span (start_pos, end_pos) that has been ranked */
+    std::map<std::pair<size_t, size_t>, std::vector<std::pair<Item, uint32_t>>> m_ranks;
+};
+
+} // namespace earley
@@ -0,0 +1,356 @@
+/*
+Libearley parser library
+Copyright (C) 2024  Cole Blakley
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <span>
+#include <vector>
+#include <ranges>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include "earley.hpp"
+
+/* A binary format for the tables of a compiled RuleSet, so that a grammar can be compiled once (e.g. when it
+   is generated from a configuration) and then loaded by any number of processes without recomputing its
+   tables. The file is a RuleSetFileHeader followed by each table as a flat array, 8-byte aligned, in the
+   order given by detail::rule_set_file_layout. The tables are stored in the layout they have in memory, so
+   a LoadedRuleSet can use them in place (e.g. from a MappedFile) after checking that their indices are in
+   bounds. A file can only be loaded on a machine with the same byte order, for the same Symbol type. */
+
+namespace earley {
+
+struct RuleSetFileHeader {
+    static constexpr uint64_t file_magic = 0x5345'4c55'5259'4c45; /* "ELYRULES" in little-endian order */
+    static constexpr uint32_t file_version = 2;
+    static constexpr uint32_t file_byte_order = 0x0102'0304;
+
+    uint64_t magic = file_magic;
+    uint32_t version = file_version;
+    uint32_t byte_order = file_byte_order;
+    uint32_t symbol_count = 0;
+    uint32_t symbol_size = 0;      /* sizeof(Symbol) */
+    uint32_t symbol_set_size = 0;  /* sizeof(SymbolSet<Symbol>) */
+    uint32_t dotted_rule_size = 0; /* sizeof(DottedRule<Symbol>) */
+    uint32_t rule_count = 0;
+    uint32_t dotted_rule_count = 0;
+    uint32_t prediction_item_count = 0;
+    uint32_t terminal_count = 0;
+    uint32_t max_rule_size = 0;
+    uint32_t reserved = 0;
+    uint64_t file_size = 0;
+};
+
+namespace detail {
+
+/* Offsets (in bytes from the start of the file) of each table of a rule set file */
+struct RuleSetFileLayout {
+    size_t rule_spans = 0;            /* TableSpan[symbol_count] */
+    size_t nullable = 0;              /* bool[symbol_count] */
+    size_t rule_symbols = 0;          /* Symbol[rule_count] */
+    size_t rule_priorities = 0;       /* int32_t[rule_count] */
+    size_t rule_associativities = 0;  /* Associativity[rule_count] */
+    size_t components = 0;            /* Symbol[dotted_rule_count - rule_count], grouped by rule */
+    size_t dotted_rules = 0;          /* DottedRule<Symbol>[dotted_rule_count] */
+    size_t rule_offsets = 0;          /* uint32_t[rule_count + 1] */
+    size_t prediction_items = 0;      /* PredictedItem[prediction_item_count] */
+    size_t prediction_spans = 0;      /* TableSpan[symbol_count] */
+    size_t predicted_symbol_sets = 0; /* SymbolSet<Symbol>[symbol_count] */
+    size_t terminals = 0;             /* Symbol[terminal_count] */
+    size_t first_sets = 0;            /* SymbolSet<Symbol>[symbol_count] */
+    size_t follow_sets = 0;           /* SymbolSet<Symbol>[symbol_count] */
+    size_t lookahead_sets = 0;        /* SymbolSet<Symbol>[dotted_rule_count] */
+    size_t file_size = 0;
+};
+
+constexpr
+RuleSetFileLayout rule_set_file_layout(const RuleSetFileHeader& header) noexcept
+{
+    RuleSetFileLayout layout;
+    size_t offset = sizeof(RuleSetFileHeader);
+    auto add_table = [&](size_t& table_offset, size_t entry_size, size_t entry_count) {
+        table_offset = offset;
+        offset = (offset + entry_size * entry_count + 7) / 8 * 8;
+    };
+    add_table(layout.rule_spans, sizeof(TableSpan), header.symbol_count);
+    add_table(layout.nullable, sizeof(bool), header.symbol_count);
+    add_table(layout.rule_symbols, header.symbol_size, header.rule_count);
+    add_table(layout.rule_priorities, sizeof(int32_t), header.rule_count);
+    add_table(layout.rule_associativities, sizeof(Associativity), header.rule_count);
+    add_table(layout.components, header.symbol_size, header.dotted_rule_count - header.rule_count);
+    add_table(layout.dotted_rules, header.dotted_rule_size, header.dotted_rule_count);
+    add_table(layout.rule_offsets, sizeof(uint32_t), header.rule_count + 1);
+    add_table(layout.prediction_items, sizeof(PredictedItem), header.prediction_item_count);
+    add_table(layout.prediction_spans, sizeof(TableSpan), header.symbol_count);
+    add_table(layout.predicted_symbol_sets, header.symbol_set_size, header.symbol_count);
+    add_table(layout.terminals, header.symbol_size, header.terminal_count);
+    add_table(layout.first_sets, header.symbol_set_size, header.symbol_count);
+    add_table(layout.follow_sets, header.symbol_set_size, header.symbol_count);
+    add_table(layout.lookahead_sets, header.symbol_set_size, header.dotted_rule_count);
+    layout.file_size = offset;
+    return layout;
+}
+
+template<typename Symbol>
+RuleSetFileHeader rule_set_file_header(uint32_t rule_count, uint32_t dotted_rule_count, uint32_t prediction_item_count,
+                                       uint32_t terminal_count, uint32_t max_rule_size)
+{
+    RuleSetFileHeader header;
+    header.symbol_count = symbol_traits<Symbol>::symbol_count;
+    header.symbol_size = sizeof(Symbol);
+    header.symbol_set_size = sizeof(SymbolSet<Symbol>);
+    header.dotted_rule_size = sizeof(DottedRule<Symbol>);
+    header.rule_count = rule_count;
+    header.dotted_rule_count = dotted_rule_count;
+    header.prediction_item_count = prediction_item_count;
+    header.terminal_count = terminal_count;
+    header.max_rule_size = max_rule_size;
+    header.file_size = rule_set_file_layout(header).file_size;
+    return header;
+}
+
+} // namespace detail
+
+/* Writes the tables of rule_set to out in the rule set file format (see RuleSetFileHeader), so that they can
+   be used later by a LoadedRuleSet. Throws std::runtime_error if out fails. */
+template<typename Symbol>
+void write_rule_set(std::ostream& out, const RuleSet<Symbol>& rule_set)
+{
+    static_assert(std::is_trivially_copyable_v<Symbol>, "Symbols are stored as they are in memory");
+    auto header = detail::rule_set_file_header<Symbol>((uint32_t)rule_set.rules.size(), (uint32_t)rule_set.dotted_rules.size(),
+                                                       (uint32_t)rule_set.prediction_items.size(),
+                                                       (uint32_t)rule_set.terminals.size(), rule_set.max_rule_size);
+    auto layout = detail::rule_set_file_layout(header);
+    std::vector<char> file_data(layout.file_size);
+    auto write_table = [&](size_t offset, const auto& table) {
+        auto bytes = std::as_bytes(std::span{table});
+        std::memcpy(file_data.data() + offset, bytes.data(), bytes.size());
+    };
+    std::memcpy(file_data.data(), &header, sizeof(header));
+    std::vector<TableSpan> rule_spans;
+    std::vector<Symbol> rule_symbols;
+    std::vector<int32_t> rule_priorities;
+    std::vector<Associativity> rule_associativities;
+    std::vector<Symbol> components;
+    for(auto span : rule_set.rule_spans) {
+        rule_spans.push_back({*span.begin(), *span.end()});
+    }
+    for(const auto& rule : rule_set.rules) {
+        rule_symbols.push_back(rule.symbol);
+        rule_priorities.push_back((int32_t)rule.priority);
+        rule_associativities.push_back(rule.associativity);
+        components.insert(components.end(), rule.components.begin(), rule.components.end());
+    }
+    write_table(layout.rule_spans, rule_spans);
+    write_table(layout.nullable, rule_set.nullable);
+    write_table(layout.rule_symbols, rule_symbols);
+    write_table(layout.rule_priorities, rule_priorities);
+    write_table(layout.rule_associativities, rule_associativities);
+    write_table(layout.components, components);
+    write_table(layout.dotted_rules, rule_set.dotted_rules);
+    write_table(layout.rule_offsets, rule_set.rule_offsets);
+    write_table(layout.prediction_items, rule_set.prediction_items);
+    write_table(layout.prediction_spans, rule_set.prediction_spans);
+    write_table(layout.predicted_symbol_sets, rule_set.predicted_symbol_sets);
+    write_table(layout.terminals, rule_set.terminals);
+    write_table(layout.first_sets, rule_set.first_sets);
+    write_table(layout.follow_sets, rule_set.follow_sets);
+    write_table(layout.lookahead_sets, rule_set.lookahead_sets);
+    if(!out.write(file_data.data(), (std::streamsize)file_data.size())) {
+        throw std::runtime_error("Failed to write rule set");
+    }
+}
+
+/* A rule set whose tables are read in place from the contents of a rule set file written by write_rule_set
+   (e.g. the contents() of a MappedFile), without copying or recomputing them. It can be passed to parse in
+   place of the RuleSet it was written from, with the same results. The contents must stay alive and
+   unchanged while it is used, and must be 8-byte aligned. Throws std::runtime_error if the contents are not
+   a valid rule set file for Symbol. */
+template<typename Symbol>
+class LoadedRuleSet {
+public:
+    using index_range = std::ranges::iota_view<uint32_t, uint32_t>;
+    using SymbolTraits = symbol_traits<Symbol>;
+    static constexpr auto symbol_count = SymbolTraits::symbol_count;
+
+    explicit
+    LoadedRuleSet(std::span<const char> file_data)
+    {
+        if(file_data.size() < sizeof(RuleSetFileHeader)) {
+            throw std::runtime_error("Rule set file is too small");
+        }
+        if((uintptr_t)file_data.data() % alignof(uint64_t) != 0) {
+            throw std::runtime_error("Rule set file contents are not 8-byte aligned");
+        }
+        RuleSetFileHeader header;
+        std::memcpy(&header, file_data.data(), sizeof(header));
+        if(header.magic != RuleSetFileHeader::file_magic) {
+            throw std::runtime_error("Not a rule set file");
+        }
+        if(header.version != RuleSetFileHeader::file_version || header.byte_order != RuleSetFileHeader::file_byte_order) {
+            throw std::runtime_error("Rule set file has an unsupported version or byte order");
+        }
+        if(header.rule_count > header.dotted_rule_count) {
+            throw std::runtime_error("Rule set file is corrupt");
+        }
+        auto expected = detail::rule_set_file_header<Symbol>(header.rule_count, header.dotted_rule_count,
+                                                             header.prediction_item_count, header.terminal_count,
+                                                             header.max_rule_size);
+        if(header.symbol_count != expected.symbol_count || header.symbol_size != expected.symbol_size
+           || header.symbol_set_size != expected.symbol_set_size || header.dotted_rule_size != expected.dotted_rule_size) {
+            throw std::runtime_error("Rule set file was written for a different symbol type");
+        }
+        if(header.file_size != expected.file_size || header.file_size != file_data.size()) {
+            throw std::runtime_error("Rule set file is truncated or corrupt");
+        }
+
+        auto layout = detail::rule_set_file_layout(header);
+        auto base = file_data.data();
+        rule_count = header.rule_count;
+        max_rule_size = header.max_rule_size;
+        rule_spans = (const TableSpan*)(base + layout.rule_spans);
+        nullable = (const bool*)(base + layout.nullable);
+        rule_symbols = {(const Symbol*)(base + layout.rule_symbols), header.rule_count};
+        rule_priorities = {(const int32_t*)(base + layout.rule_priorities), header.rule_count};
+        rule_associativities = {(const Associativity*)(base + layout.rule_associativities), header.rule_count};
+        components = {(const Symbol*)(base + layout.components), header.dotted_rule_count - header.rule_count};
+        dotted_rules = {(const DottedRule<Symbol>*)(base + layout.dotted_rules), header.dotted_rule_count};
+        rule_offsets = {(const uint32_t*)(base + layout.rule_offsets), header.rule_count + 1};
+        prediction_items = {(const PredictedItem*)(base + layout.prediction_items), header.prediction_item_count};
+        prediction_spans = (const TableSpan*)(base + layout.prediction_spans);
+        predicted_symbol_sets = (const SymbolSet<Symbol>*)(base + layout.predicted_symbol_sets);
+        terminals = {(const Symbol*)(base + layout.terminals), header.terminal_count};
+        first_sets = (const SymbolSet<Symbol>*)(base + layout.first_sets);
+        follow_sets = (const SymbolSet<Symbol>*)(base + layout.follow_sets);
+        lookahead_sets = (const SymbolSet<Symbol>*)(base + layout.lookahead_sets);
+        check_indices();
+    }
+
+    /* Same as RuleSet::operator[] */
+    index_range operator[](Symbol rule_sym) const noexcept
+    {
+        auto span = rule_spans[SymbolTraits::to_index(rule_sym)];
+        return {span.first, span.limit};
+    }
+
+    bool is_nullable(Symbol rule_sym) const noexcept { return nullable[SymbolTraits::to_index(rule_sym)]; }
+
+    template<typename Layout>
+    uint32_t dotted_rule_index(BasicEarleyItem<Layout> item) const noexcept { return rule_offsets[item.rule_idx] + item.progress; }
+
+    template<typename Layout>
+    const DottedRule<Symbol>& dotted_rule(BasicEarleyItem<Layout> item) const noexcept { return dotted_rules[dotted_rule_index(item)]; }
+
+    /* Same as RuleSet::prediction */
+    std::span<const PredictedItem> prediction(Symbol rule_sym) const noexcept
+    {
+        auto span = prediction_spans[SymbolTraits::to_index(rule_sym)];
+        return prediction_items.subspan(span.first, span.limit - span.first);
+    }
+
+    /* Same as RuleSet::predicted_symbols */
+    const SymbolSet<Symbol>& predicted_symbols(Symbol rule_sym) const noexcept
+    {
+        return predicted_symbol_sets[SymbolTraits::to_index(rule_sym)];
+    }
+
+    /* Same as RuleSet::lookahead_set */
+    template<typename Layout>
+    const SymbolSet<Symbol>& lookahead_set(BasicEarleyItem<Layout> item) const noexcept { return lookahead_sets[dotted_rule_index(item)]; }
+
+    const SymbolSet<Symbol>& first_set(Symbol symbol) const noexcept { return first_sets[SymbolTraits::to_index(symbol)]; }
+
+    const SymbolSet<Symbol>& follow_set(Symbol symbol) const noexcept { return follow_sets[SymbolTraits::to_index(symbol)]; }
+
+    /* The left-hand side and components of the rule at rule_idx */
+    Symbol rule_symbol(uint32_t rule_idx) const noexcept { return rule_symbols[rule_idx]; }
+    std::span<const Symbol> rule_components(uint32_t rule_idx) const noexcept
+    {
+        // Each rule has one more dotted rule than it has components
+        return components.subspan(rule_offsets[rule_idx] - rule_idx, rule_offsets[rule_idx + 1] - rule_offsets[rule_idx] - 1);
+    }
+
+    /* Returns a copy of the rules of the grammar (with their priorities and associativities), e.g. for the
+       functions that traverse the state sets or for a ForestTree */
+    std::vector<Rule<Symbol>> copy_rules() const
+    {
+        std::vector<Rule<Symbol>> rules;
+        rules.reserve(rule_count);
+        for(uint32_t rule_idx = 0; rule_idx < rule_count; ++rule_idx) {
+            auto rule_comps = rule_components(rule_idx);
+            rules.push_back({rule_symbol(rule_idx), {rule_comps.begin(), rule_comps.end()}, rule_priorities[rule_idx],
+                             rule_associativities[rule_idx]});
+        }
+        return rules;
+    }
+
+    uint32_t rule_count = 0;
+    uint32_t max_rule_size = 0;
+    const TableSpan* rule_spans = nullptr;
+    const bool* nullable = nullptr;
+    std::span<const Symbol> rule_symbols;
+    std::span<const int32_t> rule_priorities;
+    std::span<const Associativity> rule_associativities;
+    std::span<const Symbol> components;
+    std::span<const DottedRule<Symbol>> dotted_rules;
+    std::span<const uint32_t> rule_offsets;
+    std::span<const PredictedItem> prediction_items;
+    const TableSpan* prediction_spans = nullptr;
+    const SymbolSet<Symbol>* predicted_symbol_sets = nullptr;
+    std::span<const Symbol> terminals;
+    const SymbolSet<Symbol>* first_sets = nullptr;
+    const SymbolSet<Symbol>* follow_sets = nullptr;
+    const SymbolSet<Symbol>* lookahead_sets = nullptr;
+private:
+    /* Checks every index that the recognizer follows without bounds checks, so that a corrupt file is rejected
+       here instead of making a parse read out of bounds */
+    void check_indices() const
+    {
+        auto check = [](bool is_valid) {
+            if(!is_valid) {
+                throw std::runtime_error("Rule set file is corrupt");
+            }
+        };
+        check(rule_offsets[0] == 0 && rule_offsets[rule_count] == dotted_rules.size());
+        for(uint32_t rule_idx = 0; rule_idx < rule_count; ++rule_idx) {
+            auto rule_size = rule_offsets[rule_idx + 1] - rule_offsets[rule_idx];
+            check(rule_offsets[rule_idx] < rule_offsets[rule_idx + 1] && rule_size <= max_rule_size + 1);
+            check(dotted_rules[rule_offsets[rule_idx + 1] - 1].is_completed);
+            check(rule_associativities[rule_idx] <= Associativity::Right);
+        }
+        for(size_t sym_index = 0; sym_index < symbol_count; ++sym_index) {
+            check(rule_spans[sym_index].first <= rule_spans[sym_index].limit && rule_spans[sym_index].limit <= rule_count);
+            check(prediction_spans[sym_index].first <= prediction_spans[sym_index].limit
+                  && prediction_spans[sym_index].limit <= prediction_items.size());
+        }
+        for(auto predicted_item : prediction_items) {
+            check(predicted_item.rule_idx < rule_count
+                  && predicted_item.progress < rule_offsets[predicted_item.rule_idx + 1] - rule_offsets[predicted_item.rule_idx]);
+        }
+        for(const auto& dotted : dotted_rules) {
+            check(SymbolTraits::to_index(dotted.symbol) < symbol_count && SymbolTraits::to_index(dotted.next_symbol) < symbol_count);
+        }
+    }
+};
+
+template<typename Symbol>
+TerminalTable(const LoadedRuleSet<Symbol>&) -> TerminalTable<Symbol>;
+
+} // namespace earley
@@ -22,18 +22,38 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <cassert>
 #include <cstdint>
 #include <ranges>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
 #include <boost/stl_interfaces/iterator_interface.hpp>
 #include "big_array.hpp"
 
-/* Iterator for moving between spans within a SpanList<T> structure */
+namespace detail {
+
+/* Integer type of the item offsets that a SpanList<T> stores for each span: T::span_offset_type if
+   T defines it, otherwise uint32_t (so a SpanList holds at most 2^32 - 1 items by default) */
+template<typename T>
+struct span_offset {
+    using type = uint32_t;
+};
+
 template<typename T>
-struct SpanListIterator : public boost::stl_interfaces::proxy_iterator_interface<SpanListIterator<T>,
+    requires requires { typename T::span_offset_type; }
+struct span_offset<T> {
+    using type = typename T::span_offset_type;
+};
+
+} // namespace detail
+
+/* Iterator for moving between spans within a SpanList<T> structure */
+template<typename T, typename Offset = typename detail::span_offset<T>::type>
+struct SpanListIterator : public boost::stl_interfaces::proxy_iterator_interface<SpanListIterator<T, Offset>,
                                     std::random_access_iterator_tag,
                                     std::span<const T>> {
     constexpr
     SpanListIterator() = default;
     constexpr
-    SpanListIterator(std::span<const T> items, std::vector<uint32_t>::const_iterator start_point)
+    SpanListIterator(std::span<const T> items, typename std::vector<Offset>::const_iterator start_point)
         : items(items), start_point(start_point) {}
 
     constexpr
@@ -53,36 +73,59 @@ struct SpanListIterator : public boost::stl_interfaces::proxy_iterator_interface
     }
 private:
     std::span<const T> items;
-    std::vector<uint32_t>::const_iterator start_point;
+    typename std::vector<Offset>::const_iterator start_point;
 };
 
-/* Sentinel representing end of a span of items */
+/* Iterator over the items of the last span of a SpanList<T>. It refers to items by index, so
+   it remains valid when items are added (even if that moves them to a new address). */
 template<typename T>
-struct SpanEnd {
+struct SpanTailIterator : public boost::stl_interfaces::iterator_interface<SpanTailIterator<T>,
+                                 std::random_access_iterator_tag, T, T> {
     constexpr
-    SpanEnd() = default;
+    SpanTailIterator() = default;
     constexpr
-    SpanEnd(const BigArray<T>* end)
-        : end(end) {}
+    SpanTailIterator(const BigArray<T>* items, size_t index)
+        : items(items), index(index) {}
 
-    bool operator==(const T* pos) const noexcept
+    constexpr
+    T operator*() const noexcept { return (*items)[index]; }
+    constexpr
+    std::ptrdiff_t operator-(const SpanTailIterator& other) const noexcept { return index - other.index; }
+    constexpr
+    SpanTailIterator& operator+=(std::ptrdiff_t n) noexcept
     {
-        return pos >= end->end();
+        index += n;
+        return *this;
     }
+    /* Returns true if this is past the last item of the last span */
+    constexpr
+    bool at_end() const noexcept { return index >= items->size(); }
 private:
-    const BigArray<T>* end = nullptr;
+    const BigArray<T>* items = nullptr;
+    size_t index = 0;
+};
+
+/* Sentinel representing end of the last span of items (which moves as items are added) */
+template<typename T>
+struct SpanEnd {
+    constexpr
+    bool operator==(const SpanTailIterator<T>& pos) const noexcept
+    {
+        return pos.at_end();
+    }
 };
 
 /* Represents a growable array (divided into subspans) of items of type T. Items can only be added to
    the last subspan, but all subspans can be read from. All items belong to exactly one subspan. */
-template<typename T>
+template<typename T, typename Offset = typename detail::span_offset<T>::type>
 class SpanList {
 public:
-    using const_iterator = SpanListIterator<T>;
+    using const_iterator = SpanListIterator<T, Offset>;
 
+    /* options is how the memory of the items is allocated (see BigArrayOptions) */
     explicit
-    SpanList(size_t item_capacity)
-        : items(item_capacity) {}
+    SpanList(size_t item_capacity, const BigArrayOptions& options = {})
+        : items(item_capacity, options) {}
 
     constexpr
     void add_span()
@@ -92,6 +135,9 @@ public:
             start_points.push_back(0);
             start_points.push_back(0);
         } else {
+            if(items.size() > std::numeric_limits<Offset>::max()) {
+                throw std::runtime_error("SpanList has too many items for its offset type");
+            }
             start_points.push_back(start_points.back());
         }
     }
@@ -104,6 +150,10 @@ public:
         items.append(begin, end);
     }
 
+    /* Makes room for count more items, so that adding up to that many items does not move the items
+       (or invalidate the spans returned by operator[]) */
+    void reserve(size_t count) { items.reserve(items.size() + count); }
+
     template<typename ...Args>
     constexpr
     void emplace_back(Args&&... args)
@@ -113,27 +163,96 @@ public:
         ++start_points.back();
     }
 
+    /* Note: adding items invalidates the spans returned by this function */
     constexpr
-    std::span<const T> operator[](uint32_t index) const noexcept
+    std::span<const T> operator[](size_t index) const noexcept
     {
         return {items.begin() + start_points[index], items.begin() + start_points[index+1]};
     }
     /* Iterators remain valid when items are added to the SpanList
        Note: adding new spans invalidates the ranges returned by this function. */
-    std::ranges::subrange<T*, SpanEnd<T>> curr_span() noexcept
+    std::ranges::subrange<SpanTailIterator<T>, SpanEnd<T>> curr_span() const noexcept
+    {
+        return {SpanTailIterator<T>{&items, *(start_points.end() - 2)}, SpanEnd<T>{}};
+    }
+
+    /* Removes the items of each span (except the last one) whose index is_live returns false for, so that
+       the memory they used can be reused by new items. Those spans remain, but are empty. The items of
+       the other spans are moved, keeping their order. The spans before first_span are left as they are
+       (and is_live is not called for them). */
+    template<typename IsLive>
+    void remove_dead_spans(IsLive&& is_live, size_t first_span = 0)
+    {
+        if(start_points.size() <= first_span + 1) {
+            return;
+        }
+        Offset write_pos = start_points[first_span];
+        Offset read_pos = write_pos;
+        size_t last_span = start_points.size() - 2;
+        for(size_t i = first_span; i <= last_span; ++i) {
+            Offset read_end = start_points[i + 1];
+            start_points[i] = write_pos;
+            if(i == last_span || is_live(i)) {
+                if(write_pos != read_pos) {
+                    std::copy(items.begin() + read_pos, items.begin() + read_end, items.begin() + write_pos);
+                }
+                write_pos += read_end - read_pos;
+            }
+            read_pos = read_end;
+        }
+        start_points.back() = write_pos;
+        items.truncate(write_pos);
+    }
+
+    /* Removes the spans after the first span_count spans (and their items) without freeing any memory */
+    constexpr
+    void truncate(size_t span_count) noexcept
+    {
+        if(span_count == 0) {
+            clear();
+        } else if(span_count < size()) {
+            items.truncate(start_points[span_count]);
+            start_points.resize(span_count + 1);
+        }
+    }
+
+    /* Adds the count items right after the last item to the last span. They must be items removed by truncate
+       that have not been overwritten since (see data). */
+    void restore(size_t count) noexcept
     {
-        return {items.begin() + *(start_points.end() - 2), SpanEnd{&items}};
+        assert(!start_points.empty());
+        items.restore(items.size() + count);
+        start_points.back() += count;
+    }
+
+    /* The memory of the items. Past the last item, it holds the items removed by truncate until they are
+       overwritten by new items or the SpanList grows. */
+    constexpr
+    const T* data() const noexcept { return items.begin(); }
+
+    /* Removes all spans and items without freeing any memory */
+    constexpr
+    void clear() noexcept
+    {
+        items.clear();
+        start_points.clear();
     }
 
     constexpr
     size_t num_of_items() const noexcept { return items.size(); }
+    /* Number of items that fit before the SpanList has to grow */
+    constexpr
+    size_t capacity() const noexcept { return items.byte_capacity() / sizeof(T); }
+    /* Bytes of memory committed for the items (see BigArray::bytes_committed) */
+    size_t bytes_committed() const noexcept { return items.bytes_committed(); }
+    /* Number of spans */
     constexpr
-    size_t size() const noexcept { return start_points.size(); }
+    size_t size() const noexcept { return start_points.empty() ? 0 : start_points.size() - 1; }
     constexpr
     const_iterator begin() const noexcept { return {items, start_points.begin()}; }
     constexpr
     const_iterator end() const noexcept { return {items, start_points.end() - 1}; }
 private:
     BigArray<T> items;
-    std::vector<uint32_t> start_points;
+    std::vector<Offset> start_points;
 };
@@ -0,0 +1,159 @@
+/*
+Libearley parser library
+Copyright (C) 2024  Cole Blakley
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <array>
+#include <ranges>
+#include <concepts>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+#include "earley.hpp"
+
+namespace earley {
+
+/* A RuleSet whose tables have a fixed size, so that they can be computed at compile time
+   (see make_static_rule_set). It can be passed to parse in place of a RuleSet. */
+template<typename Symbol, size_t RuleCount, size_t DottedRuleCount, size_t PredictedItemCount, size_t TerminalCount>
+struct StaticRuleSet {
+    using index_range = std::ranges::iota_view<uint32_t, uint32_t>;
+    using SymbolTraits = symbol_traits<Symbol>;
+    static constexpr auto symbol_count = SymbolTraits::symbol_count;
+    static constexpr size_t rule_count = RuleCount;
+
+    struct RuleSpan {
+        uint32_t first = 0;
+        uint32_t limit = 0;
+    };
+
+    /* Same as RuleSet::operator[] */
+    constexpr
+    index_range operator[](Symbol rule_sym) const noexcept
+    {
+        auto span = rule_spans[SymbolTraits::to_index(rule_sym)];
+        return {span.first, span.limit};
+    }
+
+    constexpr
+    bool is_nullable(Symbol rule_sym) const noexcept { return nullable[SymbolTraits::to_index(rule_sym)]; }
+
+    template<typename Layout>
+    constexpr
+    uint32_t dotted_rule_index(BasicEarleyItem<Layout> item) const noexcept { return rule_offsets[item.rule_idx] + item.progress; }
+
+    template<typename Layout>
+    constexpr
+    const DottedRule<Symbol>& dotted_rule(BasicEarleyItem<Layout> item) const noexcept { return dotted_rules[dotted_rule_index(item)]; }
+
+    /* Same as RuleSet::prediction */
+    constexpr
+    std::span<const PredictedItem> prediction(Symbol rule_sym) const noexcept
+    {
+        auto span = prediction_spans[SymbolTraits::to_index(rule_sym)];
+        return {prediction_items.data() + span.first, prediction_items.data() + span.limit};
+    }
+
+    /* Same as RuleSet::predicted_symbols */
+    constexpr
+    const SymbolSet<Symbol>& predicted_symbols(Symbol rule_sym) const noexcept
+    {
+        return predicted_symbol_sets[SymbolTraits::to_index(rule_sym)];
+    }
+
+    /* Same as RuleSet::lookahead_set */
+    template<typename Layout>
+    constexpr
+    const SymbolSet<Symbol>& lookahead_set(BasicEarleyItem<Layout> item) const noexcept { return lookahead_sets[dotted_rule_index(item)]; }
+
+    constexpr
+    const SymbolSet<Symbol>& first_set(Symbol symbol) const noexcept { return first_sets[SymbolTraits::to_index(symbol)]; }
+
+    constexpr
+    const SymbolSet<Symbol>& follow_set(Symbol symbol) const noexcept { return follow_sets[SymbolTraits::to_index(symbol)]; }
+
+    uint32_t max_rule_size = 0;
+    std::array<RuleSpan, SymbolTraits::symbol_count> rule_spans{};
+    std::array<bool, SymbolTraits::symbol_count> nullable{};
+    std::array<DottedRule<Symbol>, DottedRuleCount> dotted_rules{};
+    std::array<uint32_t, RuleCount + 1> rule_offsets{};
+    std::array<PredictedItem, PredictedItemCount> prediction_items{};
+    std::array<TableSpan, SymbolTraits::symbol_count> prediction_spans{};
+    std::array<SymbolSet<Symbol>, SymbolTraits::symbol_count> predicted_symbol_sets{};
+    std::array<Symbol, TerminalCount> terminals{};
+    std::array<SymbolSet<Symbol>, SymbolTraits::symbol_count> first_sets{};
+    std::array<SymbolSet<Symbol>, SymbolTraits::symbol_count> follow_sets{};
+    std::array<SymbolSet<Symbol>, DottedRuleCount> lookahead_sets{};
+};
+
+template<typename Symbol, size_t RuleCount, size_t DottedRuleCount, size_t PredictedItemCount, size_t TerminalCount>
+TerminalTable(const StaticRuleSet<Symbol, RuleCount, DottedRuleCount, PredictedItemCount, TerminalCount>&) -> TerminalTable<Symbol>;
+
+namespace detail {
+
+template<typename MakeRules>
+using static_rule_symbol_t = decltype(std::ranges::range_value_t<std::invoke_result_t<MakeRules>>::symbol);
+
+} // namespace detail
+
+/* Builds a StaticRuleSet at compile time. make_rules must be a lambda with no captures that returns
+   the rules of the grammar (e.g. as a std::vector<Rule<Symbol>>), and is_terminal must be constexpr.
+   The tables are computed by a RuleSet during constant evaluation, so they are always the same as the
+   ones a RuleSet would compute at runtime. Example:
+
+   static constexpr auto rule_set = earley::make_static_rule_set([] {
+       using enum Symbol;
+       return std::vector<earley::Rule<Symbol>>{
+           { Sum, { Sum, Plus, Number } },
+           { Sum, { Number } },
+           ...
+       };
+   });
+*/
+template<typename MakeRules, typename Symbol = detail::static_rule_symbol_t<MakeRules>>
+    requires std::is_empty_v<MakeRules> && std::default_initializable<MakeRules>
+consteval
+auto make_static_rule_set(MakeRules)
+{
+    constexpr auto sizes = [] {
+        auto rules = MakeRules{}();
+        RuleSet<Symbol> rule_set{std::span<const Rule<Symbol>>{rules}};
+        return std::array{std::ranges::size(rules), rule_set.dotted_rules.size(), rule_set.prediction_items.size(),
+                          rule_set.terminals.size()};
+    }();
+
+    auto rules = MakeRules{}();
+    RuleSet<Symbol> rule_set{std::span<const Rule<Symbol>>{rules}};
+    StaticRuleSet<Symbol, sizes[0], sizes[1], sizes[2], sizes[3]> static_rule_set;
+    static_rule_set.max_rule_size = rule_set.max_rule_size;
+    for(size_t sym_index = 0; sym_index < rule_set.symbol_count; ++sym_index) {
+        static_rule_set.rule_spans[sym_index] = {*rule_set.rule_spans[sym_index].begin(), *rule_set.rule_spans[sym_index].end()};
+        static_rule_set.nullable[sym_index] = rule_set.nullable[sym_index];
+        static_rule_set.prediction_spans[sym_index] = rule_set.prediction_spans[sym_index];
+        static_rule_set.predicted_symbol_sets[sym_index] = rule_set.predicted_symbol_sets[sym_index];
+        static_rule_set.first_sets[sym_index] = rule_set.first_sets[sym_index];
+        static_rule_set.follow_sets[sym_index] = rule_set.follow_sets[sym_index];
+    }
+    std::ranges::copy(rule_set.dotted_rules, static_rule_set.dotted_rules.begin());
+    std::ranges::copy(rule_set.rule_offsets, static_rule_set.rule_offsets.begin());
+    std::ranges::copy(rule_set.prediction_items, static_rule_set.prediction_items.begin());
+    std::ranges::copy(rule_set.terminals, static_rule_set.terminals.begin());
+    std::ranges::copy(rule_set.lookahead_sets, static_rule_set.lookahead_sets.begin());
+    return static_rule_set;
+}
+
+} // namespace earley
\ No newline at end of file
@@ -0,0 +1,135 @@
+/*
+Libearley parser library
+Copyright (C) 2024  Cole Blakley
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <exception>
+
+/* A fixed set of threads that run batches of tasks. The threads wait between batches instead of being
+   created for each one, so batches can be small (e.g. the completions of one state set). */
+class WorkerPool {
+public:
+    /* thread_count is the number of threads running each batch, including the thread calling run */
+    explicit
+    WorkerPool(size_t thread_count)
+    {
+        for(size_t worker = 1; worker < thread_count; ++worker) {
+            threads.emplace_back([this, worker] { wait_for_batches(worker); });
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    ~WorkerPool() noexcept
+    {
+        {
+            std::scoped_lock lock{mutex};
+            is_stopping = true;
+        }
+        batch_started.notify_all();
+        for(auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    size_t thread_count() const noexcept { return threads.size() + 1; }
+
+    /* Calls task(worker, index) for each index in [0, task_count), where worker (less than thread_count)
+       identifies the thread making the call. The calling thread is worker 0. Returns once every call has
+       returned; if any call throws, the first exception is rethrown. */
+    template<typename Task>
+    void run(size_t task_count, Task& task)
+    {
+        {
+            std::scoped_lock lock{mutex};
+            batch = {&task, [](void* task, size_t worker, size_t index) { (*(Task*)task)(worker, index); }, task_count};
+            next_index.store(0, std::memory_order_relaxed);
+            running_workers = threads.size();
+            error = nullptr;
+            ++batch_number;
+        }
+        batch_started.notify_all();
+        run_tasks(batch, 0);
+        std::unique_lock lock{mutex};
+        batch_finished.wait(lock, [this] { return running_workers == 0; });
+        if(error) {
+            std::rethrow_exception(error);
+        }
+    }
+private:
+    struct Batch {
+        void* task = nullptr;
+        void (*call)(void* task, size_t worker, size_t index) = nullptr;
+        size_t task_count = 0;
+    };
+
+    void wait_for_batches(size_t worker)
+    {
+        uint64_t last_batch = 0;
+        while(true) {
+            Batch curr_batch;
+            {
+                std::unique_lock lock{mutex};
+                batch_started.wait(lock, [&] { return is_stopping || batch_number != last_batch; });
+                if(is_stopping) {
+                    return;
+                }
+                last_batch = batch_number;
+                curr_batch = batch;
+            }
+            run_tasks(curr_batch, worker);
+            std::scoped_lock lock{mutex};
+            if(--running_workers == 0) {
+                batch_finished.notify_one();
+            }
+        }
+    }
+
+    void run_tasks(const Batch& curr_batch, size_t worker) noexcept
+    {
+        size_t index;
+        while((index = next_index.fetch_add(1, std::memory_order_relaxed)) < curr_batch.task_count) {
+            try {
+                curr_batch.call(curr_batch.task, worker, index);
+            } catch(...) {
+                std::scoped_lock lock{mutex};
+                if(!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable batch_started;
+    std::condition_variable batch_finished;
+    Batch batch;
+    uint64_t batch_number = 0;
+    size_t running_workers = 0; /* Threads (other than the caller of run) still running the current batch */
+    std::atomic<size_t> next_index = 0;
+    std::exception_ptr error;
+    bool is_stopping = false;
+};
@@ -1,5 +1,8 @@
 #include "big_array.hpp"
 #include <iostream>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
 #include <cassert>
 #include <unistd.h>
 
@@ -25,5 +28,75 @@ int main()
     std::cout << "Bytes reserved: " << array.byte_capacity() << "\n";
     std::cout << "Pages reserved: " << array.byte_capacity() / (size_t)getpagesize() << "\n";
 
+    // Arrays grow past their initial capacity, keeping their elements
+    BigArray<int> small_array{1};
+    auto initial_capacity = small_array.byte_capacity();
+    assert(initial_capacity == (size_t)getpagesize());
+    for(int i = 0; i < 1'000'000; ++i) {
+        small_array.push_back(i * 3);
+    }
+    assert(small_array.size() == 1'000'000);
+    assert(small_array.byte_capacity() > initial_capacity);
+    for(int i = 0; i < 1'000'000; ++i) {
+        assert(small_array[i] == i * 3);
+    }
+    std::vector<int> more(10'000'000, 7);
+    small_array.append(more.begin(), more.end());
+    assert(small_array.size() == 11'000'000);
+    assert(small_array[999'999] == 999'999 * 3 && small_array.back() == 7);
+    std::cout << "Bytes reserved after growing: " << small_array.byte_capacity() << "\n";
+
+    // Arrays advised to use huge pages are aligned to them, including after growing
+    constexpr size_t huge_page_size = 1 << 21;
+    BigArrayOptions huge_options{.huge_pages = BigArrayOptions::HugePages::Advise};
+    BigArray<int> huge_array{1, huge_options};
+    assert(huge_array.byte_capacity() == huge_page_size);
+    assert(huge_array.options().huge_pages == BigArrayOptions::HugePages::Advise);
+    for(int i = 0; i < 3'000'000; ++i) {
+        huge_array.emplace_back(i);
+        assert((uintptr_t)huge_array.begin() % huge_page_size == 0);
+    }
+    assert(huge_array.byte_capacity() % huge_page_size == 0);
+    for(int i = 0; i < 3'000'000; ++i) {
+        assert(huge_array[i] == i);
+    }
+    // Moving keeps the options, so an array that was moved from grows the same way
+    BigArray<int> moved_array = std::move(huge_array);
+    assert(moved_array.size() == 3'000'000 && huge_array.size() == 0);
+    assert(huge_array.options().huge_pages == BigArrayOptions::HugePages::Advise);
+    huge_array.push_back(1);
+    assert((uintptr_t)huge_array.begin() % huge_page_size == 0 && huge_array[0] == 1);
+
+    // Explicit huge pages need a reserved pool, which may be empty
+    try {
+        BigArray<int> explicit_array{1, {.huge_pages = BigArrayOptions::HugePages::Explicit}};
+        explicit_array.append(more.begin(), more.end());
+        assert(explicit_array.size() == more.size() && explicit_array.back() == 7);
+        assert(explicit_array.byte_capacity() % huge_page_size == 0);
+    } catch(const std::runtime_error& error) {
+        std::cout << "No explicit huge pages: " << error.what() << "\n";
+    }
+
+    // Populated arrays and arrays bound to a NUMA node work like any other
+    for(BigArrayOptions options : {BigArrayOptions{.populate = true},
+                                   BigArrayOptions{.numa_node = BigArrayOptions::current_node},
+                                   BigArrayOptions{.populate = true, .numa_node = 0}}) {
+        BigArray<int> array{1000, options};
+        for(int i = 0; i < 1'000'000; ++i) {
+            array.emplace_back(i * 5);
+        }
+        for(int i = 0; i < 1'000'000; ++i) {
+            assert(array[i] == i * 5);
+        }
+    }
+    // No machine has this many NUMA nodes
+    bool threw = false;
+    try {
+        BigArray<int> array{1000, {.numa_node = 1 << 20}};
+    } catch(const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include "earley.hpp"
+#include "error_recovery.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Mult, LParen, RParen, Digit,
+    /* Nonterminals */
+    Number, Sum, Product, Factor,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::Digit; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    switch(terminal) {
+        case Symbol::Plus:   return input == '+';
+        case Symbol::Mult:   return input == '*';
+        case Symbol::LParen: return input == '(';
+        case Symbol::RParen: return input == ')';
+        case Symbol::Digit:  return std::isdigit(input);
+        default:             return false;
+    }
+}
+
+using Error = earley::ParseError<Symbol>;
+using earley::RecoveryKind;
+
+static
+bool same_state_sets(const SpanList<earley::EarleyItem>& a, const SpanList<earley::EarleyItem>& b)
+{
+    return a.size() == b.size() && std::ranges::equal(a, b, [](auto set_a, auto set_b) {
+        return std::ranges::equal(set_a, set_b);
+    });
+}
+
+static
+bool expects_only(const Error& error, std::vector<Symbol> terminals)
+{
+    for(int s = 0; s <= (int)Symbol::Digit; ++s) {
+        bool is_expected = std::ranges::find(terminals, (Symbol)s) != terminals.end();
+        if(error.expected.test((Symbol)s) != is_expected) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    using enum Symbol;
+    static const earley::Rule<Symbol> rules[] = {
+        { Sum,     { Sum, Plus, Product } },
+        { Sum,     { Product } },
+        { Product, { Product, Mult, Factor } },
+        { Product, { Factor } },
+        { Factor,  { LParen, Sum, RParen } },
+        { Factor,  { Number } },
+        { Number,  { Digit } },
+        { Number,  { Digit, Number } }
+    };
+    constexpr auto start_symbol = Sum;
+    std::span<const earley::Rule<Symbol>> rules_view = rules;
+    earley::RuleSet rule_set{rules_view};
+    const earley::RecoveryOptions insert_only{.insert_tokens = true};
+    const earley::RecoveryOptions skip_only{.max_skipped_tokens = 3};
+    std::vector<Error> errors;
+
+    // Valid input gives the same state sets as parse, and no errors
+    for(std::string input : {"1+2", "(12+3)*45", "((7))"}) {
+        auto state_sets = earley::parse_with_recovery<char>(rule_set, start_symbol, 16, input, errors, insert_only);
+        assert(errors.empty());
+        assert(same_state_sets(state_sets, earley::parse<char>(rule_set, start_symbol, 16, input)));
+    }
+
+    // By default, only the first error is reported, with what could have come instead, and the state sets
+    //  are those of parse
+    {
+        std::string input = "1+*2++3";
+        auto state_sets = earley::parse_with_recovery<char>(rule_set, start_symbol, 16, input, errors);
+        assert(errors.size() == 1);
+        assert(errors[0].pos == 2 && errors[0].recovery == RecoveryKind::Stopped);
+        assert(expects_only(errors[0], {LParen, Digit}));
+        assert(same_state_sets(state_sets, earley::parse<char>(rule_set, start_symbol, 16, input)));
+    }
+
+    // Inserting a missing token gets past each error in one pass
+    {
+        std::string input = "1+*2++3";
+        earley::parse_with_recovery<char>(rule_set, start_symbol, 16, input, errors, insert_only);
+        assert(errors.size() == 2);
+        assert(errors[0].pos == 2 && errors[0].recovery == RecoveryKind::Inserted && errors[0].inserted == Digit);
+        assert(errors[1].pos == 5 && errors[1].recovery == RecoveryKind::Inserted && errors[1].inserted == Digit);
+        assert(expects_only(errors[1], {LParen, Digit}));
+    }
+
+    // A missing token at the end of the input is inserted too
+    {
+        std::string input = "(1+2";
+        auto state_sets = earley::parse_with_recovery<char>(rule_set, start_symbol, 16, input, errors, insert_only);
+        assert(errors.size() == 1);
+        assert(errors[0].pos == 4 && errors[0].recovery == RecoveryKind::Inserted && errors[0].inserted == RParen);
+        assert(expects_only(errors[0], {Plus, Mult, RParen, Digit}));
+        // One state set for each token, one for the inserted token, and the empty one at the end
+        assert(state_sets.size() == input.size() + 3);
+
+        earley::parse_with_recovery<char>(rule_set, start_symbol, 16, input, errors);
+        assert(errors.size() == 1 && errors[0].pos == 4 && errors[0].recovery == RecoveryKind::Stopped);
+
+        // The errors of an earlier parse are cleared
+        earley::parse_with_recovery<char>(rule_set, start_symbol, 16, input + ")", errors);
+        assert(errors.empty());
+    }
+
+    // Tokens that fit nowhere are skipped
+    {
+        std::string input = "1+a+2*3)+b+4";
+        auto state_sets = earley::parse_with_recovery<char>(rule_set, start_symbol, 16, input, errors, skip_only);
+        assert(errors.size() == 3);
+        assert(errors[0].pos == 2 && errors[0].recovery == RecoveryKind::Skipped && errors[0].skipped_count == 2);
+        assert(errors[1].pos == 7 && errors[1].recovery == RecoveryKind::Skipped && errors[1].skipped_count == 1);
+        assert(expects_only(errors[1], {Plus, Mult, Digit}));
+        assert(errors[2].pos == 9 && errors[2].recovery == RecoveryKind::Skipped && errors[2].skipped_count == 2);
+        // Skipped tokens take no state sets
+        assert(state_sets.size() == input.size() - 5 + 2);
+    }
+
+    // Inserting is tried before skipping
+    {
+        std::string input = "1+)2";
+        earley::RecoveryOptions both{.insert_tokens = true, .max_skipped_tokens = 1};
+        earley::parse_with_recovery<char>(rule_set, start_symbol, 16, input, errors, both);
+        assert(errors.size() == 1 && errors[0].recovery == RecoveryKind::Skipped && errors[0].skipped_count == 1);
+
+        input = "1+(2";
+        earley::parse_with_recovery<char>(rule_set, start_symbol, 16, input, errors, both);
+        assert(errors.size() == 1 && errors[0].recovery == RecoveryKind::Inserted && errors[0].inserted == RParen);
+    }
+
+    // Recovery is bounded: more bad tokens in a row than can be skipped stop the parse
+    {
+        std::string input = "1+abcd+2";
+        earley::parse_with_recovery<char>(rule_set, start_symbol, 16, input, errors, skip_only);
+        assert(errors.size() == 1 && errors[0].pos == 2 && errors[0].recovery == RecoveryKind::Stopped);
+
+        input = "1+ab+2";
+        earley::parse_with_recovery<char>(rule_set, start_symbol, 16, input, errors, skip_only);
+        assert(errors.size() == 1 && errors[0].recovery == RecoveryKind::Skipped && errors[0].skipped_count == 3);
+    }
+
+    // So is the number of errors
+    {
+        std::string input = "1++2++3++4";
+        earley::RecoveryOptions limited{.insert_tokens = true, .max_errors = 2};
+        earley::parse_with_recovery<char>(rule_set, start_symbol, 16, input, errors, limited);
+        assert(errors.size() == 2);
+        assert(errors[0].recovery == RecoveryKind::Inserted && errors[1].recovery == RecoveryKind::Stopped);
+        assert(errors[1].pos == 5);
+    }
+
+    // Errors found in one pass over a long input
+    {
+        std::string input;
+        for(int i = 0; i < 1000; ++i) {
+            input += i % 10 == 0 ? "1+?+" : "1+";
+        }
+        input += "1";
+        earley::parse_with_recovery<char>(rule_set, start_symbol, 16, input, errors, skip_only);
+        assert(errors.size() == 100);
+        assert(std::ranges::all_of(errors, [](const Error& error) {
+            return error.recovery == RecoveryKind::Skipped && error.skipped_count == 2;
+        }));
+    }
+
+    return 0;
+}
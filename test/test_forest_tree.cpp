@@ -0,0 +1,155 @@
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cassert>
+#include "forest_tree.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Minus, Mult, Pow, Digit, A,
+    /* Nonterminals */
+    Expr, S, N,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::A; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    switch(terminal) {
+        case Symbol::Plus:  return input == '+';
+        case Symbol::Minus: return input == '-';
+        case Symbol::Mult:  return input == '*';
+        case Symbol::Pow:   return input == '^';
+        case Symbol::Digit: return std::isdigit(input);
+        case Symbol::A:     return input == 'a';
+        default:            return false;
+    }
+}
+
+using Forest = earley::ParseForest<Symbol>;
+using Tree = earley::ForestTree<Symbol>;
+
+/* Returns the input matched by node, with each rule of more than one component parenthesized */
+static
+std::string to_string(const Forest& forest, const Tree& tree, earley::ForestNodeId node, std::string_view input)
+{
+    if(forest[node].is_terminal()) {
+        return std::string{input[forest[node].start_pos]};
+    }
+    std::string children;
+    size_t child_count = 0;
+    tree.for_each_child(node, [&](earley::ForestNodeId child) {
+        children += to_string(forest, tree, child, input);
+        ++child_count;
+    });
+    return child_count > 1 ? "(" + children + ")" : children;
+}
+
+/* Returns the parenthesized tree chosen for the whole input, or "" if it has no parse */
+static
+std::string extract(std::span<const earley::Rule<Symbol>> rules, Symbol start_symbol, std::string_view input)
+{
+    earley::RuleSet rule_set{rules};
+    Forest forest;
+    earley::parse<char>(rule_set, start_symbol, 100, input, forest);
+    auto root = forest.find_symbol_node(start_symbol, 0, input.size());
+    if(root == earley::no_forest_node) {
+        return "";
+    }
+    Tree tree{rules, forest, root};
+    assert(tree.root() == root && tree.contains(root));
+    return to_string(forest, tree, root, input);
+}
+
+int main()
+{
+    using enum Symbol;
+    using earley::Associativity;
+
+    // Priorities and associativity resolve an ambiguous expression grammar like operator precedence
+    {
+        static const earley::Rule<Symbol> rules[] = {
+            { Expr, { Expr, Plus, Expr },  1, Associativity::Left },
+            { Expr, { Expr, Minus, Expr }, 1, Associativity::Left },
+            { Expr, { Expr, Mult, Expr },  2, Associativity::Left },
+            { Expr, { Expr, Pow, Expr },   3, Associativity::Right },
+            { Expr, { Digit },             4 }
+        };
+        assert(extract(rules, Expr, "1") == "1");
+        assert(extract(rules, Expr, "1+2") == "(1+2)");
+        assert(extract(rules, Expr, "1-2-3") == "((1-2)-3)");
+        assert(extract(rules, Expr, "1+2*3") == "(1+(2*3))");
+        assert(extract(rules, Expr, "1*2+3") == "((1*2)+3)");
+        assert(extract(rules, Expr, "1+2*3-4") == "((1+(2*3))-4)");
+        assert(extract(rules, Expr, "1-2+3*4*5") == "((1-2)+((3*4)*5))");
+        assert(extract(rules, Expr, "2^3^4") == "(2^(3^4))");
+        assert(extract(rules, Expr, "2*3^4^5*6") == "((2*(3^(4^5)))*6)");
+        assert(extract(rules, Expr, "1+") == "");
+    }
+
+    // Associativity also splits the components of one rule, and choosing a tree does not list the
+    //  (Catalan(n - 1)) trees of the forest
+    {
+        static const earley::Rule<Symbol> left_rules[] = {
+            { S, { S, S }, 0, Associativity::Left },
+            { S, { A } }
+        };
+        static const earley::Rule<Symbol> right_rules[] = {
+            { S, { S, S }, 0, Associativity::Right },
+            { S, { A } }
+        };
+        assert(extract(left_rules, S, "aaaa") == "(((aa)a)a)");
+        assert(extract(right_rules, S, "aaaa") == "(a(a(aa)))");
+
+        std::string input(60, 'a');
+        std::string expected = "a";
+        for(size_t i = 1; i < input.size(); ++i) {
+            expected = "(" + expected + "a)";
+        }
+        assert(extract(left_rules, S, input) == expected);
+    }
+
+    // Without priorities, the rule with the lowest index is chosen
+    {
+        static const earley::Rule<Symbol> rules[] = {
+            { S, { N, A } },
+            { S, { A, N } },
+            { N, { A } },
+            { N, { A, A } }
+        };
+        assert(extract(rules, S, "aa") == "(aa)");
+        assert(extract(rules, S, "aaa") == "((aa)a)");
+    }
+
+    // Cycles (through unit and empty rules) are never chosen, even when their rules are preferred
+    {
+        static const earley::Rule<Symbol> rules[] = {
+            { S, { S } },
+            { S, { N, S } },
+            { S, { A } },
+            { N, { N, N } },
+            { N, {} }
+        };
+        assert(extract(rules, S, "a") == "a");
+        assert(extract(rules, S, "b") == "");
+    }
+
+    // An unambiguous parse is extracted as it is, including right-recursive rules
+    {
+        static const earley::Rule<Symbol> rules[] = {
+            { Expr, { Expr, Plus, S } },
+            { Expr, { S } },
+            { S,    { Digit } },
+            { S,    { Digit, S } }
+        };
+        assert(extract(rules, Expr, "12+345+6") == "(((12)+(3(45)))+6)");
+    }
+
+    return 0;
+}
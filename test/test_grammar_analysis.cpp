@@ -0,0 +1,122 @@
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include <cassert>
+#include "earley.hpp"
+#include "static_rule_set.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    X, Y,
+    /* Nonterminals */
+    S, A, B, C, D, Dead, Unreachable, Loop,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::Y; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    switch(terminal) {
+        case Symbol::X: return input == 'x';
+        case Symbol::Y: return input == 'y';
+        default:        return false;
+    }
+}
+
+static constexpr
+auto make_rules()
+{
+    using enum Symbol;
+    return std::vector<earley::Rule<Symbol>>{
+        { S,           { A, X } },
+        { S,           { Dead, Y } },
+        { S,           { Loop } },
+        // Nullable only through a chain that is found in reverse rule order
+        { A,           { B, B } },
+        { B,           { C } },
+        { C,           { D, D, D } },
+        { D,           {} },
+        { D,           { Y } },
+        // Can never derive a string of terminals
+        { Dead,        { X, Dead } },
+        { Loop,        { Loop } },
+        { Unreachable, { X } }
+    };
+}
+
+static constexpr auto static_rule_set = earley::make_static_rule_set([] { return make_rules(); });
+
+static_assert(static_rule_set.is_nullable(Symbol::A) && static_rule_set.is_nullable(Symbol::C));
+static_assert(!static_rule_set.is_nullable(Symbol::S) && !static_rule_set.is_nullable(Symbol::Dead));
+
+int main()
+{
+    using enum Symbol;
+    auto rules = make_rules();
+    std::span<const earley::Rule<Symbol>> rules_view = rules;
+    earley::RuleSet rule_set{rules_view};
+
+    for(auto symbol : {A, B, C, D}) {
+        assert(rule_set.is_nullable(symbol));
+    }
+    for(auto symbol : {S, Dead, Loop, Unreachable, X, Y}) {
+        assert(!rule_set.is_nullable(symbol));
+    }
+    for(auto symbol : {X, Y, S, A, B, C, D, Unreachable}) {
+        assert(rule_set.is_productive(symbol));
+    }
+    assert(!rule_set.is_productive(Dead) && !rule_set.is_productive(Loop));
+
+    // Unproductive rules are never predicted. Without a start symbol, every symbol is reachable.
+    assert(rule_set.is_reachable(Unreachable) && rule_set.is_useful(10));
+    for(size_t rule_idx : {1, 2, 8, 9}) {
+        assert(!rule_set.is_useful(rule_idx));
+    }
+    for(auto symbol : {S, Dead, Loop}) {
+        for(auto predicted_item : rule_set.prediction(symbol)) {
+            assert(rule_set.is_useful(predicted_item.rule_idx));
+        }
+    }
+    assert(rule_set.prediction(Dead).empty() && !rule_set.first_set(Dead).test(X) && rule_set.first_set(S).test(X));
+
+    // With a start symbol, the rules of unreachable symbols are not useful either
+    earley::RuleSet reachable_rule_set{rules_view, S};
+    assert(!reachable_rule_set.is_reachable(Unreachable) && !reachable_rule_set.is_useful(10));
+    // Symbols only reachable through unproductive rules are not reachable
+    assert(!reachable_rule_set.is_reachable(Dead) && !reachable_rule_set.is_reachable(Loop));
+    assert(reachable_rule_set.is_reachable(D) && reachable_rule_set.is_useful(7));
+    assert(reachable_rule_set.prediction(Unreachable).empty());
+
+    // Pruning does not change which inputs match
+    for(std::string_view input : {"x", "yx", "yyyyyyx", "y", "xx", "yxx", ""}) {
+        bool is_match = input.size() <= 7 && input.ends_with('x') && input.find('x') == input.size() - 1;
+        for(const auto* curr_rule_set : {&rule_set, &reachable_rule_set}) {
+            auto state_sets = earley::parse<char>(*curr_rule_set, S, 100, input);
+            assert((bool)earley::find_full_parse(rules_view, S, state_sets, input) == is_match);
+            // Items of useless rules are only added to the first state set
+            for(size_t set_pos = 1; set_pos < state_sets.size(); ++set_pos) {
+                for(auto item : state_sets[set_pos]) {
+                    assert(curr_rule_set->is_useful(item.rule_idx));
+                }
+            }
+        }
+        auto static_state_sets = earley::parse<char>(static_rule_set, S, 100, input);
+        assert(static_state_sets.num_of_items() == earley::parse<char>(rule_set, S, 100, input).num_of_items());
+    }
+
+    // A long nullable chain, found in one pass
+    std::vector<earley::Rule<Symbol>> chain_rules;
+    for(int i = 0; i < 10'000; ++i) {
+        chain_rules.push_back({ A, { B, A } });
+    }
+    chain_rules.push_back({ A, {} });
+    chain_rules.push_back({ B, {} });
+    earley::RuleSet chain_rule_set{std::span<const earley::Rule<Symbol>>{chain_rules}, A};
+    assert(chain_rule_set.is_nullable(A) && chain_rule_set.is_nullable(B) && !chain_rule_set.is_reachable(S));
+
+    return 0;
+}
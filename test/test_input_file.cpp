@@ -1,16 +1,24 @@
 #include <iostream>
-#include <fstream>
-#include <iterator>
 #include <cassert>
 #include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <cstdint>
 #include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
 #include <ratio>
 #include <chrono>
 #include "earley_print.hpp"
 #include "span_list.hpp"
 #include "earley.hpp"
+#include "parse_forest.hpp"
+#include "parse_tree.hpp"
+#include "forest_tree.hpp"
+#include "mapped_file.hpp"
 
 enum class Symbol : uint8_t {
     /* Terminals */
@@ -54,48 +62,40 @@ void print_elapsed_time(auto start_time, const char* label)
     std::cerr << label << ": " << duration.count() << "ms\n";
 }
 
-//static
-//std::ostream& indent(std::ostream& out, uint16_t indent_level)
-//{
-//    for(uint16_t i = 0; i < indent_level; ++i) {
-//        out << "  ";
-//    }
-//    return out;
-//}
-
-// TODO: how to do left vs. right associativity (currently we are essentially forcing right associativity
-//  since we can only traverse the parse tree depth-first starting at the right)
+/* Walks one derivation of the full parse left to right without building a tree. Returns the number
+   of nodes visited. */
 static
-void print_parse_tree(std::ostream& out, std::span<const Rule> rules, const SpanList<earley::EarleyItem>& state_sets,
-                      const Rule& rule, earley::StateSetIterator curr_state_set, uint16_t indent_level = 0)
+size_t traverse_parse_tree(std::span<const Rule> rules, const SpanList<earley::EarleyItem>& state_sets,
+                           earley::ParseResult full_parse)
 {
-    for(auto comp_sym = rule.components.rbegin(); comp_sym < rule.components.rend(); ++comp_sym) {
-        if(is_terminal(*comp_sym)) {
-            /*
-            Note: While there are one or more partially complete items in curr_state_set that correspond to our current
-            subcomponent (those items' dots will be just before comp_sym), there is no point in searching
-            for them since we already know the parent item, our position in it, the terminal symbol at that position,
-            and how to get to the next relevant state set.
-            */
-            //indent(out, indent_level) << *comp_sym << "\n";
-            earley::advance_from_terminal(curr_state_set);
-        } else {
-            auto curr_item = earley::find_completed_item(rules, curr_state_set->begin(), curr_state_set->end(), *comp_sym);
-            assert(curr_item != curr_state_set->end());
-            //indent(out, indent_level); print_item(out, rules, *curr_item) << "\n";
-            print_parse_tree(out, rules, state_sets, rules[curr_item->rule_idx], curr_state_set, indent_level + 1);
-            {
-                auto alt_item = earley::find_completed_item(rules, curr_item + 1, curr_state_set->end(), *comp_sym);
-                while(alt_item != curr_state_set->end()) {
-                    //indent(out, indent_level) << "Alternative: "; print_item(out, rules, *alt_item) << "\n";
-                    alt_item = earley::find_completed_item(rules, alt_item + 1, curr_state_set->end(), *comp_sym);
-                }
-            }
-            earley::advance_from_nonterminal(state_sets, curr_state_set, curr_item);
+    size_t node_count = 0;
+    for(const auto& event : earley::ParseTreeWalker{rules, state_sets, full_parse}) {
+        if(event.kind == earley::TreeEventKind::Enter) {
+            ++node_count;
         }
     }
+    return node_count;
 }
 
+/* Visits each node of the parse tree chosen out of the forest (with an explicit stack, since the tree
+   can be as deep as the input is long). Returns the number of nodes visited. */
+static
+size_t traverse_parse_forest(std::span<const Rule> rules, const earley::ParseForest<Symbol>& forest,
+                             earley::ForestNodeId root)
+{
+    earley::ForestTree tree{rules, forest, root};
+    size_t node_count = 0;
+    std::vector<earley::ForestNodeId> stack{root};
+    while(!stack.empty()) {
+        auto node = stack.back();
+        stack.pop_back();
+        ++node_count;
+        if(!forest[node].is_terminal()) {
+            tree.for_each_child(node, [&](earley::ForestNodeId child) { stack.push_back(child); });
+        }
+    }
+    return node_count;
+}
 
 int main(int argc, char** argv)
 {
@@ -129,12 +129,26 @@ int main(int argc, char** argv)
     std::span<const Rule> rules_view = rules;
     earley::RuleSet rule_set{rules_view};
 
-    std::ifstream input_file{argv[1]};
-    if(!input_file) {
-        std::cerr << "Error: failed to open input file: '" << argv[1] << "'\n";
-        return 1;
+    // Whitespace is ignored. The file is parsed in place, unless it has whitespace before its last
+    //  token (not just e.g. a final newline), in which case a copy without the whitespace is parsed
+    MappedFile input_file = [&] {
+        try {
+            return MappedFile{argv[1]};
+        } catch(const std::runtime_error& err) {
+            std::cerr << "Error: " << err.what() << "\n";
+            std::exit(1);
+        }
+    }();
+    auto is_space = [](char c) { return std::isspace((unsigned char)c) != 0; };
+    std::string_view input = input_file.view();
+    while(!input.empty() && is_space(input.back())) {
+        input.remove_suffix(1);
+    }
+    std::string stripped_input;
+    if(std::ranges::any_of(input, is_space)) {
+        std::ranges::copy_if(input, std::back_inserter(stripped_input), [&](char c) { return !is_space(c); });
+        input = stripped_input;
     }
-    std::string input{std::istream_iterator<char>{input_file}, std::istream_iterator<char>{}};
     std::cerr << "Input length: " << input.size() << " bytes\n";
 
     auto start_time = std::chrono::steady_clock::now();
@@ -148,18 +162,48 @@ int main(int argc, char** argv)
     //    print_state_set(std::cerr, rules_view, state_set) << "\n";
     //}
 
+    // Same recognition, feeding the file to the recognizer a window at a time instead of all at once
+    {
+        start_time = std::chrono::steady_clock::now();
+        earley::Recognizer recognizer{rule_set, start_symbol, 1'000'000};
+        MappedFile stream_file{argv[1]};
+        stream_file.for_each_window(64 * 1024, [&](std::span<const char> window) {
+            for(char c : window) {
+                if(!is_space(c) && !recognizer.feed(c)) {
+                    return false;
+                }
+            }
+            return true;
+        });
+        const auto& stream_state_sets = recognizer.finish();
+        print_elapsed_time(start_time, "Recognizer time (streaming)");
+        assert(stream_state_sets.num_of_items() == state_sets.num_of_items());
+    }
+
     auto full_parse = earley::find_full_parse(rules_view, start_symbol, state_sets, input);
     if(!full_parse) {
         std::cerr << "Error: parse failed\n";
         return 1;
     }
-    const auto& full_parse_rule = rules[full_parse.item->rule_idx];
     std::cerr << "Full parse: "; earley::print_item(std::cerr, rules_view, *full_parse.item) << "\n";
 
     std::cerr << "\nTraverse parse tree:\n";
     start_time = std::chrono::steady_clock::now();
-    print_parse_tree(std::cerr, rules, state_sets, full_parse_rule, full_parse.state_set);
+    auto tree_node_count = traverse_parse_tree(rules_view, state_sets, full_parse);
     print_elapsed_time(start_time, "Parse traversal time");
+    std::cerr << "Nodes walked: " << tree_node_count << "\n";
+
+    std::cerr << "\nTraverse parse forest:\n";
+    start_time = std::chrono::steady_clock::now();
+    earley::ParseForest<Symbol> forest;
+    parse<char>(rule_set, start_symbol, 1'000'000, input, forest);
+    print_elapsed_time(start_time, "Recognizer time (with forest)");
+    start_time = std::chrono::steady_clock::now();
+    auto root = forest.find_symbol_node(start_symbol, 0, input.size());
+    assert(root != earley::no_forest_node);
+    auto node_count = traverse_parse_forest(rules_view, forest, root);
+    print_elapsed_time(start_time, "Parse forest traversal time");
+    std::cerr << "Parse tree nodes: " << node_count << ", forest nodes: " << forest.num_of_nodes() << "\n";
 
     return 0;
 }
@@ -0,0 +1,149 @@
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+#include "earley.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Digit,
+    /* Nonterminals */
+    Number, Sum, Long,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::Digit; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    switch(terminal) {
+        case Symbol::Plus:  return input == '+';
+        case Symbol::Digit: return std::isdigit(input);
+        default:            return false;
+    }
+}
+
+static_assert(sizeof(earley::CompactEarleyItem) == 4);
+static_assert(sizeof(earley::EarleyItem) == 8);
+static_assert(sizeof(earley::WideEarleyItem) == 16);
+static_assert(std::same_as<detail::span_offset<earley::EarleyItem>::type, uint32_t>);
+static_assert(std::same_as<detail::span_offset<earley::WideEarleyItem>::type, uint64_t>);
+
+/* Returns true if both outputs of the recognizer have the same items, whatever their layouts */
+template<typename ItemA, typename ItemB>
+bool same_state_sets(const SpanList<ItemA>& a, const SpanList<ItemB>& b)
+{
+    return a.size() == b.size() && std::ranges::equal(a, b, [](auto set_a, auto set_b) {
+        return std::ranges::equal(set_a, set_b, [](ItemA item_a, ItemB item_b) {
+            return item_a.rule_idx == item_b.rule_idx && item_a.progress == item_b.progress
+                && item_a.start_pos == item_b.start_pos;
+        });
+    });
+}
+
+template<typename Exception>
+bool throws(auto&& callback)
+{
+    try {
+        callback();
+    } catch(const Exception&) {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    using enum Symbol;
+    static const earley::Rule<Symbol> rules[] = {
+        { Sum,    { Sum, Plus, Number } },
+        { Sum,    { Number } },
+        { Number, { Digit } },
+        { Number, { Digit, Number } }
+    };
+    constexpr auto start_symbol = Sum;
+    std::span<const earley::Rule<Symbol>> rules_view = rules;
+    earley::RuleSet rule_set{rules_view};
+
+    // Every layout gives the same state sets
+    for(const std::string& input : std::vector<std::string>{"1+2", "34+5+678", "", "1++", "9", std::string(300, '4') + "+1"}) {
+        auto state_sets = earley::parse<char>(rule_set, start_symbol, 16, input);
+        auto compact_state_sets = earley::parse<char, earley::CompactEarleyItem>(rule_set, start_symbol, 16, input);
+        auto wide_state_sets = earley::parse<char, earley::WideEarleyItem>(rule_set, start_symbol, 16, input);
+        assert(same_state_sets(state_sets, compact_state_sets));
+        assert(same_state_sets(state_sets, wide_state_sets));
+
+        SpanList<earley::BasicLeoItem<earley::CompactEarleyItem>> leo_items{16};
+        auto compact_leo_state_sets = earley::parse<char>(rule_set, start_symbol, 16, input, leo_items);
+        SpanList<earley::LeoItem> expected_leo_items{16};
+        assert(same_state_sets(compact_leo_state_sets, earley::parse<char>(rule_set, start_symbol, 16, input, expected_leo_items)));
+
+        earley::Parser<Symbol, false, earley::CompactEarleyItem> parser;
+        assert(same_state_sets(parser.parse<char>(rule_set, start_symbol, input), compact_state_sets));
+        earley::Recognizer<Symbol, earley::RuleSet<Symbol>, earley::detail::NoLookahead, false, earley::WideEarleyItem>
+            recognizer{rule_set, start_symbol};
+        recognizer.feed(std::span{input});
+        assert(same_state_sets(recognizer.finish(), wide_state_sets));
+
+        // The traversal helpers work on any layout
+        auto full_parse = earley::find_full_parse(rules_view, start_symbol, compact_state_sets, input);
+        assert((bool)full_parse == (bool)earley::find_full_parse(rules_view, start_symbol, state_sets, input));
+        if(full_parse) {
+            auto state_set = full_parse.state_set;
+            auto item = earley::find_completed_item(rules_view, state_set->begin(), state_set->end(), Sum);
+            assert(item != state_set->end() && item->start_pos == 0);
+            earley::advance_from_nonterminal(compact_state_sets, state_set, item);
+            assert(state_set == compact_state_sets.begin());
+        }
+    }
+
+    // Compact items use half the memory of the default ones
+    std::string long_input = "1";
+    while(long_input.size() + 2 <= 65535) {
+        long_input += "+2";
+    }
+    auto state_sets = earley::parse<char>(rule_set, start_symbol, 16, long_input);
+    auto compact_state_sets = earley::parse<char, earley::CompactEarleyItem>(rule_set, start_symbol, 16, long_input);
+    assert(same_state_sets(state_sets, compact_state_sets));
+    assert(earley::find_full_parse(rules_view, start_symbol, compact_state_sets, long_input));
+    assert(compact_state_sets.num_of_items() * sizeof(earley::CompactEarleyItem) * 2
+           == state_sets.num_of_items() * sizeof(earley::EarleyItem));
+    std::cout << "Item bytes: " << state_sets.num_of_items() * sizeof(earley::EarleyItem) << " (default), "
+              << compact_state_sets.num_of_items() * sizeof(earley::CompactEarleyItem) << " (compact)\n";
+
+    // Inputs and grammars that do not fit in the item layout are rejected instead of overflowing
+    long_input += "+3";
+    assert(throws<std::runtime_error>([&] {
+        earley::parse<char, earley::CompactEarleyItem>(rule_set, start_symbol, 16, long_input);
+    }));
+    assert(earley::find_full_parse(rules_view, start_symbol, earley::parse<char>(rule_set, start_symbol, 16, long_input),
+                                   long_input));
+
+    std::vector<earley::Rule<Symbol>> many_rules(300, earley::Rule<Symbol>{Sum, {Number}});
+    many_rules.push_back({Number, {Digit}});
+    earley::RuleSet many_rule_set{std::span<const earley::Rule<Symbol>>{many_rules}};
+    assert(throws<std::runtime_error>([&] {
+        earley::parse<char, earley::CompactEarleyItem>(many_rule_set, start_symbol, 16, std::string{"1"});
+    }));
+    assert(earley::find_full_parse(std::span<const earley::Rule<Symbol>>{many_rules}, start_symbol,
+                                   earley::parse<char>(many_rule_set, start_symbol, 16, std::string{"1"}), std::string{"1"}));
+
+    std::vector<earley::Rule<Symbol>> long_rules = {{Long, std::vector<Symbol>(300, Digit)}};
+    earley::RuleSet long_rule_set{std::span<const earley::Rule<Symbol>>{long_rules}};
+    assert(throws<std::runtime_error>([&] {
+        earley::Recognizer<Symbol, earley::RuleSet<Symbol>, earley::detail::NoLookahead, false, earley::CompactEarleyItem>
+            recognizer{long_rule_set, Long};
+    }));
+    auto long_rule_state_sets = earley::parse<char, earley::WideEarleyItem>(long_rule_set, Long, 16, std::string(300, '5'));
+    assert(earley::find_full_parse(std::span<const earley::Rule<Symbol>>{long_rules}, Long, long_rule_state_sets,
+                                   std::string(300, '5')));
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "item_scan.hpp"
+#include "earley.hpp"
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+
+int main()
+{
+    std::cout << "Scanning with: " << detail::item_scan_isa << "\n";
+
+    // Every position of a match (including the unrolled blocks and the scalar tail) is found
+    for(uint32_t size = 0; size < 40; ++size) {
+        std::vector<earley::EarleyItem> items;
+        for(uint32_t i = 0; i < size; ++i) {
+            items.emplace_back(1, i, 1);
+        }
+        const auto* first = items.data();
+        const auto* last = first + items.size();
+        for(uint32_t i = 0; i < size; ++i) {
+            assert(detail::find_item(first, last, earley::EarleyItem{1, i, 1}) == first + i);
+            assert(item_exists(items, earley::EarleyItem{1, i, 1}));
+        }
+        assert(detail::find_item(first, last, earley::EarleyItem{1, size, 1}) == last);
+        assert(detail::find_item(first, last, earley::EarleyItem{1, 0, 0}) == last);
+        assert(!item_exists(items, earley::EarleyItem{2, 0, 1}));
+    }
+
+    // Masked scans only compare the selected fields, and return the first match
+    std::mt19937 rng{42};
+    const uint64_t start_pos_mask = detail::item_bits(earley::EarleyItem{0, UINT32_MAX, 0});
+    const uint64_t rule_mask = detail::item_bits(earley::EarleyItem{UINT16_MAX, 0, 0});
+    for(int trial = 0; trial < 2000; ++trial) {
+        std::vector<earley::EarleyItem> items;
+        auto size = rng() % 100;
+        for(size_t i = 0; i < size; ++i) {
+            items.emplace_back((uint16_t)(rng() % 4), rng() % 8, (uint16_t)(rng() % 3));
+        }
+        const auto* first = items.data();
+        const auto* last = first + items.size();
+        uint32_t start_pos = rng() % 8;
+        auto expected = std::ranges::find(items, start_pos, &earley::EarleyItem::start_pos);
+        assert(detail::find_masked(first, last, start_pos_mask, detail::item_bits(earley::EarleyItem{0, start_pos, 0}))
+               == first + (expected - items.begin()));
+        uint16_t rule_idx = rng() % 4;
+        expected = std::ranges::find(items, rule_idx, &earley::EarleyItem::rule_idx);
+        assert(detail::find_masked(first, last, rule_mask, detail::item_bits(earley::EarleyItem{rule_idx, 0, 0}))
+               == first + (expected - items.begin()));
+    }
+
+    // 4-byte items are scanned the same way
+    for(uint32_t size = 0; size < 70; ++size) {
+        std::vector<earley::CompactEarleyItem> items;
+        for(uint32_t i = 0; i < size; ++i) {
+            items.emplace_back(3, (uint16_t)i, 2);
+        }
+        const auto* first = items.data();
+        const auto* last = first + items.size();
+        for(uint32_t i = 0; i < size; ++i) {
+            assert(detail::find_item(first, last, earley::CompactEarleyItem{3, (uint16_t)i, 2}) == first + i);
+        }
+        assert(detail::find_item(first, last, earley::CompactEarleyItem{3, (uint16_t)size, 2}) == last);
+        assert(!item_exists(items, earley::CompactEarleyItem{3, 0, 1}));
+        auto start_pos_mask = detail::item_bits(earley::CompactEarleyItem{0, UINT16_MAX, 0});
+        if(size > 0) {
+            assert(detail::find_masked(first, last, start_pos_mask, detail::item_bits(earley::CompactEarleyItem{0, (uint16_t)(size - 1), 0}))
+                   == last - 1);
+        }
+    }
+
+    return 0;
+}
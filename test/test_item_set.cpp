@@ -0,0 +1,37 @@
+#include "item_set.hpp"
+#include "earley.hpp"
+#include <iostream>
+#include <cassert>
+
+int main()
+{
+    ItemSet<earley::EarleyItem> items{4};
+
+    assert(items.empty());
+    assert(items.insert(earley::EarleyItem{0, 0}));
+    assert(items.insert(earley::EarleyItem{0, 0, 1}));
+    assert(items.insert(earley::EarleyItem{1, 0}));
+    assert(!items.insert(earley::EarleyItem{0, 0, 1}));
+    assert(items.size() == 3);
+    assert(items.contains(earley::EarleyItem{1, 0}));
+    assert(!items.contains(earley::EarleyItem{1, 5}));
+
+    // Force several rehashes
+    for(uint32_t i = 0; i < 1000; ++i) {
+        assert(items.insert(earley::EarleyItem{2, i}));
+    }
+    assert(items.size() == 1003);
+    assert(items.contains(earley::EarleyItem{0, 0, 1}));
+    assert(items.contains(earley::EarleyItem{2, 999}));
+    std::cout << "Capacity after inserting " << items.size() << " items: " << items.capacity() << "\n";
+
+    // Clearing keeps capacity but forgets all items
+    auto capacity = items.capacity();
+    items.clear();
+    assert(items.empty());
+    assert(items.capacity() == capacity);
+    assert(!items.contains(earley::EarleyItem{0, 0, 1}));
+    assert(items.insert(earley::EarleyItem{0, 0, 1}));
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <tuple>
+#include <iostream>
+#include <cassert>
+#include "earley.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Digit,
+    /* Nonterminals */
+    Number, Sum,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::Digit; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    switch(terminal) {
+        case Symbol::Plus:  return input == '+';
+        case Symbol::Digit: return std::isdigit(input);
+        default:            return false;
+    }
+}
+
+static
+bool item_less(earley::EarleyItem a, earley::EarleyItem b)
+{
+    return std::tie(a.rule_idx, a.progress, a.start_pos) < std::tie(b.rule_idx, b.progress, b.start_pos);
+}
+
+int main()
+{
+    using enum Symbol;
+    static const earley::Rule<Symbol> rules[] = {
+        { Sum,    { Sum, Plus, Number } },
+        { Sum,    { Number } },
+        { Number, { Digit } },
+        { Number, { Digit, Number } }
+    };
+    constexpr auto start_symbol = Sum;
+    std::span<const earley::Rule<Symbol>> rules_view = rules;
+    earley::RuleSet rule_set{rules_view};
+
+    std::string input = "12+" + std::string(500, '7') + "+3";
+    auto state_sets = earley::parse<char>(rule_set, start_symbol, 1'000'000, input);
+    SpanList<earley::LeoItem> leo_items{1'000'000};
+    auto leo_state_sets = earley::parse<char>(rule_set, start_symbol, 1'000'000, input, leo_items);
+    std::cout << "Items without Leo items: " << state_sets.num_of_items() << "\n";
+    std::cout << "Items with Leo items: " << leo_state_sets.num_of_items() << "\n";
+    assert(leo_state_sets.num_of_items() < state_sets.num_of_items() / 10);
+
+    auto full_parse = earley::find_full_parse(rules_view, start_symbol, state_sets, input);
+    auto leo_full_parse = earley::find_full_parse(rules_view, start_symbol, leo_state_sets, input);
+    assert(full_parse && leo_full_parse);
+    assert(*full_parse.item == *leo_full_parse.item);
+
+    // The items left out by the Leo-mode recognizer should be exactly the ones it skipped
+    assert(state_sets.size() == leo_state_sets.size());
+    for(auto state_set = state_sets.begin(), leo_state_set = leo_state_sets.begin(); state_set != state_sets.end();
+        ++state_set, ++leo_state_set) {
+        std::vector<earley::EarleyItem> expected{state_set->begin(), state_set->end()};
+        std::vector<earley::EarleyItem> actual{leo_state_set->begin(), leo_state_set->end()};
+        earley::detail::for_each_leo_skipped_item(rules_view, leo_state_sets, leo_items, leo_state_set,
+                                                  [&actual](earley::EarleyItem item) {
+            actual.push_back(item);
+            return false;
+        });
+        std::ranges::sort(expected, item_less);
+        std::ranges::sort(actual, item_less);
+        assert(expected == actual);
+    }
+
+    // Items that were skipped can be found during traversal
+    {
+        static const earley::Rule<Symbol> alternating_rules[] = {
+            { Sum,    { Digit, Number } },
+            { Sum,    { Digit } },
+            { Number, { Plus, Sum } }
+        };
+        std::span<const earley::Rule<Symbol>> alternating_rules_view = alternating_rules;
+        earley::RuleSet alternating_rule_set{alternating_rules_view};
+        std::string alternating_input = "1+2+3";
+        SpanList<earley::LeoItem> alternating_leo_items{100};
+        auto alternating_state_sets = earley::parse<char>(alternating_rule_set, start_symbol, 100, alternating_input,
+                                                          alternating_leo_items);
+        assert(earley::find_full_parse(alternating_rules_view, start_symbol, alternating_state_sets, alternating_input));
+
+        // The only completed Number item in the last state set is on the reduction path
+        auto last_set = alternating_state_sets.begin() + alternating_input.size();
+        assert(earley::find_completed_item(alternating_rules_view, last_set->begin(), last_set->end(), Number) == last_set->end());
+        auto number = earley::find_completed_item(alternating_rules_view, alternating_state_sets, alternating_leo_items,
+                                                  last_set, Number);
+        assert(number && number->start_pos == 3);
+        earley::advance_from_nonterminal(alternating_state_sets, last_set, *number);
+        assert(last_set == alternating_state_sets.begin() + 3);
+        number = earley::find_completed_item(alternating_rules_view, alternating_state_sets, alternating_leo_items,
+                                             last_set, Number);
+        assert(number && number->start_pos == 1);
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include "earley.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Times, Minus, LParen, RParen, Digit,
+    /* Nonterminals */
+    Sign, Factor, Term, Expr,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::Digit; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    switch(terminal) {
+        case Symbol::Plus:   return input == '+';
+        case Symbol::Times:  return input == '*';
+        case Symbol::Minus:  return input == '-';
+        case Symbol::LParen: return input == '(';
+        case Symbol::RParen: return input == ')';
+        case Symbol::Digit:  return std::isdigit(input);
+        default:             return false;
+    }
+}
+
+/* Classifies each character with a single switch instead of trying every terminal */
+struct CharClassifier {
+    earley::SymbolSet<Symbol> operator()(char input) const
+    {
+        earley::SymbolSet<Symbol> terminals;
+        switch(input) {
+            case '+': terminals.set(Symbol::Plus); break;
+            case '*': terminals.set(Symbol::Times); break;
+            case '-': terminals.set(Symbol::Minus); break;
+            case '(': terminals.set(Symbol::LParen); break;
+            case ')': terminals.set(Symbol::RParen); break;
+            default:
+                if(std::isdigit(input)) {
+                    terminals.set(Symbol::Digit);
+                }
+                break;
+        }
+        return terminals;
+    }
+};
+
+int main()
+{
+    using enum Symbol;
+    static const earley::Rule<Symbol> rules[] = {
+        { Expr,   { Expr, Plus, Term } },
+        { Expr,   { Term } },
+        { Term,   { Term, Times, Factor } },
+        { Term,   { Factor } },
+        { Factor, { LParen, Expr, RParen } },
+        { Factor, { Sign, Digit } },
+        { Sign,   { Minus } },
+        { Sign,   {} }
+    };
+    constexpr auto start_symbol = Expr;
+    std::span<const earley::Rule<Symbol>> rules_view = rules;
+    earley::RuleSet rule_set{rules_view};
+
+    // FIRST and FOLLOW sets
+    assert(rule_set.terminals.size() == 6);
+    assert(rule_set.first_set(Sign).test(Minus) && !rule_set.first_set(Sign).test(Digit));
+    assert(rule_set.first_set(Expr).test(LParen) && rule_set.first_set(Expr).test(Minus)
+           && rule_set.first_set(Expr).test(Digit) && !rule_set.first_set(Expr).test(Plus));
+    assert(rule_set.follow_set(Sign).test(Digit) && !rule_set.follow_set(Sign).test(Plus));
+    assert(rule_set.follow_set(Factor).test(Times) && rule_set.follow_set(Factor).test(Plus)
+           && rule_set.follow_set(Factor).test(RParen) && !rule_set.follow_set(Factor).test(Digit));
+    // Sign -> . can only be followed by a digit
+    assert(rule_set.lookahead_set(earley::EarleyItem{7, 0, 0}).test(Digit));
+    assert(!rule_set.lookahead_set(earley::EarleyItem{7, 0, 0}).test(LParen));
+
+    // Lookahead never changes whether the input can be parsed
+    for(std::string input : {"1+2*3", "(1+-2)*3*(4)", "((((5))))", "1+", "1+*2", "-(1)", "", "7"}) {
+        auto state_sets = earley::parse<char>(rule_set, start_symbol, 100'000, input);
+        auto lookahead_state_sets = earley::parse<char>(rule_set, start_symbol, 100'000, input, earley::lookahead);
+        auto classified_state_sets = earley::parse<char>(rule_set, start_symbol, 100'000, input,
+                                                         earley::Lookahead<CharClassifier>{});
+        assert(lookahead_state_sets.num_of_items() <= state_sets.num_of_items());
+        assert(classified_state_sets.num_of_items() == lookahead_state_sets.num_of_items());
+        auto full_parse = earley::find_full_parse(rules_view, start_symbol, state_sets, input);
+        auto lookahead_full_parse = earley::find_full_parse(rules_view, start_symbol, lookahead_state_sets, input);
+        assert((bool)full_parse == (bool)lookahead_full_parse);
+        if(full_parse) {
+            assert(*full_parse.item == *lookahead_full_parse.item);
+        }
+    }
+
+    // Classifying each token once with a TerminalTable gives the same state sets as matching each terminal
+    earley::TerminalTable terminal_table{rule_set};
+    assert(terminal_table('7').test(Digit) && !terminal_table('7').test(Plus));
+    assert(!terminal_table('x').intersects(rule_set.first_set(Expr)) && !terminal_table('x').test(RParen));
+    for(std::string input : {"1+2*3", "(1+-2)*3*(4)", "1+*2", "", "-(1)"}) {
+        auto state_sets = earley::parse<char>(rule_set, start_symbol, 100'000, input);
+        auto classified_state_sets = earley::parse<char>(rule_set, start_symbol, 100'000, input,
+                                                         earley::ClassifyTokens{terminal_table});
+        assert(state_sets.size() == classified_state_sets.size());
+        assert(std::ranges::equal(state_sets, classified_state_sets, [](auto set_a, auto set_b) {
+            return std::ranges::equal(set_a, set_b);
+        }));
+        auto lookahead_state_sets = earley::parse<char>(rule_set, start_symbol, 100'000, input, earley::lookahead);
+        auto table_lookahead_state_sets = earley::parse<char>(rule_set, start_symbol, 100'000, input,
+                                                              earley::Lookahead{terminal_table});
+        assert(table_lookahead_state_sets.num_of_items() == lookahead_state_sets.num_of_items());
+    }
+
+    // Most predicted items cannot match the next token
+    std::string input = "1";
+    for(int i = 0; i < 200; ++i) {
+        input += "+(2*-3)";
+    }
+    auto state_sets = earley::parse<char>(rule_set, start_symbol, 1'000'000, input);
+    auto lookahead_state_sets = earley::parse<char>(rule_set, start_symbol, 1'000'000, input, earley::lookahead);
+    std::cout << "Items without lookahead: " << state_sets.num_of_items() << "\n";
+    std::cout << "Items with lookahead: " << lookahead_state_sets.num_of_items() << "\n";
+    assert(lookahead_state_sets.num_of_items() < state_sets.num_of_items() * 9 / 10);
+    assert(earley::find_full_parse(rules_view, start_symbol, lookahead_state_sets, input));
+
+    // Lookahead can be combined with Leo items
+    SpanList<earley::LeoItem> leo_items{1'000'000};
+    auto leo_state_sets = earley::parse<char>(rule_set, start_symbol, 1'000'000, input, leo_items, earley::lookahead);
+    assert(earley::find_full_parse(rules_view, start_symbol, leo_state_sets, input));
+
+    return 0;
+}
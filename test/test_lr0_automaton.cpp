@@ -0,0 +1,132 @@
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include "earley.hpp"
+#include "static_rule_set.hpp"
+#include "lr0_automaton.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Mult, LParen, RParen, Digit, A,
+    /* Nonterminals */
+    Sum, Product, Factor, Number, S, T, N, B, E,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::A; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    using enum Symbol;
+    switch(terminal) {
+        case Plus:   return input == '+';
+        case Mult:   return input == '*';
+        case LParen: return input == '(';
+        case RParen: return input == ')';
+        case Digit:  return std::isdigit(input);
+        case A:      return input == 'a';
+        default:     return false;
+    }
+}
+
+using Rule = earley::Rule<Symbol>;
+
+static
+std::vector<earley::EarleyItem> sorted(std::span<const earley::EarleyItem> state_set)
+{
+    std::vector<earley::EarleyItem> items{state_set.begin(), state_set.end()};
+    std::ranges::sort(items, {}, [](earley::EarleyItem item) { return std::tuple{item.rule_idx, item.progress, item.start_pos}; });
+    return items;
+}
+
+/* Checks that the LR(0) recognizer finds the same items and matches as parse */
+static
+void check_grammar(std::span<const Rule> rules, Symbol start_symbol, std::span<const std::string_view> inputs)
+{
+    earley::RuleSet rule_set{rules};
+    earley::Lr0Automaton automaton{rule_set, start_symbol};
+    assert(automaton.state_count() > 0);
+    for(auto input : inputs) {
+        auto state_sets = earley::parse<char>(rule_set, start_symbol, 100, input);
+        auto lr0_state_sets = earley::parse<char>(automaton, 100, input);
+        auto translated_state_sets = earley::to_earley_items(automaton, lr0_state_sets);
+        assert(translated_state_sets.size() == state_sets.size());
+        for(size_t set_pos = 0; set_pos < state_sets.size(); ++set_pos) {
+            assert(sorted(translated_state_sets[set_pos]) == sorted(state_sets[set_pos]));
+        }
+        assert(lr0_state_sets.num_of_items() <= state_sets.num_of_items());
+
+        bool is_match = (bool)earley::find_full_parse(rules, start_symbol, state_sets, input);
+        assert(earley::accepts(automaton, lr0_state_sets, input.size()) == is_match);
+        assert((bool)earley::find_full_parse(rules, start_symbol, translated_state_sets, input) == is_match);
+    }
+}
+
+int main()
+{
+    using enum Symbol;
+    static const Rule expression_rules[] = {
+        { Sum,     { Sum, Plus, Product } },
+        { Sum,     { Product } },
+        { Product, { Product, Mult, Factor } },
+        { Product, { Factor } },
+        { Factor,  { LParen, Sum, RParen } },
+        { Factor,  { Number } },
+        { Number,  { Digit } },
+        { Number,  { Digit, Number } }
+    };
+    static constexpr std::string_view expression_inputs[] = {"1+(8*9)", "12*(3+4)*56", "1+", "", "(((1)))", "1+2)"};
+    check_grammar(expression_rules, Sum, expression_inputs);
+
+    static const Rule nullable_rules[] = {
+        { S, { S, T } },
+        { S, { T } },
+        { T, { N, N, A, N } },
+        { N, {} },
+        { N, { B } },
+        { B, {} },
+        { B, { Plus } }
+    };
+    static constexpr std::string_view nullable_inputs[] = {"a", "+a+", "aaa", "+a++a", "++a", "", "+"};
+    check_grammar(nullable_rules, S, nullable_inputs);
+
+    static const Rule ambiguous_rules[] = {
+        { S, { S, S } },
+        { S, { A } }
+    };
+    static constexpr std::string_view ambiguous_inputs[] = {"a", "aaaaaaa", "", "ab"};
+    check_grammar(ambiguous_rules, S, ambiguous_inputs);
+
+    // Nullable and cyclic, with an empty start rule
+    static const Rule cyclic_rules[] = {
+        { S, {} },
+        { S, { E } },
+        { S, { S, A } },
+        { E, { S } }
+    };
+    static constexpr std::string_view cyclic_inputs[] = {"", "a", "aaaa", "+"};
+    check_grammar(cyclic_rules, S, cyclic_inputs);
+
+    // The automaton can also be built from a StaticRuleSet
+    static constexpr auto static_rule_set = earley::make_static_rule_set([] {
+        return std::vector<Rule>{
+            { Number, { Digit, Number } },
+            { Number, { Digit } }
+        };
+    });
+    earley::Lr0Automaton automaton{static_rule_set, Number};
+    std::string input(100, '7');
+    auto lr0_state_sets = earley::parse<char>(automaton, 100, input);
+    assert(earley::accepts(automaton, lr0_state_sets, input.size()));
+    assert(!earley::accepts(automaton, lr0_state_sets, 0));
+    assert(lr0_state_sets.num_of_items() < earley::parse<char>(static_rule_set, Number, 100, input).num_of_items());
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <cstdint>
+#include <cctype>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+#include <cassert>
+#include "earley.hpp"
+#include "mapped_file.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Digit,
+    /* Nonterminals */
+    Number, Sum,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::Digit; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    switch(terminal) {
+        case Symbol::Plus:  return input == '+';
+        case Symbol::Digit: return std::isdigit(input);
+        default:            return false;
+    }
+}
+
+static
+void write_file(const std::filesystem::path& path, std::string_view contents)
+{
+    std::ofstream file{path, std::ios::binary};
+    file << contents;
+}
+
+int main()
+{
+    using enum Symbol;
+    static const earley::Rule<Symbol> rules[] = {
+        { Sum,    { Sum, Plus, Number } },
+        { Sum,    { Number } },
+        { Number, { Digit } },
+        { Number, { Digit, Number } }
+    };
+    constexpr auto start_symbol = Sum;
+    std::span<const earley::Rule<Symbol>> rules_view = rules;
+    earley::RuleSet rule_set{rules_view};
+
+    auto path = std::filesystem::temp_directory_path() / "libearley_test_mapped_file.txt";
+    // Several pages, with a size that is not a multiple of the window size
+    std::string contents = "1";
+    while(contents.size() < 100'000) {
+        contents += "+" + std::to_string(contents.size());
+    }
+    write_file(path, contents);
+
+    {
+        MappedFile file{path.c_str()};
+        assert(file.size() == contents.size());
+        assert(file.view() == contents);
+        assert(std::string_view(file.begin(), file.end()) == contents);
+
+        // The input can be parsed in place
+        auto state_sets = earley::parse<char>(rule_set, start_symbol, 1024, file.contents());
+        assert(earley::find_full_parse(rules_view, start_symbol, state_sets, file.contents()));
+
+        // The windows cover the contents in order, and can be streamed into a Recognizer
+        for(size_t window_size : {1ul, 4095ul, 4096ul, 10'000ul, contents.size(), 2 * contents.size()}) {
+            std::string windows;
+            earley::Recognizer recognizer{rule_set, start_symbol, 1024};
+            file.for_each_window(window_size, [&](std::span<const char> window) {
+                assert(!window.empty() && window.size() <= window_size);
+                windows.append(window.begin(), window.end());
+                return recognizer.feed(window);
+            });
+            assert(windows == contents);
+            assert(recognizer.finish().num_of_items() == state_sets.num_of_items());
+        }
+        // Released windows can still be read
+        assert(file.view() == contents);
+
+        // Returning false stops at that window
+        size_t window_count = 0;
+        file.for_each_window(4096, [&](std::span<const char>) { return ++window_count < 3; });
+        assert(window_count == 3);
+
+        // Windows must not be empty
+        bool was_thrown = false;
+        try {
+            file.for_each_window(0, [](std::span<const char>) { return true; });
+        } catch(const std::invalid_argument&) {
+            was_thrown = true;
+        }
+        assert(was_thrown);
+
+        MappedFile moved_file{std::move(file)};
+        assert(moved_file.view() == contents && file.size() == 0);
+    }
+
+    // An empty file has no contents and no windows
+    write_file(path, "");
+    {
+        MappedFile file{path.c_str()};
+        assert(file.size() == 0 && file.contents().empty());
+        file.for_each_window(4096, [](std::span<const char>) {
+            assert(false);
+            return true;
+        });
+    }
+    std::filesystem::remove(path);
+
+    bool was_thrown = false;
+    try {
+        MappedFile file{path.c_str()};
+    } catch(const std::runtime_error&) {
+        was_thrown = true;
+    }
+    assert(was_thrown);
+
+    return 0;
+}
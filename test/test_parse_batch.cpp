@@ -0,0 +1,119 @@
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+#include <algorithm>
+#include <cassert>
+#include "earley.hpp"
+#include "static_rule_set.hpp"
+#include "parse_batch.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Digit,
+    /* Nonterminals */
+    Number, Sum,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::Digit; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    switch(terminal) {
+        case Symbol::Plus:  return input == '+';
+        case Symbol::Digit: return input >= '0' && input <= '9';
+        default:            return false;
+    }
+}
+
+static constexpr auto make_rules = [] {
+    using enum Symbol;
+    return std::vector<earley::Rule<Symbol>>{
+        { Sum,    { Sum, Plus, Number } },
+        { Sum,    { Number } },
+        { Number, { Digit } },
+        { Number, { Digit, Number } }
+    };
+};
+
+int main()
+{
+    constexpr auto start_symbol = Symbol::Sum;
+    auto rules = make_rules();
+    std::span<const earley::Rule<Symbol>> rules_view = rules;
+    earley::RuleSet rule_set{rules_view};
+
+    std::vector<std::string> inputs;
+    for(int i = 0; i < 200; ++i) {
+        std::string input = std::to_string(i);
+        for(int j = 0; j < i % 17; ++j) {
+            input += "+" + std::to_string(j * i);
+        }
+        if(i % 5 == 0) {
+            input += "+";
+        } else if(i % 7 == 0) {
+            input.clear();
+        }
+        inputs.push_back(input);
+    }
+    std::vector<bool> expected;
+    for(const auto& input : inputs) {
+        expected.push_back((bool)earley::find_full_parse(rules_view, start_symbol,
+                                                         earley::parse<char>(rule_set, start_symbol, 16, input), input));
+    }
+    assert(std::ranges::count(expected, true) > 0 && std::ranges::count(expected, false) > 0);
+
+    // Every thread count gives the same results, with the rule set shared by all threads
+    for(size_t thread_count : {0, 1, 2, 3, 8, 300}) {
+        assert(earley::parse_batch<char>(rule_set, start_symbol, inputs, thread_count) == expected);
+    }
+    static constexpr auto static_rule_set = earley::make_static_rule_set(make_rules);
+    assert(earley::parse_batch<char>(static_rule_set, start_symbol, inputs, 4) == expected);
+    // Keeping each thread's state sets on its own NUMA node and huge pages does not change the output
+    BigArrayOptions local_options{.huge_pages = BigArrayOptions::HugePages::Advise,
+                                  .numa_node = BigArrayOptions::current_node};
+    assert(earley::parse_batch<char>(rule_set, start_symbol, inputs, 4, local_options) == expected);
+    assert(earley::parse_batch<char>(rule_set, start_symbol, std::vector<std::string>{}, 4).empty());
+
+    // The callback gets the same state sets as parse, once per input
+    std::vector<size_t> item_counts(inputs.size());
+    std::atomic<size_t> call_count = 0;
+    earley::parse_batch<char>(rule_set, start_symbol, inputs, [&](size_t index, const SpanList<earley::EarleyItem>& state_sets) {
+        item_counts[index] = state_sets.num_of_items();
+        ++call_count;
+    }, 4);
+    assert(call_count == inputs.size());
+    for(size_t i = 0; i < inputs.size(); ++i) {
+        assert(item_counts[i] == earley::parse<char>(rule_set, start_symbol, 16, inputs[i]).num_of_items());
+    }
+
+    // An exception thrown by the callback stops the batch and is rethrown
+    bool was_thrown = false;
+    try {
+        earley::parse_batch<char>(rule_set, start_symbol, inputs, [](size_t index, const auto&) {
+            if(index == 10) {
+                throw std::runtime_error("callback failed");
+            }
+        }, 4);
+    } catch(const std::runtime_error&) {
+        was_thrown = true;
+    }
+    assert(was_thrown);
+
+    // So is an exception thrown while creating a thread's Parser
+    was_thrown = false;
+    try {
+        earley::parse_batch<char>(rule_set, start_symbol, inputs, 4, BigArrayOptions{.numa_node = -5});
+    } catch(const std::runtime_error&) {
+        was_thrown = true;
+    }
+    assert(was_thrown);
+
+    return 0;
+}
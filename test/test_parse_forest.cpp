@@ -0,0 +1,171 @@
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <cassert>
+#include "parse_forest.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Digit, A,
+    /* Nonterminals */
+    Sum, Number, S, T, N, B,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::A; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    switch(terminal) {
+        case Symbol::Plus:  return input == '+';
+        case Symbol::Digit: return std::isdigit(input);
+        case Symbol::A:     return input == 'a';
+        default:            return false;
+    }
+}
+
+using Forest = earley::ParseForest<Symbol>;
+
+/* Returns the number of parse trees of node (memoized in tree_counts) */
+static
+uint64_t count_trees(const Forest& forest, earley::ForestNodeId node, std::vector<uint64_t>& tree_counts)
+{
+    if(node == earley::no_forest_node || forest[node].is_terminal()) {
+        return 1;
+    }
+    if(tree_counts[node] == 0) {
+        uint64_t count = 0;
+        forest.for_each_derivation(node, [&](const earley::ForestDerivation& derivation) {
+            count += count_trees(forest, derivation.left, tree_counts) * count_trees(forest, derivation.right, tree_counts);
+        });
+        tree_counts[node] = count;
+    }
+    return tree_counts[node];
+}
+
+static
+uint64_t count_trees(const Forest& forest, earley::ForestNodeId root)
+{
+    std::vector<uint64_t> tree_counts(forest.num_of_nodes());
+    return count_trees(forest, root, tree_counts);
+}
+
+/* Appends the terminals of the (only) parse tree of node, in order */
+static
+void collect_terminals(const Forest& forest, earley::ForestNodeId node, std::vector<earley::ForestNode>& terminals)
+{
+    if(node == earley::no_forest_node) {
+        return;
+    }
+    if(forest[node].is_terminal()) {
+        terminals.push_back(forest[node]);
+        return;
+    }
+    assert(!forest.is_ambiguous(node));
+    forest.for_each_derivation(node, [&](const earley::ForestDerivation& derivation) {
+        collect_terminals(forest, derivation.left, terminals);
+        collect_terminals(forest, derivation.right, terminals);
+    });
+}
+
+int main()
+{
+    using enum Symbol;
+
+    // Ambiguity is packed: S -> S S has Catalan(n - 1) parses of n 'a's, but only O(n^2) symbol nodes
+    {
+        static const earley::Rule<Symbol> rules[] = {
+            { S, { S, S } },
+            { S, { A } }
+        };
+        std::span<const earley::Rule<Symbol>> rules_view = rules;
+        earley::RuleSet rule_set{rules_view};
+        const uint64_t catalan[] = {1, 1, 2, 5, 14, 42, 132, 429, 1430, 4862};
+        for(size_t size = 1; size <= 10; ++size) {
+            std::string input(size, 'a');
+            Forest forest;
+            auto state_sets = earley::parse<char>(rule_set, S, 100, input, forest);
+            assert(earley::find_full_parse(rules_view, S, state_sets, input));
+            auto root = forest.find_symbol_node(S, 0, size);
+            assert(root != earley::no_forest_node);
+            assert(count_trees(forest, root) == catalan[size - 1]);
+            assert(forest.is_ambiguous(root) == (size >= 3));
+            // Each span of 2 or more 'a's has one derivation per split, and each 'a' has one
+            assert(forest.num_of_derivations() == size + (size + 1) * size * (size - 1) / 6);
+        }
+        Forest forest;
+        std::string bad_input = "aab";
+        earley::parse<char>(rule_set, S, 100, bad_input, forest);
+        assert(forest.find_symbol_node(S, 0, bad_input.size()) == earley::no_forest_node);
+    }
+
+    // Every way of deriving the nullable symbols gets a derivation
+    {
+        static const earley::Rule<Symbol> rules[] = {
+            { S, { S, T } },
+            { S, { T } },
+            { T, { N, N, A, N } },
+            { N, {} },
+            { N, { B } },
+            { B, {} },
+            { B, { Plus } }
+        };
+        std::span<const earley::Rule<Symbol>> rules_view = rules;
+        earley::RuleSet rule_set{rules_view};
+        Forest forest;
+        std::string input = "a";
+        earley::parse<char>(rule_set, S, 100, input, forest);
+        auto root = forest.find_symbol_node(S, 0, 1);
+        assert(root != earley::no_forest_node);
+        // Each of the 3 N's is either empty or an empty B
+        assert(count_trees(forest, root) == 8);
+
+        Forest plus_forest;
+        std::string plus_input = "+a+a";
+        earley::parse<char>(rule_set, S, 100, plus_input, plus_forest);
+        root = plus_forest.find_symbol_node(S, 0, 4);
+        assert(root != earley::no_forest_node);
+        // A T for "+a" has the '+' in one of its first 2 N's (8 trees); the second '+' is either the
+        //  start of a second such T or the last N of the first T (4 trees, followed by 8 trees for "a")
+        assert(count_trees(plus_forest, root) == 8 * 8 + 4 * 8);
+    }
+
+    // Unambiguous input has exactly one tree, with the correct Number items
+    {
+        static const earley::Rule<Symbol> rules[] = {
+            { Sum,    { Sum, Plus, Number } },
+            { Sum,    { Number } },
+            { Number, { Digit } },
+            { Number, { Digit, Number } }
+        };
+        std::span<const earley::Rule<Symbol>> rules_view = rules;
+        earley::RuleSet rule_set{rules_view};
+        Forest forest;
+        std::string input = "12+345+6";
+        earley::parse<char>(rule_set, Sum, 100, input, forest);
+        auto root = forest.find_symbol_node(Sum, 0, input.size());
+        assert(root != earley::no_forest_node);
+        assert(count_trees(forest, root) == 1);
+        std::vector<earley::ForestNode> terminals;
+        collect_terminals(forest, root, terminals);
+        assert(terminals.size() == input.size());
+        for(uint32_t i = 0; i < terminals.size(); ++i) {
+            assert(terminals[i].start_pos == i && terminals[i].end_pos == i + 1);
+            assert((Symbol)terminals[i].id == (input[i] == '+' ? Plus : Digit));
+        }
+        // The Number for "345" is "3" followed by the Number for "45"
+        auto number = forest.find_symbol_node(Number, 3, 6);
+        assert(number != earley::no_forest_node);
+        forest.for_each_derivation(number, [&](const earley::ForestDerivation& derivation) {
+            assert(derivation.rule_idx == 3);
+            assert(forest[derivation.left].is_terminal() && forest[derivation.left].start_pos == 3);
+            assert(derivation.right == forest.find_symbol_node(Number, 4, 6));
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include "earley.hpp"
+#include "earley_print.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Digit,
+    /* Nonterminals */
+    Number, Sum, Sign,
+
+    Symbol_Count
+};
+
+static
+std::ostream& operator<<(std::ostream& out, Symbol s)
+{
+    switch(s) {
+        case Symbol::Plus:   return out << "+";
+        case Symbol::Digit:  return out << "Digit";
+        case Symbol::Number: return out << "Number";
+        case Symbol::Sum:    return out << "Sum";
+        case Symbol::Sign:   return out << "Sign";
+        default:             return out;
+    }
+}
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::Digit; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    switch(terminal) {
+        case Symbol::Plus:  return input == '+';
+        case Symbol::Digit: return std::isdigit(input);
+        default:            return false;
+    }
+}
+
+static
+bool same_state_sets(const SpanList<earley::EarleyItem>& a, const SpanList<earley::EarleyItem>& b)
+{
+    return a.size() == b.size() && std::ranges::equal(a, b, [](auto set_a, auto set_b) {
+        return std::ranges::equal(set_a, set_b);
+    });
+}
+
+int main()
+{
+    using enum Symbol;
+    static const earley::Rule<Symbol> rules[] = {
+        { Sum,    { Sum, Plus, Number } },
+        { Sum,    { Sign, Number } },
+        { Number, { Digit } },
+        { Number, { Digit, Number } },
+        { Sign,   {} },
+        { Sign,   { Plus } }
+    };
+    constexpr auto start_symbol = Sum;
+    std::span<const earley::Rule<Symbol>> rules_view = rules;
+    earley::RuleSet rule_set{rules_view};
+
+    for(const std::string& input : std::vector<std::string>{"1+2", "+34+5+678", "", "1++", std::string(300, '4') + "+1"}) {
+        earley::ParseStats stats{true};
+        auto state_sets = earley::parse<char>(rule_set, start_symbol, 16, input, stats);
+        // Counting does not change the output
+        assert(same_state_sets(state_sets, earley::parse<char>(rule_set, start_symbol, 16, input)));
+
+        // Every processed state set was counted (the last state set is never processed)
+        assert(stats.state_sets == state_sets.size() - 1);
+        uint64_t histogram_total = 0;
+        for(auto count : stats.state_set_size_histogram) {
+            histogram_total += count;
+        }
+        assert(histogram_total == stats.state_sets);
+        uint64_t max_set_size = 0;
+        for(auto state_set : state_sets) {
+            max_set_size = std::max<uint64_t>(max_set_size, state_set.size());
+        }
+        assert(stats.max_state_set_size == max_set_size);
+        assert(stats.peak_items == state_sets.num_of_items());
+        assert(stats.peak_bytes_committed >= stats.peak_items * sizeof(earley::EarleyItem));
+        assert(stats.peak_bytes_committed < stats.peak_items * sizeof(earley::EarleyItem) + (1 << 21));
+
+        // The items of each rule add up to the items of the state sets
+        assert(stats.rule_counts.size() == std::size(rules));
+        uint64_t rule_items = 0;
+        uint64_t rule_duplicates = 0;
+        for(const auto& counts : stats.rule_counts) {
+            rule_items += counts.items;
+            rule_duplicates += counts.duplicates;
+        }
+        assert(rule_items == state_sets.num_of_items());
+        assert(rule_duplicates == stats.duplicates);
+        // Every item in a state set after the first one that was not scanned was added by prediction,
+        //  completion or advancing over a nullable symbol
+        uint64_t scanned_items = 0;
+        for(size_t set_pos = 1; set_pos < state_sets.size(); ++set_pos) {
+            for(auto item : state_sets[set_pos]) {
+                scanned_items += item.start_pos < set_pos && item.progress > 0
+                                 && rules[item.rule_idx].components[item.progress - 1] <= Digit;
+            }
+        }
+        assert(stats.scans == scanned_items);
+        assert(stats.predictions + stats.completions + stats.nullable_advances + stats.scans
+               >= rule_items - std::ranges::distance(rule_set[start_symbol]));
+        if(!input.empty()) {
+            assert(stats.predictions > 0 && stats.completions > 0 && stats.nullable_advances > 0);
+        }
+
+        // Without count_rules, only the totals are counted, and the same as with it
+        earley::ParseStats totals;
+        earley::Parser<Symbol> parser;
+        parser.parse<char>(rule_set, start_symbol, input, totals);
+        assert(totals.rule_counts.empty());
+        assert(totals.completions == stats.completions && totals.duplicates == stats.duplicates);
+
+        // Counts add up over parses until they are reset
+        earley::parse<char>(rule_set, start_symbol, 16, input, stats);
+        assert(stats.state_sets == 2 * (state_sets.size() - 1));
+        assert(stats.rule_counts.size() == std::size(rules));
+        stats.reset();
+        assert(stats.state_sets == 0 && stats.rule_counts.empty() && stats.count_rules);
+    }
+
+    // The lookahead and Leo overloads count too
+    std::string input = "12+3+45";
+    earley::ParseStats stats;
+    earley::ParseStats lookahead_stats;
+    earley::ParseStats leo_stats;
+    earley::parse<char>(rule_set, start_symbol, 16, input, stats);
+    earley::parse<char>(rule_set, start_symbol, 16, input, earley::lookahead, lookahead_stats);
+    SpanList<earley::LeoItem> leo_items{16};
+    earley::parse<char>(rule_set, start_symbol, 16, input, leo_items, leo_stats);
+    assert(lookahead_stats.predictions < stats.predictions);
+    assert(leo_stats.state_sets == stats.state_sets && leo_stats.peak_items <= stats.peak_items);
+
+    // Completing on several threads counts the same work as on one thread
+    {
+        static const earley::Rule<Symbol> ambiguous_rules[] = {
+            { Number, { Number, Number } },
+            { Number, { Digit } }
+        };
+        earley::RuleSet ambiguous_rule_set{std::span<const earley::Rule<Symbol>>{ambiguous_rules}};
+        std::string digits(80, '1');
+        earley::ParseStats serial_stats{true};
+        earley::ParseStats parallel_stats{true};
+        earley::Parser<Symbol> serial_parser;
+        earley::Parser<Symbol> parallel_parser;
+        parallel_parser.set_completion_threads(4);
+        serial_parser.parse<char>(ambiguous_rule_set, Number, digits, serial_stats);
+        parallel_parser.parse<char>(ambiguous_rule_set, Number, digits, parallel_stats);
+        assert(serial_stats.duplicates > 0);
+        std::vector<uint64_t> serial_counts;
+        serial_stats.for_each_counter([&](std::string_view, uint64_t value) { serial_counts.push_back(value); });
+        size_t counter = 0;
+        parallel_stats.for_each_counter([&](std::string_view, uint64_t value) { assert(value == serial_counts[counter++]); });
+        assert(serial_stats.state_set_size_histogram == parallel_stats.state_set_size_histogram);
+        assert(std::ranges::equal(serial_stats.rule_counts, parallel_stats.rule_counts, [](const auto& a, const auto& b) {
+            return a.items == b.items && a.duplicates == b.duplicates && a.completions == b.completions;
+        }));
+    }
+
+    earley::ParseStats rule_stats{true};
+    earley::parse<char>(rule_set, start_symbol, 16, input, rule_stats);
+    std::ostringstream out;
+    earley::print_stats(out, rules_view, rule_stats, 3);
+    std::cout << out.str();
+    assert(out.str().find("completions: ") != std::string::npos);
+    assert(std::ranges::count(out.str(), '\n') == 10 + 3);
+
+    std::size_t counter_count = 0;
+    rule_stats.for_each_counter([&](std::string_view name, uint64_t) {
+        assert(!name.empty());
+        ++counter_count;
+    });
+    assert(counter_count == 9);
+
+    return 0;
+}
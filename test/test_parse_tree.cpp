@@ -0,0 +1,188 @@
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <cassert>
+#include "earley.hpp"
+#include "parse_tree.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Mult, LParen, RParen, Digit, X,
+    /* Nonterminals */
+    Number, Sum, Product, Factor, A, B, S,
+
+    Symbol_Count
+};
+
+static
+std::string_view symbol_name(Symbol s)
+{
+    switch(s) {
+        case Symbol::Number:  return "Number";
+        case Symbol::Sum:     return "Sum";
+        case Symbol::Product: return "Product";
+        case Symbol::Factor:  return "Factor";
+        case Symbol::A:       return "A";
+        case Symbol::B:       return "B";
+        case Symbol::S:       return "S";
+        default:              return "?";
+    }
+}
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::X; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    switch(terminal) {
+        case Symbol::Plus:   return input == '+';
+        case Symbol::Mult:   return input == '*';
+        case Symbol::LParen: return input == '(';
+        case Symbol::RParen: return input == ')';
+        case Symbol::Digit:  return std::isdigit(input);
+        case Symbol::X:      return input == 'x';
+        default:             return false;
+    }
+}
+
+/* Walks the full parse of input as symbol, as a bracketed string, checking that the events are
+   nested and left to right */
+static
+std::string walk(std::span<const earley::Rule<Symbol>> rules, Symbol symbol, std::string_view input)
+{
+    earley::RuleSet rule_set{rules};
+    auto state_sets = earley::parse<char>(rule_set, symbol, 16, input);
+    auto full_parse = earley::find_full_parse(rules, symbol, state_sets, input);
+    assert(full_parse);
+    earley::ParseTreeWalker walker{rules, state_sets, full_parse};
+
+    std::string tree;
+    std::vector<size_t> open_starts;
+    size_t next_token = 0;
+    for(const auto& event : walker) {
+        switch(event.kind) {
+            case earley::TreeEventKind::Enter:
+                assert(event.start_pos == next_token && rules[event.rule_idx].symbol == event.symbol);
+                open_starts.push_back(event.start_pos);
+                assert(walker.depth() == open_starts.size());
+                tree += " (";
+                tree += symbol_name(event.symbol);
+                break;
+            case earley::TreeEventKind::Terminal:
+                assert(event.start_pos == next_token && event.end_pos == next_token + 1);
+                assert(matches_terminal(event.symbol, input[event.start_pos]));
+                ++next_token;
+                tree += ' ';
+                tree += input[event.start_pos];
+                break;
+            case earley::TreeEventKind::Exit:
+                assert(!open_starts.empty() && open_starts.back() == event.start_pos && event.end_pos == next_token);
+                open_starts.pop_back();
+                tree += ')';
+                break;
+        }
+    }
+    assert(open_starts.empty() && walker.depth() == 0 && next_token == input.size());
+    return tree.substr(1);
+}
+
+int main()
+{
+    using enum Symbol;
+    static const earley::Rule<Symbol> rules[] = {
+        { Sum,     { Sum, Plus, Product } },
+        { Sum,     { Product } },
+        { Product, { Product, Mult, Factor } },
+        { Product, { Factor } },
+        { Factor,  { LParen, Sum, RParen } },
+        { Factor,  { Number } },
+        { Number,  { Digit, Number } },
+        { Number,  { Digit } }
+    };
+    std::span<const earley::Rule<Symbol>> rules_view = rules;
+
+    // The children of right-recursive rules start where they have to
+    assert(walk(rules_view, Number, "11") == "(Number 1 (Number 1))");
+    assert(walk(rules_view, Sum, "1+2*3")
+           == "(Sum (Sum (Product (Factor (Number 1)))) + (Product (Product (Factor (Number 2))) * (Factor (Number 3))))");
+    assert(walk(rules_view, Sum, "(12)")
+           == "(Sum (Product (Factor ( (Sum (Product (Factor (Number 1 (Number 2))))) ))))");
+
+    // Deep trees are walked without recursion
+    {
+        std::string input = "1";
+        for(int i = 0; i < 100'000; ++i) {
+            input += "+1";
+        }
+        earley::RuleSet rule_set{rules_view};
+        auto state_sets = earley::parse<char>(rule_set, Sum, 16, input);
+        earley::ParseTreeWalker walker{rules_view, state_sets, earley::find_full_parse(rules_view, Sum, state_sets, input)};
+        size_t terminal_count = 0;
+        size_t max_depth = 0;
+        while(auto event = walker.next()) {
+            terminal_count += event->kind == earley::TreeEventKind::Terminal;
+            max_depth = std::max(max_depth, walker.depth());
+        }
+        // The innermost Sum holds the first digit's Product, Factor and Number
+        assert(terminal_count == input.size() && max_depth == 100'001 + 3);
+    }
+
+    // Walks can stop early
+    {
+        std::string_view input = "1+2+3";
+        earley::RuleSet rule_set{rules_view};
+        auto state_sets = earley::parse<char>(rule_set, Sum, 16, input);
+        earley::ParseTreeWalker walker{rules_view, state_sets, earley::find_full_parse(rules_view, Sum, state_sets, input)};
+        size_t event_count = 0;
+        for(const auto& event : walker) {
+            ++event_count;
+            if(event.kind == earley::TreeEventKind::Terminal) {
+                assert(event.start_pos == 0);
+                break;
+            }
+        }
+        // Sum, Sum, Sum, Product, Factor, Number, then the first digit
+        assert(event_count == 7);
+        assert(walker.next()->kind == earley::TreeEventKind::Exit);
+    }
+
+    // Failed parses have empty walks
+    {
+        std::string_view input = "1+";
+        earley::RuleSet rule_set{rules_view};
+        auto state_sets = earley::parse<char>(rule_set, Sum, 16, input);
+        earley::ParseTreeWalker walker{rules_view, state_sets, earley::find_full_parse(rules_view, Sum, state_sets, input)};
+        assert(!walker.next());
+    }
+
+    // Cyclic grammars have finite walks
+    static const earley::Rule<Symbol> cyclic_rules[] = {
+        { S, { S } },
+        { S, { A, X } },
+        { A, {} },
+        { A, { B } },
+        { B, { A } }
+    };
+    std::span<const earley::Rule<Symbol>> cyclic_view = cyclic_rules;
+    std::string tree = walk(cyclic_view, S, "x");
+    assert(tree.ends_with(" (A) x)") || tree.ends_with(" (A (B (A))) x)"));
+    std::cout << tree << "\n";
+
+    // A child that fits the prefix before it but can only be derived through its parent is passed over
+    //  for one that can be derived without it
+    static const earley::Rule<Symbol> nullable_cycle_rules[] = {
+        { S, { S, A } },
+        { S, {} },
+        { A, { S, X, S } },
+        { A, {} }
+    };
+    assert(walk(nullable_cycle_rules, S, "x") == "(S (S) (A (S) x (S)))");
+
+    return 0;
+}
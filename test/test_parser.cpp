@@ -0,0 +1,116 @@
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include "earley.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Digit,
+    /* Nonterminals */
+    Number, Sum,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::Digit; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    switch(terminal) {
+        case Symbol::Plus:  return input == '+';
+        case Symbol::Digit: return std::isdigit(input);
+        default:            return false;
+    }
+}
+
+static
+bool same_state_sets(const SpanList<earley::EarleyItem>& a, const SpanList<earley::EarleyItem>& b)
+{
+    return a.size() == b.size() && std::ranges::equal(a, b, [](auto set_a, auto set_b) {
+        return std::ranges::equal(set_a, set_b);
+    });
+}
+
+int main()
+{
+    using enum Symbol;
+    static const earley::Rule<Symbol> rules[] = {
+        { Sum,    { Sum, Plus, Number } },
+        { Sum,    { Number } },
+        { Number, { Digit } },
+        { Number, { Digit, Number } }
+    };
+    constexpr auto start_symbol = Sum;
+    std::span<const earley::Rule<Symbol>> rules_view = rules;
+    earley::RuleSet rule_set{rules_view};
+
+    std::vector<std::string> inputs = {"1+2", "34+5+678", "", "1++", "9", std::string(300, '4') + "+1"};
+    earley::Parser<Symbol> parser{16};
+    earley::Parser<Symbol, true> leo_parser{16};
+    size_t capacity = 0;
+    for(int round = 0; round < 3; ++round) {
+        for(const auto& input : inputs) {
+            const auto& state_sets = parser.parse<char>(rule_set, start_symbol, input);
+            // Same output as a parse with its own state sets
+            auto expected = earley::parse<char>(rule_set, start_symbol, 16, input);
+            assert(same_state_sets(state_sets, expected));
+            assert(&state_sets == &parser.state_sets());
+            assert((bool)earley::find_full_parse(rules_view, start_symbol, state_sets, input)
+                   == (bool)earley::find_full_parse(rules_view, start_symbol, expected, input));
+
+            SpanList<earley::LeoItem> expected_leo_items{16};
+            auto expected_leo = earley::parse<char>(rule_set, start_symbol, 16, input, expected_leo_items);
+            assert(same_state_sets(leo_parser.parse<char>(rule_set, start_symbol, input), expected_leo));
+            assert(leo_parser.leo_items().num_of_items() == expected_leo_items.num_of_items());
+
+            assert(same_state_sets(parser.parse<char>(rule_set, start_symbol, input, earley::lookahead),
+                                   earley::parse<char>(rule_set, start_symbol, 16, input, earley::lookahead)));
+        }
+        // The state sets only grow during the first round
+        if(round == 0) {
+            capacity = parser.state_sets().capacity();
+            assert(capacity > 16);
+        } else {
+            assert(parser.state_sets().capacity() == capacity);
+        }
+    }
+
+    parser.reset();
+    assert(parser.state_sets().size() == 0 && parser.state_sets().num_of_items() == 0);
+
+    // Completing on several threads gives the same state sets, in the same order. Sums of sums are
+    //  ambiguous, so long inputs have state sets with many completed items.
+    static const earley::Rule<Symbol> ambiguous_rules[] = {
+        { Sum,    { Sum, Plus, Sum } },
+        { Sum,    { Number } },
+        { Number, { Digit } }
+    };
+    earley::RuleSet ambiguous_rule_set{std::span<const earley::Rule<Symbol>>{ambiguous_rules}};
+    std::string long_sum = "1";
+    while(long_sum.size() < 400) {
+        long_sum += "+2";
+    }
+    earley::Parser<Symbol> threaded_parser;
+    earley::Parser<Symbol, true> threaded_leo_parser;
+    threaded_parser.set_completion_threads(4);
+    threaded_leo_parser.set_completion_threads(3);
+    for(const auto& input : {long_sum, long_sum + "+", long_sum.substr(0, 151), std::string{"1"}}) {
+        auto expected = earley::parse<char>(ambiguous_rule_set, start_symbol, 16, input);
+        assert(same_state_sets(threaded_parser.parse<char>(ambiguous_rule_set, start_symbol, input), expected));
+        SpanList<earley::LeoItem> expected_leo_items{16};
+        auto expected_leo = earley::parse<char>(ambiguous_rule_set, start_symbol, 16, input, expected_leo_items);
+        assert(same_state_sets(threaded_leo_parser.parse<char>(ambiguous_rule_set, start_symbol, input), expected_leo));
+        assert(same_state_sets(threaded_parser.parse<char>(rule_set, start_symbol, input),
+                               earley::parse<char>(rule_set, start_symbol, 16, input)));
+    }
+    threaded_parser.set_completion_threads(1);
+    assert(same_state_sets(threaded_parser.parse<char>(ambiguous_rule_set, start_symbol, long_sum),
+                           earley::parse<char>(ambiguous_rule_set, start_symbol, 16, long_sum)));
+
+    return 0;
+}
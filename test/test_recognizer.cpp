@@ -0,0 +1,232 @@
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <span>
+#include <ranges>
+#include <cassert>
+#include "earley.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Digit,
+    /* Nonterminals */
+    Number, Sum,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::Digit; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    // '!' stands for a token that cannot be read (e.g. because of an I/O error)
+    if(input == '!') {
+        throw std::invalid_argument("Unreadable token");
+    }
+    switch(terminal) {
+        case Symbol::Plus:  return input == '+';
+        case Symbol::Digit: return std::isdigit(input);
+        default:            return false;
+    }
+}
+
+static
+bool same_state_sets(const SpanList<earley::EarleyItem>& a, const SpanList<earley::EarleyItem>& b)
+{
+    return a.size() == b.size() && std::ranges::equal(a, b, [](auto set_a, auto set_b) {
+        return std::ranges::equal(set_a, set_b);
+    });
+}
+
+int main()
+{
+    using enum Symbol;
+    static const earley::Rule<Symbol> rules[] = {
+        { Sum,    { Sum, Plus, Number } },
+        { Sum,    { Number } },
+        { Number, { Digit } },
+        { Number, { Digit, Number } }
+    };
+    constexpr auto start_symbol = Sum;
+    std::span<const earley::Rule<Symbol>> rules_view = rules;
+    earley::RuleSet rule_set{rules_view};
+
+    std::vector<std::string> inputs = {"1+2", "34+5+678", "", "1++", "9", "+1", std::string(300, '4') + "+1"};
+    earley::Recognizer recognizer{rule_set, start_symbol, 16};
+    earley::Recognizer lookahead_recognizer{rule_set, start_symbol, earley::lookahead, 16};
+    earley::Recognizer<Symbol, earley::RuleSet<Symbol>, earley::detail::NoLookahead, true> leo_recognizer{rule_set, start_symbol, 16};
+    for(const auto& input : inputs) {
+        // Feeding the input in chunks of any size gives the same state sets as parsing all of it
+        auto expected = earley::parse<char>(rule_set, start_symbol, 16, input);
+        for(size_t chunk_size : {1, 2, 7, 1000}) {
+            recognizer.reset();
+            for(size_t offset = 0; offset < input.size(); offset += chunk_size) {
+                recognizer.feed(std::span{input}.subspan(offset, std::min(chunk_size, input.size() - offset)));
+            }
+            assert(!recognizer.is_finished() && !recognizer.is_accepted());
+            const auto& state_sets = recognizer.finish();
+            assert(recognizer.is_finished());
+            assert(&state_sets == &recognizer.state_sets());
+            assert(same_state_sets(state_sets, expected));
+            assert((bool)earley::find_full_parse(rules_view, start_symbol, state_sets, input)
+                   == (bool)earley::find_full_parse(rules_view, start_symbol, expected, input));
+            assert(recognizer.is_accepted() == (bool)earley::find_full_parse(rules_view, start_symbol, expected, input));
+        }
+
+        lookahead_recognizer.reset();
+        for(char token : input) {
+            lookahead_recognizer.feed(token);
+        }
+        assert(same_state_sets(lookahead_recognizer.finish(),
+                               earley::parse<char>(rule_set, start_symbol, 16, input, earley::lookahead)));
+
+        SpanList<earley::LeoItem> expected_leo_items{16};
+        auto expected_leo = earley::parse<char>(rule_set, start_symbol, 16, input, expected_leo_items);
+        leo_recognizer.reset();
+        leo_recognizer.feed(std::span{input});
+        assert(same_state_sets(leo_recognizer.finish(), expected_leo));
+        assert(leo_recognizer.leo_items().num_of_items() == expected_leo_items.num_of_items());
+    }
+
+    // Rejection is reported at the first token that cannot be matched, and later tokens are ignored
+    {
+        recognizer.reset();
+        std::string input = "12+3++45";
+        assert(recognizer.feed(std::span{input}.first(5)));
+        assert(!recognizer.is_rejected() && recognizer.position() == 5);
+        assert(!recognizer.feed(input[5]));
+        assert(recognizer.is_rejected() && recognizer.position() == 6);
+        assert(!recognizer.feed(std::span{input}.subspan(6)));
+        assert(recognizer.position() == 6);
+        const auto& state_sets = recognizer.finish();
+        assert(same_state_sets(state_sets, earley::parse<char>(rule_set, start_symbol, 16, input)));
+        assert(!earley::find_full_parse(rules_view, start_symbol, state_sets, input));
+    }
+
+    // A prefix of a valid input is not rejected, even though it is not a full parse until more input arrives
+    {
+        recognizer.reset();
+        std::string input = "5+";
+        assert(recognizer.feed(std::span{input}));
+        assert(!earley::find_full_parse(rules_view, start_symbol, recognizer.finish(), input));
+    }
+
+    // Reclaiming the state sets of a long stream keeps the number of items bounded, without changing the result
+    {
+        std::string input = "1";
+        for(int i = 0; i < 20'000; ++i) {
+            input += "+23";
+        }
+        earley::Recognizer reclaiming_recognizer{rule_set, start_symbol, 16};
+        reclaiming_recognizer.set_reclaim_state_sets(true);
+        size_t max_items = 0;
+        for(char token : input) {
+            assert(reclaiming_recognizer.feed(token));
+            max_items = std::max(max_items, reclaiming_recognizer.state_sets().num_of_items());
+        }
+        const auto& state_sets = reclaiming_recognizer.finish();
+        auto expected = earley::parse<char>(rule_set, start_symbol, 16, input);
+        assert(max_items < expected.num_of_items() / 10);
+        assert(state_sets.size() == expected.size());
+        assert(std::ranges::equal(*(state_sets.end() - 2), *(expected.end() - 2)));
+        assert(earley::find_full_parse(rules_view, start_symbol, state_sets, input));
+
+        // Rejection is unchanged
+        reclaiming_recognizer.reset();
+        input.back() = '+';
+        input += "+4";
+        assert(!reclaiming_recognizer.feed(std::span{input}));
+        assert(reclaiming_recognizer.position() == input.size() - 1);
+
+        // Same with Leo items
+        input.resize(input.size() - 3);
+        earley::Recognizer<Symbol, earley::RuleSet<Symbol>, earley::detail::NoLookahead, true> reclaiming_leo_recognizer{rule_set, start_symbol, 16};
+        reclaiming_leo_recognizer.set_reclaim_state_sets(true);
+        max_items = 0;
+        for(char token : input) {
+            assert(reclaiming_leo_recognizer.feed(token));
+            max_items = std::max(max_items, reclaiming_leo_recognizer.state_sets().num_of_items());
+        }
+        assert(max_items < expected.num_of_items() / 10);
+        assert(earley::find_full_parse(rules_view, start_symbol, reclaiming_leo_recognizer.finish(), input));
+    }
+
+    // Recognizing only gives the same answer as parsing, and the position of the first unmatchable token
+    for(const auto& input : inputs) {
+        auto state_sets = earley::parse<char>(rule_set, start_symbol, 16, input);
+        bool is_match = (bool)earley::find_full_parse(rules_view, start_symbol, state_sets, input);
+        earley::Parser<Symbol> parser;
+        for(auto result : {earley::recognize<char>(rule_set, start_symbol, input),
+                           earley::recognize<char>(rule_set, start_symbol, input, earley::lookahead),
+                           parser.recognize<char>(rule_set, start_symbol, input)}) {
+            assert(result.accepted == is_match);
+            if(input == "1++") {
+                assert(result.error_pos == 2);
+            } else if(input == "+1") {
+                assert(result.error_pos == 0);
+            } else {
+                // The input (if any) is accepted, or it ended too early
+                assert(result.error_pos == input.size());
+            }
+        }
+    }
+    {
+        // The rest of the input is not read once it is rejected
+        std::vector<std::string> pieces = {"1", "+", "+", "2"};
+        size_t pieces_read = 0;
+        auto tokens = pieces | std::views::transform([&](const std::string& piece) {
+            ++pieces_read;
+            return piece[0];
+        });
+        auto result = earley::recognize<char>(rule_set, start_symbol, tokens);
+        assert(!result && result.error_pos == 2 && pieces_read == 3);
+
+        // Long inputs take bounded memory
+        std::string input = "1";
+        for(int i = 0; i < 20'000; ++i) {
+            input += "+23";
+        }
+        earley::Parser<Symbol, true> leo_parser{16};
+        assert(leo_parser.recognize<char>(rule_set, start_symbol, input));
+        assert(leo_parser.state_sets().num_of_items() < earley::parse<char>(rule_set, start_symbol, 16, input).num_of_items() / 10);
+        input += "+";
+        result = leo_parser.recognize<char>(rule_set, start_symbol, input);
+        assert(!result && result.error_pos == input.size());
+    }
+
+    // An exception while processing a token leaves the state sets in place, and the recognizer can be used
+    //  again once reset
+    {
+        earley::Recognizer recognizer{rule_set, start_symbol, 16};
+        recognizer.feed(std::span{std::string_view{"1+"}});
+        bool was_thrown = false;
+        try {
+            recognizer.feed('!');
+        } catch(const std::invalid_argument&) {
+            was_thrown = true;
+        }
+        assert(was_thrown);
+        assert(recognizer.state_sets().size() > recognizer.position() && !recognizer.is_rejected());
+        recognizer.reset();
+        recognizer.feed(std::span{std::string_view{"1+2"}});
+        assert(same_state_sets(recognizer.finish(), earley::parse<char>(rule_set, start_symbol, 16, std::string{"1+2"})));
+
+        earley::Parser<Symbol> parser{16};
+        was_thrown = false;
+        try {
+            parser.recognize<char>(rule_set, start_symbol, std::string{"1+!"});
+        } catch(const std::invalid_argument&) {
+            was_thrown = true;
+        }
+        assert(was_thrown && parser.state_sets().size() > 0);
+        assert(parser.recognize<char>(rule_set, start_symbol, std::string{"1+2"}));
+    }
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <cassert>
+#include "earley.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Mult, LParen, RParen, Digit,
+    /* Nonterminals */
+    Number, Sum, Product, Factor,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::Digit; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    switch(terminal) {
+        case Symbol::Plus:   return input == '+';
+        case Symbol::Mult:   return input == '*';
+        case Symbol::LParen: return input == '(';
+        case Symbol::RParen: return input == ')';
+        case Symbol::Digit:  return std::isdigit(input);
+        default:             return false;
+    }
+}
+
+static
+bool same_state_sets(const SpanList<earley::EarleyItem>& a, const SpanList<earley::EarleyItem>& b)
+{
+    return a.size() == b.size() && std::ranges::equal(a, b, [](auto set_a, auto set_b) {
+        return std::ranges::equal(set_a, set_b);
+    });
+}
+
+int main()
+{
+    using enum Symbol;
+    static const earley::Rule<Symbol> rules[] = {
+        { Sum,     { Sum, Plus, Product } },
+        { Sum,     { Product } },
+        { Product, { Product, Mult, Factor } },
+        { Product, { Factor } },
+        { Factor,  { LParen, Sum, RParen } },
+        { Factor,  { Number } },
+        { Number,  { Digit } },
+        { Number,  { Digit, Number } }
+    };
+    constexpr auto start_symbol = Sum;
+    std::span<const earley::Rule<Symbol>> rules_view = rules;
+    earley::RuleSet rule_set{rules_view};
+
+    // Replaying random edits of an input gives the same state sets as parsing each edited input
+    std::mt19937 rng{42};
+    const char alphabet[] = "0123456789+*()";
+    std::string input = "12+(3*45)+6*(7+8)*9+10";
+    auto state_sets = earley::parse<char>(rule_set, start_symbol, 16, input);
+    for(int i = 0; i < 2000; ++i) {
+        auto offset = (uint32_t)(rng() % (input.size() + 1));
+        auto removed_count = (uint32_t)std::min<size_t>(rng() % 3, input.size() - offset);
+        std::string inserted(rng() % 3, '\0');
+        for(auto& token : inserted) {
+            // Mostly valid edits, so that the input is usually accepted
+            token = rng() % 4 == 0 ? alphabet[rng() % (sizeof(alphabet) - 1)] : "0123456789+"[rng() % 11];
+        }
+        auto new_input = input;
+        new_input.replace(offset, removed_count, inserted);
+        if(new_input.empty()) {
+            continue;
+        }
+        state_sets = earley::reparse<char>(rule_set, start_symbol, std::move(state_sets), new_input,
+                                           earley::InputEdit{offset, removed_count, (uint32_t)inserted.size()});
+        auto expected = earley::parse<char>(rule_set, start_symbol, 16, new_input);
+        assert(same_state_sets(state_sets, expected));
+        input = std::move(new_input);
+        if(!earley::find_full_parse(rules_view, start_symbol, expected, input)) {
+            // Start over from a valid input every so often, so that edits do not all land after a rejection
+            if(rng() % 4 == 0) {
+                input = "1+2*(3+4)";
+                state_sets = earley::parse<char>(rule_set, start_symbol, 16, input);
+            }
+        }
+    }
+
+    // An edit in a long input keeps every state set outside of the edit
+    {
+        std::string long_input;
+        for(int i = 0; i < 1000; ++i) {
+            long_input += "(12*3)+";
+        }
+        long_input += "4";
+        auto long_state_sets = earley::parse<char>(rule_set, start_symbol, 16, long_input);
+        long_input[3 * 7 + 2] = '5';
+        auto reparsed = earley::reparse<char>(rule_set, start_symbol, std::move(long_state_sets), long_input,
+                                              earley::InputEdit{3 * 7 + 2, 1, 1});
+        assert(same_state_sets(reparsed, earley::parse<char>(rule_set, start_symbol, 16, long_input)));
+        assert(earley::find_full_parse(rules_view, start_symbol, reparsed, long_input));
+
+        // Inserting or removing tokens moves (and renumbers) the old state sets after the edit instead
+        long_input.insert(7 * 7, "8*");
+        reparsed = earley::reparse<char>(rule_set, start_symbol, std::move(reparsed), long_input,
+                                         earley::InputEdit{7 * 7, 0, 2});
+        assert(same_state_sets(reparsed, earley::parse<char>(rule_set, start_symbol, 16, long_input)));
+        long_input.erase(5 * 7, 7);
+        reparsed = earley::reparse<char>(rule_set, start_symbol, std::move(reparsed), long_input,
+                                         earley::InputEdit{5 * 7, 7, 0});
+        assert(same_state_sets(reparsed, earley::parse<char>(rule_set, start_symbol, 16, long_input)));
+    }
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <stdexcept>
+#include <cassert>
+#include "earley.hpp"
+#include "rule_set_file.hpp"
+#include "mapped_file.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Minus, Mult, Div, LParen, RParen, Digit,
+    /* Nonterminals */
+    Number, Sum, Product, Factor, Empty,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::Digit; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    using enum Symbol;
+    switch(terminal) {
+        case Plus:   return input == '+';
+        case Minus:  return input == '-';
+        case Mult:   return input == '*';
+        case Div:    return input == '/';
+        case LParen: return input == '(';
+        case RParen: return input == ')';
+        case Digit:  return std::isdigit(input);
+        default:     return false;
+    }
+}
+
+/* A symbol type with a different number of symbols */
+enum class OtherSymbol : uint8_t {
+    A, B,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(OtherSymbol s) { return s == OtherSymbol::A; }
+
+/* Returns true if loading data (copied into 8-byte aligned memory, like a mapped file) throws */
+template<typename Symbol>
+static
+bool throws_on_load(std::string_view data, size_t misalignment = 0)
+{
+    std::vector<uint64_t> words((data.size() + misalignment + 7) / 8);
+    auto file_data = (char*)words.data() + misalignment;
+    std::memcpy(file_data, data.data(), data.size());
+    try {
+        earley::LoadedRuleSet<Symbol> rule_set{std::span<const char>{file_data, data.size()}};
+    } catch(const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    using enum Symbol;
+    using earley::Associativity;
+    static const earley::Rule<Symbol> rules[] = {
+        { Sum,     { Sum, Plus, Product },     1, Associativity::Left },
+        { Sum,     { Sum, Minus, Product },    1, Associativity::Left },
+        { Sum,     { Product } },
+        { Product, { Product, Mult, Factor },  2, Associativity::Right },
+        { Product, { Product, Div, Factor },  -2 },
+        { Product, { Factor } },
+        { Factor,  { LParen, Sum, RParen } },
+        { Factor,  { Number, Empty } },
+        { Number,  { Digit } },
+        { Number,  { Digit, Number } },
+        { Empty,   {} }
+    };
+    constexpr auto start_symbol = Sum;
+    std::span<const earley::Rule<Symbol>> rules_view = rules;
+    earley::RuleSet rule_set{rules_view};
+
+    auto path = std::filesystem::temp_directory_path() / "libearley_test_rule_set_file.bin";
+    {
+        std::ofstream file{path, std::ios::binary};
+        earley::write_rule_set(file, rule_set);
+    }
+    MappedFile file{path.c_str()};
+    earley::LoadedRuleSet<Symbol> loaded_rule_set{file.contents()};
+
+    // The tables are the same as the ones they were written from
+    assert(loaded_rule_set.rule_offsets.size() == rule_set.rule_offsets.size());
+    assert(std::ranges::equal(loaded_rule_set.rule_offsets, rule_set.rule_offsets));
+    assert(loaded_rule_set.prediction_items.size() == rule_set.prediction_items.size());
+    assert(std::ranges::equal(loaded_rule_set.terminals, rule_set.terminals));
+    assert(loaded_rule_set.max_rule_size == rule_set.max_rule_size);
+    for(size_t sym_index = 0; sym_index < (size_t)Symbol_Count; ++sym_index) {
+        auto symbol = (Symbol)sym_index;
+        assert(std::ranges::equal(loaded_rule_set[symbol], rule_set[symbol]));
+        assert(loaded_rule_set.is_nullable(symbol) == rule_set.is_nullable(symbol));
+        assert(loaded_rule_set.predicted_symbols(symbol) == rule_set.predicted_symbols(symbol));
+        assert(loaded_rule_set.first_set(symbol) == rule_set.first_set(symbol));
+        assert(loaded_rule_set.follow_set(symbol) == rule_set.follow_set(symbol));
+    }
+    auto loaded_rules = loaded_rule_set.copy_rules();
+    assert(loaded_rules.size() == std::size(rules));
+    for(size_t rule_idx = 0; rule_idx < loaded_rules.size(); ++rule_idx) {
+        assert(loaded_rules[rule_idx].symbol == rules[rule_idx].symbol);
+        assert(loaded_rules[rule_idx].components == rules[rule_idx].components);
+        assert(loaded_rules[rule_idx].priority == rules[rule_idx].priority);
+        assert(loaded_rules[rule_idx].associativity == rules[rule_idx].associativity);
+    }
+
+    // Both rule sets produce the same state sets
+    for(std::string_view input : {"1+(8*9)", "12*(3-4)/56", "1+", ""}) {
+        auto state_sets = earley::parse<char>(rule_set, start_symbol, 1000, input);
+        auto loaded_state_sets = earley::parse<char>(loaded_rule_set, start_symbol, 1000, input);
+        assert(state_sets.size() == loaded_state_sets.size());
+        for(auto state_set = state_sets.begin(), loaded_state_set = loaded_state_sets.begin();
+            state_set != state_sets.end(); ++state_set, ++loaded_state_set) {
+            assert(std::ranges::equal(*state_set, *loaded_state_set));
+        }
+        assert(earley::parse<char>(loaded_rule_set, start_symbol, 1000, input, earley::lookahead).num_of_items()
+               == earley::parse<char>(rule_set, start_symbol, 1000, input, earley::lookahead).num_of_items());
+        auto classified_state_sets = earley::parse<char>(loaded_rule_set, start_symbol, 1000, input,
+                                                         earley::ClassifyTokens{earley::TerminalTable{loaded_rule_set}});
+        assert(classified_state_sets.num_of_items() == state_sets.num_of_items());
+        assert((bool)earley::find_full_parse(std::span<const earley::Rule<Symbol>>{loaded_rules}, start_symbol,
+                                             loaded_state_sets, input)
+               == (input == "1+(8*9)" || input == "12*(3-4)/56"));
+    }
+
+    // Files that are not valid for the symbol type are rejected
+    std::string contents{file.view()};
+    assert(!throws_on_load<Symbol>(contents));
+    assert(throws_on_load<Symbol>(contents, 1));
+    assert(throws_on_load<OtherSymbol>(contents));
+    assert(throws_on_load<Symbol>(contents.substr(0, contents.size() - 8)));
+    assert(throws_on_load<Symbol>(contents.substr(0, 10)));
+    assert(throws_on_load<Symbol>(""));
+    std::string corrupt_contents = contents;
+    corrupt_contents[0] ^= 1;
+    assert(throws_on_load<Symbol>(corrupt_contents));
+    // Out of bounds indices are caught before parsing
+    earley::RuleSetFileHeader header;
+    std::memcpy(&header, contents.data(), sizeof(header));
+    auto layout = earley::detail::rule_set_file_layout(header);
+    uint32_t bad_limit = 1000;
+    corrupt_contents = contents;
+    std::memcpy(corrupt_contents.data() + layout.rule_spans + sizeof(uint32_t), &bad_limit, sizeof(bad_limit));
+    assert(throws_on_load<Symbol>(corrupt_contents));
+    corrupt_contents = contents;
+    std::memcpy(corrupt_contents.data() + layout.rule_offsets + sizeof(uint32_t), &bad_limit, sizeof(bad_limit));
+    assert(throws_on_load<Symbol>(corrupt_contents));
+    corrupt_contents = contents;
+    corrupt_contents[layout.rule_associativities] = 3;
+    assert(throws_on_load<Symbol>(corrupt_contents));
+
+    std::filesystem::remove(path);
+
+    return 0;
+}
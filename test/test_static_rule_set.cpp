@@ -0,0 +1,99 @@
+#include <cstdint>
+#include <cctype>
+#include <string_view>
+#include <vector>
+#include <cassert>
+#include "static_rule_set.hpp"
+
+enum class Symbol : uint8_t {
+    /* Terminals */
+    Plus, Minus, Mult, Div, LParen, RParen, Digit,
+    /* Nonterminals */
+    Number, Sum, Product, Factor, Empty,
+
+    Symbol_Count
+};
+
+static constexpr
+bool is_terminal(Symbol s) { return s <= Symbol::Digit; }
+
+static constexpr
+bool matches_terminal(Symbol terminal, char input)
+{
+    using enum Symbol;
+    switch(terminal) {
+        case Plus:   return input == '+';
+        case Minus:  return input == '-';
+        case Mult:   return input == '*';
+        case Div:    return input == '/';
+        case LParen: return input == '(';
+        case RParen: return input == ')';
+        case Digit:  return std::isdigit(input);
+        default:     return false;
+    }
+}
+
+static constexpr
+auto make_rules()
+{
+    using enum Symbol;
+    return std::vector<earley::Rule<Symbol>>{
+        { Sum,     { Sum, Plus, Product } },
+        { Sum,     { Sum, Minus, Product } },
+        { Sum,     { Product } },
+        { Product, { Product, Mult, Factor } },
+        { Product, { Product, Div, Factor } },
+        { Product, { Factor } },
+        { Factor,  { LParen, Sum, RParen } },
+        { Factor,  { Number, Empty } },
+        { Number,  { Digit } },
+        { Number,  { Digit, Number } },
+        { Empty,   {} }
+    };
+}
+
+static constexpr auto static_rule_set = earley::make_static_rule_set([] { return make_rules(); });
+
+// The tables are available at compile time
+static_assert(static_rule_set.rule_count == 11);
+static_assert(static_rule_set.dotted_rules.size() == 11 + 22);
+static_assert(static_rule_set.is_nullable(Symbol::Empty));
+static_assert(!static_rule_set.is_nullable(Symbol::Number));
+static_assert(*static_rule_set[Symbol::Product].begin() == 3 && static_rule_set[Symbol::Product].size() == 3);
+static_assert(static_rule_set.dotted_rule(earley::EarleyItem{7, 0, 1}).next_symbol == Symbol::Empty);
+static_assert(static_rule_set.dotted_rule(earley::EarleyItem{7, 0, 1}).next_is_nullable);
+static_assert(static_rule_set.dotted_rule(earley::EarleyItem{9, 0, 2}).is_completed);
+static_assert(static_rule_set.prediction(Symbol::Sum).size() == 10);
+static_assert(static_rule_set.predicted_symbols(Symbol::Sum).test(Symbol::Number));
+static_assert(!static_rule_set.predicted_symbols(Symbol::Sum).test(Symbol::Empty));
+static_assert(static_rule_set.prediction(Symbol::Empty).size() == 1);
+static_assert(static_rule_set.terminals.size() == 7);
+static_assert(static_rule_set.first_set(Symbol::Sum).test(Symbol::LParen) && static_rule_set.first_set(Symbol::Sum).test(Symbol::Digit));
+static_assert(!static_rule_set.first_set(Symbol::Sum).test(Symbol::Plus));
+static_assert(static_rule_set.follow_set(Symbol::Empty).test(Symbol::Mult) && !static_rule_set.follow_set(Symbol::Empty).test(Symbol::Digit));
+
+int main()
+{
+    auto rules = make_rules();
+    std::span<const earley::Rule<Symbol>> rules_view = rules;
+    earley::RuleSet rule_set{rules_view};
+    constexpr auto start_symbol = Symbol::Sum;
+
+    // Both kinds of rule sets should produce the same state sets
+    for(std::string_view input : {"1+(8*9)", "12*(3-4)/56", "1+", ""}) {
+        auto state_sets = earley::parse<char>(rule_set, start_symbol, 1000, input);
+        auto static_state_sets = earley::parse<char>(static_rule_set, start_symbol, 1000, input);
+        assert(state_sets.size() == static_state_sets.size());
+        for(auto state_set = state_sets.begin(), static_state_set = static_state_sets.begin();
+            state_set != state_sets.end(); ++state_set, ++static_state_set) {
+            assert(std::ranges::equal(*state_set, *static_state_set));
+        }
+        auto classified_state_sets = earley::parse<char>(static_rule_set, start_symbol, 1000, input,
+                                                         earley::ClassifyTokens{earley::TerminalTable{static_rule_set}});
+        assert(classified_state_sets.num_of_items() == state_sets.num_of_items());
+        assert((bool)earley::find_full_parse(rules_view, start_symbol, static_state_sets, input)
+               == (input == "1+(8*9)" || input == "12*(3-4)/56"));
+    }
+
+    return 0;
+}
\ No newline at end of file